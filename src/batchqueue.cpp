@@ -0,0 +1,413 @@
+#include "batchqueue.hpp"
+#include "client.hpp"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJSValue>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonValue>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+
+#include <utility>
+
+namespace qhr {
+
+/*!
+ * \class BatchQueue
+ * \brief BatchQueue class gathering small fire-and-forget payloads and sending
+ * them as a single \a POST body, either a JSON array or newline delimited JSON,
+ * once a batch size, byte size or time threshold is hit.
+ *
+ * The in-memory queue is bounded by \ref maxQueueSize. When a \ref spillFile is
+ * set, payloads above the bound and payloads still queued at shutdown are
+ * appended to it and sent again the next time the queue runs dry, so nothing is
+ * lost. Without a spill file the oldest payloads are dropped. Only one batch is
+ * in flight at a time. A batch failing because of the network or the server is
+ * put back at the head of the queue, a batch rejected with a client error
+ * status is dropped.
+ */
+
+/*!
+ * \brief Initialize a batch queue sending its batches using \a nam.
+ * \param nam
+ * \param parent
+ */
+BatchQueue::BatchQueue(QNetworkAccessManager* nam, QObject* parent)
+    : QObject { parent }, mNam { nam }, mFormat(JsonArray), mCompress(false),
+      mMaxBatchSize(100), mMaxBatchBytes(512 * 1024), mMaxQueueSize(10000),
+      mQueuedBytes(0), mNReply(nullptr), mDelivered(0), mDropped(0), mSpilled(0),
+      mBatchesSent(0), mBatchesFailed(0)
+{
+    mFlushTimer.setSingleShot(true);
+    mFlushTimer.setInterval(5000);
+    connect(&mFlushTimer, &QTimer::timeout, this, &BatchQueue::flush);
+
+    if (auto app = QCoreApplication::instance()) {
+        connect(app, &QCoreApplication::aboutToQuit, this,
+            &BatchQueue::persist);
+    }
+}
+
+BatchQueue::~BatchQueue()
+{
+    persist();
+}
+
+/*!
+ * \qmlmethod configure()
+ * \brief BatchQueue::configure() Updates this queue from \a options. Supported
+ * keys are \a url, \a client (the name of a \ref Client profile whose headers
+ * and base url are used), \a headers, \a format ("json" or "ndjson"),
+ * \a compress, \a maxBatchSize, \a maxBatchBytes, \a flushInterval,
+ * \a maxQueueSize and \a spillFile.
+ * \param options
+ */
+void BatchQueue::configure(const QVariantMap& options)
+{
+    const auto headers = options.value("headers").toMap();
+    for (auto it = headers.constBegin(); it != headers.constEnd(); ++it) {
+        setHeader(it.key(), it.value().toString());
+    }
+
+    if (options.contains("url")) {
+        setUrl(options.value("url").toUrl());
+    }
+    if (options.contains("format")) {
+        const auto format = options.value("format").toString();
+        setFormat(format.compare("ndjson", Qt::CaseInsensitive) == 0
+                ? NdJson
+                : JsonArray);
+    }
+    if (options.contains("compress")) {
+        setCompress(options.value("compress").toBool());
+    }
+    if (options.contains("maxBatchSize")) {
+        setMaxBatchSize(options.value("maxBatchSize").toInt());
+    }
+    if (options.contains("maxBatchBytes")) {
+        setMaxBatchBytes(options.value("maxBatchBytes").toInt());
+    }
+    if (options.contains("flushInterval")) {
+        setFlushInterval(options.value("flushInterval").toInt());
+    }
+    if (options.contains("maxQueueSize")) {
+        setMaxQueueSize(options.value("maxQueueSize").toInt());
+    }
+    if (options.contains("spillFile")) {
+        setSpillFile(options.value("spillFile").toUrl());
+    }
+}
+
+/*!
+ * \qmlmethod setHeader()
+ * \brief BatchQueue::setHeader() Sets a \a header sent with every batch.
+ * \param header
+ * \param value
+ */
+void BatchQueue::setHeader(const QString& header, const QString& value)
+{
+    mRequestTemplate.setRawHeader(header.toUtf8(), value.toUtf8());
+}
+
+/*!
+ * \brief BatchQueue::setClient() Sends batches with the default headers and
+ * timeout of \a client. A relative \ref url is resolved against its base url.
+ * Headers set on this queue before are replaced.
+ * \param client
+ */
+void BatchQueue::setClient(Client* client)
+{
+    mClient = client;
+    if (mClient) {
+        mRequestTemplate = mClient->requestTemplate();
+    }
+}
+
+/*!
+ * \qmlmethod enqueue()
+ * \brief BatchQueue::enqueue() Serializes \a payload to compact JSON and
+ * queues it. A batch is sent right away if a size threshold is hit, otherwise
+ * within \ref flushInterval milliseconds.
+ * \param payload A JS object, array or value
+ * \return False if the queue was full and its oldest payload was dropped to
+ * keep this one
+ */
+bool BatchQueue::enqueue(const QVariant& payload)
+{
+    QByteArray item = serialize(payload);
+    bool kept = true;
+
+    if (mQueue.size() >= mMaxQueueSize) {
+        if (!mSpillFile.isEmpty() && appendToSpillFile({ item })) {
+            ++mSpilled;
+        } else {
+            // Drop the oldest payload to make room for the new one
+            mQueuedBytes -= mQueue.dequeue().size() + 1;
+            mQueuedBytes += item.size() + 1;
+            mQueue.enqueue(item);
+            ++mDropped;
+            kept = false;
+        }
+    } else {
+        mQueuedBytes += item.size() + 1;
+        mQueue.enqueue(item);
+    }
+
+    if (mQueue.size() >= mMaxBatchSize || mQueuedBytes >= mMaxBatchBytes) {
+        flush();
+    } else if (!mFlushTimer.isActive()) {
+        mFlushTimer.start();
+    }
+
+    emit statsChanged();
+    return kept;
+}
+
+/*!
+ * \qmlmethod flush()
+ * \brief BatchQueue::flush() Sends the next batch of queued payloads now, if
+ * no batch is already in flight.
+ */
+void BatchQueue::flush()
+{
+    mFlushTimer.stop();
+
+    if (mNReply || !mNam) {
+        return;
+    }
+
+    if (mQueue.isEmpty()) {
+        loadSpillFile();
+        if (mQueue.isEmpty()) {
+            return;
+        }
+    }
+
+    QByteArray body = takeBatch();
+
+    QNetworkRequest request = mRequestTemplate;
+    request.setUrl(mClient ? mClient->resolvedUrl(mUrl) : mUrl);
+    request.setHeader(QNetworkRequest::ContentTypeHeader,
+        mFormat == NdJson ? "application/x-ndjson" : "application/json");
+    if (mCompress) {
+        // qCompress() output is a zlib stream prefixed by its 4 bytes length
+        body = qCompress(body).mid(4);
+        request.setRawHeader("Content-Encoding", "deflate");
+    }
+
+    mNReply = mNam->post(request, body);
+    connect(mNReply, &QNetworkReply::finished, this,
+        &BatchQueue::onReplyFinished);
+}
+
+/*!
+ * \qmlmethod persist()
+ * \brief BatchQueue::persist() Appends every queued and in flight payload to
+ * the spill file so they are sent the next time this queue is used. It is
+ * called when the application quits and when this queue is destroyed.
+ */
+void BatchQueue::persist()
+{
+    if (mSpillFile.isEmpty()) {
+        return;
+    }
+
+    QList<QByteArray> items = mInFlight;
+    items.append(mQueue);
+    if (items.isEmpty() || !appendToSpillFile(items)) {
+        return;
+    }
+
+    mSpilled += mQueue.size();
+    mQueue.clear();
+    mQueuedBytes = 0;
+
+    if (mNReply) {
+        // Already persisted, a late success must not count them delivered
+        mNReply->disconnect(this);
+        mNReply->abort();
+        mNReply->deleteLater();
+        mNReply = nullptr;
+        mSpilled += mInFlight.size();
+        mInFlight.clear();
+    }
+    emit statsChanged();
+}
+
+/*!
+ * \brief BatchQueue::setFlushInterval() Set the maximum time in milliseconds a
+ * payload waits in the queue before its batch is sent.
+ * \param interval
+ */
+void BatchQueue::setFlushInterval(int interval)
+{
+    mFlushTimer.setInterval(qMax(0, interval));
+}
+
+/*!
+ * \brief BatchQueue::setSpillFile() Set the local file payloads are spilled to
+ * when the queue is full or the application quits. Payloads spilled by a
+ * previous run are sent with the next batches.
+ * \param file
+ */
+void BatchQueue::setSpillFile(const QUrl& file)
+{
+    mSpillFile = file;
+    if (!mSpillFile.isEmpty() && QFile::exists(mSpillFile.toLocalFile())
+        && !mFlushTimer.isActive()) {
+        mFlushTimer.start();
+    }
+}
+
+QByteArray BatchQueue::serialize(const QVariant& payload)
+{
+    QVariant value = payload;
+    if (value.userType() == qMetaTypeId<QJSValue>()) {
+        value = value.value<QJSValue>().toVariant();
+    }
+
+    // Wrapping in an array lets scalar values be serialized too
+    QByteArray json = QJsonDocument(QJsonArray { QJsonValue::fromVariant(value) })
+                          .toJson(QJsonDocument::Compact);
+    return json.mid(1, json.size() - 2);
+}
+
+/*!
+ * \brief BatchQueue::takeBatch() Moves the next payloads into the in flight
+ * list and returns them as a single body in the format of this queue.
+ * \return
+ */
+QByteArray BatchQueue::takeBatch()
+{
+    qsizetype size = 0;
+    while (!mQueue.isEmpty() && mInFlight.size() < mMaxBatchSize) {
+        if (!mInFlight.isEmpty()
+            && size + mQueue.head().size() + 1 > mMaxBatchBytes) {
+            break;
+        }
+        size += mQueue.head().size() + 1;
+        mInFlight.append(mQueue.dequeue());
+    }
+    mQueuedBytes -= size;
+
+    QByteArray body;
+    body.reserve(size + 2);
+    if (mFormat == NdJson) {
+        for (const auto& item : std::as_const(mInFlight)) {
+            body.append(item).append('\n');
+        }
+    } else {
+        body.append('[');
+        for (const auto& item : std::as_const(mInFlight)) {
+            if (body.size() > 1) {
+                body.append(',');
+            }
+            body.append(item);
+        }
+        body.append(']');
+    }
+    return body;
+}
+
+void BatchQueue::onReplyFinished()
+{
+    const int count = mInFlight.size();
+    const auto error = mNReply->error();
+    const auto errorString = mNReply->errorString();
+    const int status
+        = mNReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    mNReply->deleteLater();
+    mNReply = nullptr;
+
+    if (error == QNetworkReply::NoError) {
+        mDelivered += count;
+        ++mBatchesSent;
+        mInFlight.clear();
+        emit batchSent(count);
+    } else if (status >= 400 && status < 500 && status != 408
+        && status != 429) {
+        // The server rejected the payloads, sending them again cannot help
+        ++mBatchesFailed;
+        mDropped += count;
+        mInFlight.clear();
+        emit batchFailed(count, errorString);
+    } else {
+        ++mBatchesFailed;
+        // Put the batch back at the head of the queue to retry it later
+        while (!mInFlight.isEmpty()) {
+            mQueuedBytes += mInFlight.last().size() + 1;
+            mQueue.prepend(mInFlight.takeLast());
+        }
+        while (mQueue.size() > mMaxQueueSize) {
+            if (!mSpillFile.isEmpty() && appendToSpillFile({ mQueue.last() })) {
+                ++mSpilled;
+            } else {
+                ++mDropped;
+            }
+            mQueuedBytes -= mQueue.last().size() + 1;
+            mQueue.removeLast();
+        }
+        emit batchFailed(count, errorString);
+    }
+
+    if (!mQueue.isEmpty() && !mFlushTimer.isActive()) {
+        mFlushTimer.start();
+    }
+    emit statsChanged();
+}
+
+bool BatchQueue::appendToSpillFile(const QList<QByteArray>& items)
+{
+    QFile file(mSpillFile.toLocalFile());
+    if (!file.open(QFile::WriteOnly | QFile::Append)) {
+        qWarning() << "Cannot open spill file: " << mSpillFile;
+        return false;
+    }
+
+    for (const auto& item : items) {
+        file.write(item);
+        file.write("\n");
+    }
+    return true;
+}
+
+/*!
+ * \brief BatchQueue::loadSpillFile() Moves up to \ref maxQueueSize spilled
+ * payloads back into the queue and rewrites the spill file with the rest.
+ */
+void BatchQueue::loadSpillFile()
+{
+    if (mSpillFile.isEmpty()) {
+        return;
+    }
+
+    QFile file(mSpillFile.toLocalFile());
+    if (!file.exists() || !file.open(QFile::ReadOnly)) {
+        return;
+    }
+
+    QList<QByteArray> rest;
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        if (mQueue.size() < mMaxQueueSize) {
+            mQueuedBytes += line.size() + 1;
+            mQueue.enqueue(line);
+        } else {
+            rest.append(line);
+        }
+    }
+    file.close();
+
+    file.remove();
+    if (!rest.isEmpty()) {
+        appendToSpillFile(rest);
+    }
+}
+
+}
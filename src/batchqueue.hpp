@@ -0,0 +1,157 @@
+/*!
+ * Copyright (c) 2023 Alireza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef BATCHQUEUE_HPP
+#define BATCHQUEUE_HPP
+
+#include <QNetworkRequest>
+#include <QObject>
+#include <QPointer>
+#include <QQmlEngine>
+#include <QQueue>
+#include <QTimer>
+
+#include "qmlhttprequest_global.hpp"
+
+class QNetworkAccessManager;
+class QNetworkReply;
+
+namespace qhr {
+
+class Client;
+
+class QHR_EXPORT BatchQueue : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("BatchQueue can not be created from QML, use "
+                    "QmlHttpRequest.batchQueue() instead")
+    Q_PROPERTY(QUrl     url             READ url            WRITE setUrl)
+    Q_PROPERTY(Format   format          READ format         WRITE setFormat)
+    Q_PROPERTY(bool     compress        READ compress       WRITE setCompress)
+    Q_PROPERTY(int      maxBatchSize    READ maxBatchSize   WRITE setMaxBatchSize)
+    Q_PROPERTY(int      maxBatchBytes   READ maxBatchBytes  WRITE setMaxBatchBytes)
+    Q_PROPERTY(int      flushInterval   READ flushInterval  WRITE setFlushInterval)
+    Q_PROPERTY(int      maxQueueSize    READ maxQueueSize   WRITE setMaxQueueSize)
+    Q_PROPERTY(QUrl     spillFile       READ spillFile      WRITE setSpillFile)
+    // Delivery stats
+    Q_PROPERTY(int      pending         READ pending        NOTIFY statsChanged)
+    Q_PROPERTY(int      delivered       READ delivered      NOTIFY statsChanged)
+    Q_PROPERTY(int      dropped         READ dropped        NOTIFY statsChanged)
+    Q_PROPERTY(int      spilled         READ spilled        NOTIFY statsChanged)
+    Q_PROPERTY(int      batchesSent     READ batchesSent    NOTIFY statsChanged)
+    Q_PROPERTY(int      batchesFailed   READ batchesFailed  NOTIFY statsChanged)
+
+public:
+    enum Format
+    {
+        JsonArray = 0,
+        NdJson,
+    };
+    Q_ENUM(Format);
+
+    BatchQueue(QNetworkAccessManager* nam, QObject* parent = nullptr);
+    virtual ~BatchQueue();
+
+    Q_INVOKABLE void configure(const QVariantMap& options);
+    Q_INVOKABLE void setHeader(const QString& header, const QString& value);
+    Q_INVOKABLE bool enqueue(const QVariant& payload);
+    Q_INVOKABLE void flush();
+    Q_INVOKABLE void persist();
+
+    void setClient(Client* client);
+
+    void setUrl(const QUrl& url) { mUrl = url; }
+    QUrl url() const { return mUrl; }
+
+    void setFormat(Format format) { mFormat = format; }
+    Format format() const { return mFormat; }
+
+    void setCompress(bool compress) { mCompress = compress; }
+    bool compress() const { return mCompress; }
+
+    void setMaxBatchSize(int size) { mMaxBatchSize = qMax(1, size); }
+    int maxBatchSize() const { return mMaxBatchSize; }
+
+    void setMaxBatchBytes(int bytes) { mMaxBatchBytes = qMax(1, bytes); }
+    int maxBatchBytes() const { return mMaxBatchBytes; }
+
+    void setFlushInterval(int interval);
+    int flushInterval() const { return mFlushTimer.interval(); }
+
+    void setMaxQueueSize(int size) { mMaxQueueSize = qMax(1, size); }
+    int maxQueueSize() const { return mMaxQueueSize; }
+
+    void setSpillFile(const QUrl& file);
+    QUrl spillFile() const { return mSpillFile; }
+
+    int pending() const { return mQueue.size() + mInFlight.size(); }
+    int delivered() const { return mDelivered; }
+    int dropped() const { return mDropped; }
+    int spilled() const { return mSpilled; }
+    int batchesSent() const { return mBatchesSent; }
+    int batchesFailed() const { return mBatchesFailed; }
+
+signals:
+    void statsChanged();
+    void batchSent(int count);
+    void batchFailed(int count, const QString& error);
+
+private:
+    static QByteArray serialize(const QVariant& payload);
+
+    QByteArray takeBatch();
+    void onReplyFinished();
+
+    bool appendToSpillFile(const QList<QByteArray>& items);
+    void loadSpillFile();
+
+private:
+    QNetworkAccessManager* mNam;
+    QPointer<Client> mClient;
+    QNetworkRequest mRequestTemplate;
+    QUrl mUrl;
+    Format mFormat;
+    bool mCompress;
+    int mMaxBatchSize;
+    int mMaxBatchBytes;
+    int mMaxQueueSize;
+    QUrl mSpillFile;
+    QTimer mFlushTimer;
+
+    QQueue<QByteArray> mQueue;
+    // Size of mQueue as sent, each payload followed by a separator
+    qsizetype mQueuedBytes;
+    QList<QByteArray> mInFlight;
+    QNetworkReply* mNReply;
+
+    int mDelivered;
+    int mDropped;
+    int mSpilled;
+    int mBatchesSent;
+    int mBatchesFailed;
+};
+
+}
+
+#endif // BATCHQUEUE_HPP
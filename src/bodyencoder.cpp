@@ -0,0 +1,531 @@
+#include "bodyencoder.hpp"
+
+#include <QCborStreamWriter>
+#include <QJSValue>
+#include <QJsonDocument>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace qhr {
+
+/*!
+ * \class BodyEncoder
+ * \brief BodyEncoder class encoding a QML object or array as a request body
+ * in a format selected by its content type:
+ *
+ * - \a application/json and \a "+json" types, also the default for objects
+ * and arrays sent without a content type
+ * - \a application/x-www-form-urlencoded, nested objects and arrays being
+ * flattened to \a "a[b][0]=c" keys
+ * - \a application/cbor
+ * - \a application/msgpack, also \a application/x-msgpack and \a
+ * application/vnd.msgpack
+ *
+ * Each encoder writes into a single byte array whose capacity is reserved
+ * up front from an estimate of the encoded size.
+ */
+
+/*!
+ * \brief BodyEncoder::encode() Encodes \a body into \a bytes if \a contentType
+ * has a native encoder.
+ * \param contentType Value of the \a Content-Type header
+ * \param body
+ * \param bytes
+ * \return False if there is no encoder for \a contentType
+ */
+bool BodyEncoder::encode(
+    const QByteArray& contentType, const QVariant& body, QByteArray& bytes)
+{
+    if (!hasEncoder(contentType, body)) {
+        return false;
+    }
+
+    const auto type = mimeType(contentType);
+    if (type == "application/x-www-form-urlencoded") {
+        bytes = formUrlEncoded(body);
+    } else if (type == "application/cbor") {
+        bytes = cbor(body);
+    } else if (type.endsWith("msgpack")) {
+        bytes = msgpack(body);
+    } else {
+        bytes = json(body);
+    }
+    return true;
+}
+
+/*!
+ * \brief BodyEncoder::hasEncoder() Checks whether \a body can be encoded
+ * natively for \a contentType. Strings are taken as already encoded and JSON
+ * is only written for objects and arrays, other values being sent as text.
+ * \param contentType Value of the \a Content-Type header, an empty one
+ * meaning JSON
+ * \param body
+ * \return
+ */
+bool BodyEncoder::hasEncoder(const QByteArray& contentType, const QVariant& body)
+{
+    if (body.userType() == QMetaType::QString) {
+        return false;
+    }
+
+    const auto type = mimeType(contentType);
+    if (type == "application/x-www-form-urlencoded" || type == "application/cbor"
+        || type == "application/msgpack" || type == "application/x-msgpack"
+        || type == "application/vnd.msgpack") {
+        return true;
+    }
+    if (type.isEmpty() || type == "application/json" || type.endsWith("+json")) {
+        const auto value = plain(body);
+        return value.userType() == QMetaType::QVariantMap
+            || value.userType() == QMetaType::QVariantList;
+    }
+    return false;
+}
+
+/*!
+ * \brief BodyEncoder::json() Encodes \a body, an object or an array, as
+ * compact JSON.
+ * \param body
+ * \return
+ */
+QByteArray BodyEncoder::json(const QVariant& body)
+{
+    return QJsonDocument::fromVariant(plain(body)).toJson(
+        QJsonDocument::Compact);
+}
+
+/*!
+ * \brief BodyEncoder::formUrlEncoded() Encodes the properties of \a body as
+ * \a application/x-www-form-urlencoded. Values of nested objects and arrays
+ * get bracketed keys, like \a "user[name]" and \a "tags[0]". Names and values
+ * are percent-encoded as specified by WHATWG URL standard.
+ * \param body
+ * \return
+ */
+QByteArray BodyEncoder::formUrlEncoded(const QVariant& body)
+{
+    const auto value = plain(body);
+    QByteArray bytes;
+    bytes.reserve(estimateSize(value));
+
+    if (value.userType() == QMetaType::QVariantMap) {
+        const auto map = value.toMap();
+        for (auto it = map.cbegin(); it != map.cend(); ++it) {
+            formAppend(bytes, it.key().toUtf8(), it.value());
+        }
+    } else if (value.userType() == QMetaType::QVariantList) {
+        const auto list = value.toList();
+        for (int i = 0; i < list.size(); ++i) {
+            formAppend(bytes, QByteArray::number(i), list[i]);
+        }
+    }
+    return bytes;
+}
+
+/*!
+ * \brief BodyEncoder::cbor() Encodes \a body as CBOR. Integral numbers are
+ * written as integers, binary data as byte strings.
+ * \param body
+ * \return
+ */
+QByteArray BodyEncoder::cbor(const QVariant& body)
+{
+    const auto value = plain(body);
+    QByteArray bytes;
+    bytes.reserve(estimateSize(value));
+
+    QCborStreamWriter writer(&bytes);
+    cborWrite(writer, value);
+    return bytes;
+}
+
+/*!
+ * \brief BodyEncoder::msgpack() Encodes \a body as MessagePack, using the
+ * smallest representation of each value. Integral numbers are written as
+ * integers, binary data as \a bin.
+ * \param body
+ * \return
+ */
+QByteArray BodyEncoder::msgpack(const QVariant& body)
+{
+    const auto value = plain(body);
+    QByteArray bytes;
+    bytes.reserve(estimateSize(value));
+
+    msgpackWrite(bytes, value);
+    return bytes;
+}
+
+/*!
+ * \brief BodyEncoder::estimateSize() Returns an estimate of the encoded size
+ * of \a value, visiting at most \a budget values so large bodies are not
+ * walked twice. Unvisited values are extrapolated from the visited ones. \a
+ * value is not converted by \ref plain(), which would walk all of it, so a \a
+ * QJSValue is estimated as a scalar.
+ * \param value
+ * \param budget
+ * \return
+ */
+qsizetype BodyEncoder::estimateSize(const QVariant& value, int budget)
+{
+    struct Walker
+    {
+        int budget;
+        int visited = 0;
+
+        qsizetype walk(const QVariant& value)
+        {
+            ++visited;
+            switch (value.userType()) {
+            case QMetaType::QVariantMap: {
+                const auto map = value.toMap();
+                qsizetype size = 2;
+                int seen = 0;
+                for (auto it = map.cbegin(); it != map.cend() && visited < budget;
+                     ++it, ++seen) {
+                    size += it.key().size() + 4 + walk(it.value());
+                }
+                return seen ? size * map.size() / seen : size;
+            }
+            case QMetaType::QVariantList: {
+                const auto list = value.toList();
+                qsizetype size = 2;
+                int seen = 0;
+                for (; seen < list.size() && visited < budget; ++seen) {
+                    size += 1 + walk(list[seen]);
+                }
+                return seen ? size * list.size() / seen : size;
+            }
+            case QMetaType::QString:
+                return value.toString().size() + 4;
+            case QMetaType::QByteArray:
+                return value.toByteArray().size() + 4;
+            default:
+                return 9;
+            }
+        }
+    };
+
+    return Walker { budget }.walk(value);
+}
+
+/*!
+ * \brief BodyEncoder::plain() Converts a \a QJSValue given from QML to plain
+ * variants. It must be called in the thread of the engine owning the value.
+ */
+QVariant BodyEncoder::plain(const QVariant& value)
+{
+    if (value.userType() == qMetaTypeId<QJSValue>()) {
+        return value.value<QJSValue>().toVariant();
+    }
+    return value;
+}
+
+QByteArray BodyEncoder::mimeType(const QByteArray& contentType)
+{
+    return contentType.split(';').first().trimmed().toLower();
+}
+
+void BodyEncoder::formAppend(
+    QByteArray& bytes, const QByteArray& key, const QVariant& value)
+{
+    const auto plainValue = plain(value);
+    switch (plainValue.userType()) {
+    case QMetaType::QVariantMap: {
+        const auto map = plainValue.toMap();
+        for (auto it = map.cbegin(); it != map.cend(); ++it) {
+            formAppend(bytes, key + '[' + it.key().toUtf8() + ']', it.value());
+        }
+        return;
+    }
+    case QMetaType::QVariantList: {
+        const auto list = plainValue.toList();
+        for (int i = 0; i < list.size(); ++i) {
+            formAppend(bytes, key + '[' + QByteArray::number(i) + ']', list[i]);
+        }
+        return;
+    }
+    default:
+        break;
+    }
+
+    if (!bytes.isEmpty()) {
+        bytes.append('&');
+    }
+    formAppendEscaped(bytes, key);
+    bytes.append('=');
+    if (plainValue.isNull()) {
+        return;
+    }
+    if (plainValue.userType() == QMetaType::Double) {
+        // Integral numbers from QML must not be written as "1e+06"
+        const double number = plainValue.toDouble();
+        if (std::trunc(number) == number && std::abs(number) < 1e15) {
+            bytes.append(QByteArray::number(qint64(number)));
+            return;
+        }
+    }
+    formAppendEscaped(bytes, plainValue.toString().toUtf8());
+}
+
+void BodyEncoder::formAppendEscaped(QByteArray& bytes, const QByteArray& text)
+{
+    static const char hex[] = "0123456789ABCDEF";
+
+    for (const char c : text) {
+        const auto u = uchar(c);
+        if ((u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z')
+            || (u >= '0' && u <= '9') || u == '*' || u == '-' || u == '.'
+            || u == '_') {
+            bytes.append(c);
+        } else if (u == ' ') {
+            bytes.append('+');
+        } else {
+            bytes.append('%').append(hex[u >> 4]).append(hex[u & 0xF]);
+        }
+    }
+}
+
+void BodyEncoder::cborWrite(QCborStreamWriter& writer, const QVariant& value)
+{
+    switch (value.userType()) {
+    case QMetaType::QVariantMap: {
+        const auto map = value.toMap();
+        writer.startMap(quint64(map.size()));
+        for (auto it = map.cbegin(); it != map.cend(); ++it) {
+            writer.append(it.key());
+            cborWrite(writer, plain(it.value()));
+        }
+        writer.endMap();
+        break;
+    }
+    case QMetaType::QVariantList: {
+        const auto list = value.toList();
+        writer.startArray(quint64(list.size()));
+        for (const auto& item : list) {
+            cborWrite(writer, plain(item));
+        }
+        writer.endArray();
+        break;
+    }
+    case QMetaType::QString:
+        writer.append(value.toString());
+        break;
+    case QMetaType::QByteArray:
+        writer.append(value.toByteArray());
+        break;
+    case QMetaType::Bool:
+        writer.append(value.toBool());
+        break;
+    case QMetaType::Int:
+    case QMetaType::LongLong:
+        writer.append(value.toLongLong());
+        break;
+    case QMetaType::UInt:
+    case QMetaType::ULongLong:
+        writer.append(value.toULongLong());
+        break;
+    case QMetaType::Float:
+    case QMetaType::Double: {
+        const double number = value.toDouble();
+        if (std::trunc(number) == number && std::abs(number) < 9.2e18) {
+            writer.append(qint64(number));
+        } else {
+            writer.append(number);
+        }
+        break;
+    }
+    default:
+        if (value.isNull() || !value.isValid()) {
+            writer.appendNull();
+        } else {
+            writer.append(value.toString());
+        }
+        break;
+    }
+}
+
+void BodyEncoder::msgpackWrite(QByteArray& bytes, const QVariant& value)
+{
+    switch (value.userType()) {
+    case QMetaType::QVariantMap: {
+        const auto map = value.toMap();
+        msgpackWriteHeader(bytes, quint32(map.size()), char(0x80), 15, char(0xde));
+        for (auto it = map.cbegin(); it != map.cend(); ++it) {
+            msgpackWrite(bytes, it.key());
+            msgpackWrite(bytes, plain(it.value()));
+        }
+        break;
+    }
+    case QMetaType::QVariantList: {
+        const auto list = value.toList();
+        msgpackWriteHeader(
+            bytes, quint32(list.size()), char(0x90), 15, char(0xdc));
+        for (const auto& item : list) {
+            msgpackWrite(bytes, plain(item));
+        }
+        break;
+    }
+    case QMetaType::QString: {
+        const auto text = value.toString().toUtf8();
+        const auto size = quint32(text.size());
+        if (size <= 31) {
+            bytes.append(char(0xa0 | size));
+        } else if (size <= 0xff) {
+            bytes.append(char(0xd9));
+            appendBigEndian(bytes, size, 1);
+        } else {
+            msgpackWriteHeader(bytes, size, 0, -1, char(0xda));
+        }
+        bytes.append(text);
+        break;
+    }
+    case QMetaType::QByteArray: {
+        const auto data = value.toByteArray();
+        const auto size = quint32(data.size());
+        if (size <= 0xff) {
+            bytes.append(char(0xc4));
+            appendBigEndian(bytes, size, 1);
+        } else {
+            msgpackWriteHeader(bytes, size, 0, -1, char(0xc5));
+        }
+        bytes.append(data);
+        break;
+    }
+    case QMetaType::Bool:
+        bytes.append(value.toBool() ? char(0xc3) : char(0xc2));
+        break;
+    case QMetaType::Int:
+    case QMetaType::LongLong:
+        msgpackWriteInteger(bytes, value.toLongLong());
+        break;
+    case QMetaType::UInt:
+    case QMetaType::ULongLong: {
+        const auto number = value.toULongLong();
+        if (number > quint64(std::numeric_limits<qint64>::max())) {
+            bytes.append(char(0xcf));
+            appendBigEndian(bytes, number, 8);
+        } else {
+            msgpackWriteInteger(bytes, qint64(number));
+        }
+        break;
+    }
+    case QMetaType::Float:
+    case QMetaType::Double: {
+        const double number = value.toDouble();
+        if (std::trunc(number) == number && std::abs(number) < 9.2e18) {
+            msgpackWriteInteger(bytes, qint64(number));
+        } else {
+            quint64 bits;
+            std::memcpy(&bits, &number, sizeof(bits));
+            bytes.append(char(0xcb));
+            appendBigEndian(bytes, bits, 8);
+        }
+        break;
+    }
+    default:
+        if (value.isNull() || !value.isValid()) {
+            bytes.append(char(0xc0));
+        } else {
+            msgpackWrite(bytes, value.toString());
+        }
+        break;
+    }
+}
+
+void BodyEncoder::msgpackWriteInteger(QByteArray& bytes, qint64 value)
+{
+    if (value >= 0) {
+        if (value <= 0x7f) {
+            bytes.append(char(value));
+        } else if (value <= 0xff) {
+            bytes.append(char(0xcc));
+            appendBigEndian(bytes, quint64(value), 1);
+        } else if (value <= 0xffff) {
+            bytes.append(char(0xcd));
+            appendBigEndian(bytes, quint64(value), 2);
+        } else if (value <= 0xffffffffLL) {
+            bytes.append(char(0xce));
+            appendBigEndian(bytes, quint64(value), 4);
+        } else {
+            bytes.append(char(0xcf));
+            appendBigEndian(bytes, quint64(value), 8);
+        }
+    } else if (value >= -32) {
+        bytes.append(char(value));
+    } else if (value >= -128) {
+        bytes.append(char(0xd0));
+        appendBigEndian(bytes, quint64(value), 1);
+    } else if (value >= -32768) {
+        bytes.append(char(0xd1));
+        appendBigEndian(bytes, quint64(value), 2);
+    } else if (value >= -2147483648LL) {
+        bytes.append(char(0xd2));
+        appendBigEndian(bytes, quint64(value), 4);
+    } else {
+        bytes.append(char(0xd3));
+        appendBigEndian(bytes, quint64(value), 8);
+    }
+}
+
+/*!
+ * \brief BodyEncoder::msgpackWriteHeader() Writes the header of a container
+ * or a string of \a size elements: \a fix or'ed with \a size when \a size is
+ * at most \a fixMax, otherwise \a base followed by a 16 bits size, or the
+ * next format after \a base followed by a 32 bits size.
+ */
+void BodyEncoder::msgpackWriteHeader(
+    QByteArray& bytes, quint32 size, char fix, int fixMax, char base)
+{
+    if (fixMax >= 0 && size <= quint32(fixMax)) {
+        bytes.append(char(uchar(fix) | size));
+    } else if (size <= 0xffff) {
+        bytes.append(base);
+        appendBigEndian(bytes, size, 2);
+    } else {
+        bytes.append(char(uchar(base) + 1));
+        appendBigEndian(bytes, size, 4);
+    }
+}
+
+void BodyEncoder::appendBigEndian(QByteArray& bytes, quint64 value, int size)
+{
+    for (int shift = (size - 1) * 8; shift >= 0; shift -= 8) {
+        bytes.append(char((value >> shift) & 0xff));
+    }
+}
+
+/*!
+ * \class AsyncBodyEncoder
+ * \brief AsyncBodyEncoder class encoding a large body with \ref BodyEncoder
+ * in the thread it is moved to, so the thread of the engine is not blocked.
+ */
+
+/*!
+ * \brief AsyncBodyEncoder::AsyncBodyEncoder() Takes \a body converted to
+ * plain variants. It is converted here if it is still a \a QJSValue, so it
+ * must then be constructed in the thread of the engine.
+ * \param contentType
+ * \param body
+ */
+AsyncBodyEncoder::AsyncBodyEncoder(
+    const QByteArray& contentType, const QVariant& body)
+    : mContentType(contentType), mBody(BodyEncoder::plain(body))
+{
+}
+
+/*!
+ * \brief AsyncBodyEncoder::encode() Encodes the body and emits \ref
+ * encoded().
+ */
+void AsyncBodyEncoder::encode()
+{
+    QByteArray bytes;
+    BodyEncoder::encode(mContentType, mBody, bytes);
+    mBody.clear();
+    emit encoded(bytes);
+}
+
+}
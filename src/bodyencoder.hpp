@@ -0,0 +1,92 @@
+/*!
+ * Copyright (c) 2023 Alireza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef BODYENCODER_HPP
+#define BODYENCODER_HPP
+
+#include <QByteArray>
+#include <QObject>
+#include <QVariant>
+
+#include "qmlhttprequest_global.hpp"
+
+class QCborStreamWriter;
+
+namespace qhr {
+
+class QHR_EXPORT BodyEncoder
+{
+public:
+    //! Estimated size above which a body is encoded on \ref workerThread()
+    static constexpr qsizetype AsyncThreshold = 256 * 1024;
+
+    static bool encode(const QByteArray& contentType, const QVariant& body,
+        QByteArray& bytes);
+    static bool hasEncoder(const QByteArray& contentType, const QVariant& body);
+
+    static QByteArray json(const QVariant& body);
+    static QByteArray formUrlEncoded(const QVariant& body);
+    static QByteArray cbor(const QVariant& body);
+    static QByteArray msgpack(const QVariant& body);
+
+    static qsizetype estimateSize(const QVariant& value, int budget = 4096);
+
+    static QVariant plain(const QVariant& value);
+
+private:
+    static QByteArray mimeType(const QByteArray& contentType);
+
+    static void formAppend(
+        QByteArray& bytes, const QByteArray& key, const QVariant& value);
+    static void formAppendEscaped(QByteArray& bytes, const QByteArray& text);
+
+    static void cborWrite(QCborStreamWriter& writer, const QVariant& value);
+
+    static void msgpackWrite(QByteArray& bytes, const QVariant& value);
+    static void msgpackWriteInteger(QByteArray& bytes, qint64 value);
+    static void msgpackWriteHeader(
+        QByteArray& bytes, quint32 size, char fix, int fixMax, char base);
+    static void appendBigEndian(QByteArray& bytes, quint64 value, int size);
+};
+
+class QHR_EXPORT AsyncBodyEncoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    AsyncBodyEncoder(const QByteArray& contentType, const QVariant& body);
+
+public slots:
+    void encode();
+
+signals:
+    void encoded(const QByteArray& bytes);
+
+private:
+    QByteArray mContentType;
+    QVariant mBody;
+};
+
+}
+
+#endif // BODYENCODER_HPP
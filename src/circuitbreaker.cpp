@@ -0,0 +1,204 @@
+#include "circuitbreaker.hpp"
+
+namespace qhr {
+
+/*!
+ * \class CircuitBreaker
+ * \brief CircuitBreaker class failing requests to a host or client profile
+ * fast while it is down, instead of letting each of them wait for its timeout.
+ *
+ * The breaker is \a Closed while the failure rate over the last \ref windowSize
+ * requests stays under \ref failureThreshold percent. Above it, the breaker is
+ * \a Open and requests fail immediately for \ref openDuration milliseconds.
+ * Then it is \a HalfOpen and lets \ref halfOpenRequests trial requests through:
+ * a success closes it again, a failure opens it again.
+ */
+
+/*!
+ * \brief Initialize a closed circuit breaker for \a key.
+ * \param key The host or client profile name this breaker guards
+ * \param parent
+ */
+CircuitBreaker::CircuitBreaker(const QString& key, QObject* parent)
+    : QObject { parent }, mKey { key }, mState(Closed), mFailureThreshold(50),
+      mMinimumRequests(10), mOpenDuration(30000), mHalfOpenRequests(1),
+      mHalfOpenInFlight(0), mOutcomes(20, false), mOutcomeCount(0),
+      mNextOutcome(0), mFailures(0)
+{
+    mOpenTimer.setSingleShot(true);
+    connect(&mOpenTimer, &QTimer::timeout, this, [this]() {
+        if (mState == Open) {
+            setState(HalfOpen);
+        }
+    });
+}
+
+/*!
+ * \qmlmethod configure()
+ * \brief CircuitBreaker::configure() Updates this breaker from \a options.
+ * Supported keys are \a failureThreshold, \a minimumRequests, \a windowSize,
+ * \a openDuration and \a halfOpenRequests.
+ * \param options
+ */
+void CircuitBreaker::configure(const QVariantMap& options)
+{
+    if (options.contains("failureThreshold")) {
+        setFailureThreshold(options.value("failureThreshold").toInt());
+    }
+    if (options.contains("minimumRequests")) {
+        setMinimumRequests(options.value("minimumRequests").toInt());
+    }
+    if (options.contains("windowSize")) {
+        setWindowSize(options.value("windowSize").toInt());
+    }
+    if (options.contains("openDuration")) {
+        setOpenDuration(options.value("openDuration").toInt());
+    }
+    if (options.contains("halfOpenRequests")) {
+        setHalfOpenRequests(options.value("halfOpenRequests").toInt());
+    }
+}
+
+/*!
+ * \qmlmethod reset()
+ * \brief CircuitBreaker::reset() Closes this breaker and forgets the recorded
+ * outcomes.
+ */
+void CircuitBreaker::reset()
+{
+    mOutcomeCount = 0;
+    mNextOutcome = 0;
+    mFailures = 0;
+    mHalfOpenInFlight = 0;
+    setState(Closed);
+}
+
+/*!
+ * \brief CircuitBreaker::failureRate() Returns the failure rate, between 0 and
+ * 1, over the recorded outcomes.
+ * \return
+ */
+double CircuitBreaker::failureRate() const
+{
+    return mOutcomeCount == 0 ? 0.0 : double(mFailures) / mOutcomeCount;
+}
+
+/*!
+ * \brief CircuitBreaker::setFailureThreshold() Set the failure rate, in
+ * percent, that opens this breaker.
+ * \param percent
+ */
+void CircuitBreaker::setFailureThreshold(int percent)
+{
+    mFailureThreshold = qBound(1, percent, 100);
+}
+
+/*!
+ * \brief CircuitBreaker::setWindowSize() Set the number of most recent
+ * outcomes the failure rate is computed over. Recorded outcomes are forgotten.
+ * \param size
+ */
+void CircuitBreaker::setWindowSize(int size)
+{
+    mOutcomes.assign(size_t(qMax(1, size)), false);
+    mOutcomeCount = 0;
+    mNextOutcome = 0;
+    mFailures = 0;
+}
+
+/*!
+ * \brief CircuitBreaker::allowRequest() Called before sending a request.
+ * \return False if the request must fail immediately
+ */
+bool CircuitBreaker::allowRequest()
+{
+    switch (mState) {
+    case Closed:
+        return true;
+    case Open:
+        return false;
+    case HalfOpen:
+        if (mHalfOpenInFlight < mHalfOpenRequests) {
+            ++mHalfOpenInFlight;
+            return true;
+        }
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief CircuitBreaker::recordSuccess() Records a request that got a response
+ * from a healthy server.
+ */
+void CircuitBreaker::recordSuccess()
+{
+    if (mState == HalfOpen) {
+        reset();
+        return;
+    }
+    recordOutcome(false);
+}
+
+/*!
+ * \brief CircuitBreaker::recordFailure() Records a request that failed because
+ * of the network, a timeout or a server error.
+ */
+void CircuitBreaker::recordFailure()
+{
+    if (mState == HalfOpen) {
+        mHalfOpenInFlight = 0;
+        setState(Open);
+        return;
+    }
+    recordOutcome(true);
+}
+
+/*!
+ * \brief CircuitBreaker::recordCancelled() Records a request allowed by this
+ * breaker that was aborted before its outcome was known.
+ */
+void CircuitBreaker::recordCancelled()
+{
+    if (mState == HalfOpen && mHalfOpenInFlight > 0) {
+        --mHalfOpenInFlight;
+    }
+}
+
+void CircuitBreaker::setState(State state)
+{
+    if (mState == state) {
+        return;
+    }
+
+    mState = state;
+    if (mState == Open) {
+        mOpenTimer.start(mOpenDuration);
+    } else {
+        mOpenTimer.stop();
+    }
+    emit stateChanged();
+}
+
+void CircuitBreaker::recordOutcome(bool failure)
+{
+    const int size = int(mOutcomes.size());
+    if (mOutcomeCount == size) {
+        // Forget the oldest outcome, which is overwritten
+        mFailures -= mOutcomes[mNextOutcome] ? 1 : 0;
+    } else {
+        ++mOutcomeCount;
+    }
+    mOutcomes[mNextOutcome] = failure;
+    mFailures += failure ? 1 : 0;
+    mNextOutcome = (mNextOutcome + 1) % size;
+
+    emit outcomeRecorded();
+
+    if (mState == Closed && mOutcomeCount >= qMin(mMinimumRequests, size)
+        && mFailures * 100 >= mFailureThreshold * mOutcomeCount) {
+        setState(Open);
+    }
+}
+
+}
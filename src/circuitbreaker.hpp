@@ -0,0 +1,123 @@
+/*!
+ * Copyright (c) 2023 Alireza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef CIRCUITBREAKER_HPP
+#define CIRCUITBREAKER_HPP
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QQmlEngine>
+#include <QTimer>
+
+#include <vector>
+
+#include "qmlhttprequest_global.hpp"
+
+namespace qhr {
+
+class QHR_EXPORT CircuitBreaker : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("CircuitBreaker can not be created from QML, use "
+                    "QmlHttpRequest.circuitBreaker() instead")
+    Q_PROPERTY(QString  key     READ key    CONSTANT)
+    Q_PROPERTY(State    state   READ state  NOTIFY stateChanged)
+    Q_PROPERTY(double   failureRate READ failureRate NOTIFY outcomeRecorded)
+    Q_PROPERTY(int      failureThreshold    READ failureThreshold
+            WRITE setFailureThreshold)
+    Q_PROPERTY(int      minimumRequests     READ minimumRequests
+            WRITE setMinimumRequests)
+    Q_PROPERTY(int      windowSize          READ windowSize
+            WRITE setWindowSize)
+    Q_PROPERTY(int      openDuration        READ openDuration
+            WRITE setOpenDuration)
+    Q_PROPERTY(int      halfOpenRequests    READ halfOpenRequests
+            WRITE setHalfOpenRequests)
+
+public:
+    enum State
+    {
+        Closed = 0,
+        Open,
+        HalfOpen,
+    };
+    Q_ENUM(State);
+
+    CircuitBreaker(const QString& key, QObject* parent = nullptr);
+
+    Q_INVOKABLE void configure(const QVariantMap& options);
+    Q_INVOKABLE void reset();
+
+    QString key() const { return mKey; }
+    State state() const { return mState; }
+    double failureRate() const;
+
+    void setFailureThreshold(int percent);
+    int failureThreshold() const { return mFailureThreshold; }
+
+    void setMinimumRequests(int count) { mMinimumRequests = qMax(1, count); }
+    int minimumRequests() const { return mMinimumRequests; }
+
+    void setWindowSize(int size);
+    int windowSize() const { return int(mOutcomes.size()); }
+
+    void setOpenDuration(int duration) { mOpenDuration = qMax(0, duration); }
+    int openDuration() const { return mOpenDuration; }
+
+    void setHalfOpenRequests(int count) { mHalfOpenRequests = qMax(1, count); }
+    int halfOpenRequests() const { return mHalfOpenRequests; }
+
+    bool allowRequest();
+    void recordSuccess();
+    void recordFailure();
+    void recordCancelled();
+
+signals:
+    void stateChanged();
+    void outcomeRecorded();
+
+private:
+    void setState(State state);
+    void recordOutcome(bool failure);
+
+private:
+    QString mKey;
+    State mState;
+    int mFailureThreshold;
+    int mMinimumRequests;
+    int mOpenDuration;
+    int mHalfOpenRequests;
+    int mHalfOpenInFlight;
+
+    std::vector<bool> mOutcomes;
+    int mOutcomeCount;
+    int mNextOutcome;
+    int mFailures;
+
+    QTimer mOpenTimer;
+};
+
+}
+
+#endif // CIRCUITBREAKER_HPP
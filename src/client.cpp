@@ -0,0 +1,249 @@
+#include "client.hpp"
+#include "qmlhttprequest.hpp"
+#include "request.hpp"
+
+namespace qhr {
+
+/*!
+ * \class Client
+ * \brief Client class holding a named profile of settings shared by all the
+ * \ref Request objects created from it: a base url, default headers, a timeout,
+ * a redirect policy and a limit on concurrent requests.
+ *
+ * Default headers are stored in a template \a\b QNetworkRequest which is
+ * implicitly shared with every \ref Request created by \ref newRequest(), so
+ * they are converted once per profile instead of once per request.
+ */
+
+/*!
+ * \brief Initialize a client profile named \a name.
+ * \param name
+ * \param parent
+ */
+Client::Client(const QString& name, QObject* parent)
+    : QObject { parent }, mName { name }, mRedirectPolicy(-1),
+      mMaxConcurrentRequests(0)
+{
+}
+
+/*!
+ * \qmlmethod configure()
+ * \brief Client::configure() Updates this profile from \a options. Supported
+ * keys are \a baseUrl, \a headers (an object of header names and values),
+ * \a timeout, \a redirectPolicy and \a maxConcurrentRequests. Keys missing
+ * from \a options are left unchanged.
+ * \param options
+ */
+void Client::configure(const QVariantMap& options)
+{
+    if (options.contains("baseUrl")) {
+        setBaseUrl(options.value("baseUrl").toUrl());
+    }
+
+    const auto headers = options.value("headers").toMap();
+    for (auto it = headers.constBegin(); it != headers.constEnd(); ++it) {
+        setHeader(it.key(), it.value().toString());
+    }
+
+    if (options.contains("timeout")) {
+        setTimeout(options.value("timeout").toInt());
+    }
+    if (options.contains("redirectPolicy")) {
+        setRedirectPolicy(options.value("redirectPolicy").toInt());
+    }
+    if (options.contains("maxConcurrentRequests")) {
+        setMaxConcurrentRequests(
+            options.value("maxConcurrentRequests").toInt());
+    }
+}
+
+/*!
+ * \qmlmethod setHeader()
+ * \brief Client::setHeader() Sets a default \a header sent with every request
+ * of this profile. A \ref Request can still override it with \ref
+ * Request::setRequestHeader().
+ * \param header
+ * \param value
+ */
+void Client::setHeader(const QString& header, const QString& value)
+{
+    mRequestTemplate.setRawHeader(header.toUtf8(), value.toUtf8());
+}
+
+/*!
+ * \qmlmethod newRequest()
+ * \brief Client::newRequest() Creates a new \ref Request using this profile.
+ * \see QmlHttpRequest::newRequest()
+ * \return A \ref Request
+ */
+Request* Client::newRequest()
+{
+    if (auto qhr = qobject_cast<QmlHttpRequest*>(parent())) {
+        return qhr->newRequest(mName);
+    }
+    return nullptr;
+}
+
+/*!
+ * \brief Client::setBaseUrl() Set the url relative urls passed to \ref
+ * Request::open() are resolved against. It should end with a '/' to keep its
+ * last path segment.
+ * \param url
+ */
+void Client::setBaseUrl(const QUrl& url)
+{
+    mBaseUrl = url;
+}
+
+/*!
+ * \brief Client::setTimeout() Set transfer time out of requests of this
+ * profile. Zero means the default timeout of \ref QmlHttpRequest.
+ * \param timeout Time in milliseconds
+ */
+void Client::setTimeout(int timeout)
+{
+    mRequestTemplate.setTransferTimeout(timeout);
+}
+
+/*!
+ * \brief Client::setRedirectPolicy() Set the redirect policy of requests of
+ * this profile, one of \ref QmlHttpRequest::RedirectPolicy values. A negative
+ * value follows every redirect, which is the default.
+ * \param policy
+ */
+void Client::setRedirectPolicy(int policy)
+{
+    mRedirectPolicy = policy;
+}
+
+/*!
+ * \brief Client::setMaxConcurrentRequests() Set the maximum number of requests
+ * of this profile in flight at the same time. Requests sent above this limit
+ * are queued and sent in order when a running one is done. Zero means no
+ * limit.
+ * \param max
+ */
+void Client::setMaxConcurrentRequests(int max)
+{
+    mMaxConcurrentRequests = qMax(0, max);
+    sendPending();
+}
+
+/*!
+ * \brief Client::resolvedUrl() Returns \a url resolved against the base url of
+ * this profile. Absolute urls are returned unchanged.
+ * \param url
+ * \return
+ */
+QUrl Client::resolvedUrl(const QUrl& url) const
+{
+    if (mBaseUrl.isEmpty() || !url.isRelative()) {
+        return url;
+    }
+    return mBaseUrl.resolved(url);
+}
+
+/*!
+ * \brief Client::acquire() Called by \a request before sending. Returns false
+ * if the concurrency limit is reached, in which case \a request is queued and
+ * sent later by this profile.
+ * \param request
+ * \return
+ */
+bool Client::acquire(Request* request)
+{
+    if (mActiveRequests.contains(request)) {
+        return true;
+    }
+
+    if (hasFreeSlot()) {
+        mActiveRequests.insert(request);
+        return true;
+    }
+
+    if (!mPendingRequests.contains(request)) {
+        mPendingRequests.enqueue(request);
+    }
+    return false;
+}
+
+/*!
+ * \brief Client::release() Called by \a request when it is done, aborted or
+ * destroyed so the next queued request can be sent.
+ * \param request
+ */
+void Client::release(Request* request)
+{
+    mPendingRequests.removeAll(request);
+    const bool hedging = mHedgingRequests.remove(request);
+    if (mActiveRequests.remove(request) || hedging) {
+        sendPending();
+    }
+}
+
+/*!
+ * \brief Client::acquireHedge() Called by \a request before sending a hedge
+ * reply, which counts against the concurrency limit. Unlike \ref acquire, the
+ * hedge is not queued: false is returned if no slot is free.
+ * \param request
+ * \return
+ */
+bool Client::acquireHedge(Request* request)
+{
+    if (mHedgingRequests.contains(request)) {
+        return true;
+    }
+    if (!hasFreeSlot()) {
+        return false;
+    }
+    mHedgingRequests.insert(request);
+    return true;
+}
+
+/*!
+ * \brief Client::releaseHedge() Called by \a request when its hedge reply is
+ * aborted or promoted to its reply.
+ * \param request
+ */
+void Client::releaseHedge(Request* request)
+{
+    if (mHedgingRequests.remove(request)) {
+        sendPending();
+    }
+}
+
+/*!
+ * \brief Client::isQueued() Returns true if \a request waits for a slot of
+ * this profile to be sent.
+ * \param request
+ * \return
+ */
+bool Client::isQueued(const Request* request) const
+{
+    for (const auto& pending : mPendingRequests) {
+        if (pending == request) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Client::hasFreeSlot() const
+{
+    return mMaxConcurrentRequests == 0
+        || mActiveRequests.size() + mHedgingRequests.size()
+            < mMaxConcurrentRequests;
+}
+
+void Client::sendPending()
+{
+    while (!mPendingRequests.isEmpty() && hasFreeSlot()) {
+        QPointer<Request> request = mPendingRequests.dequeue();
+        if (request) {
+            mActiveRequests.insert(request);
+            request->sendRequest();
+        }
+    }
+}
+
+}
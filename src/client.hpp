@@ -0,0 +1,104 @@
+/*!
+ * Copyright (c) 2023 Alireza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef CLIENT_HPP
+#define CLIENT_HPP
+
+#include <QNetworkRequest>
+#include <QObject>
+#include <QPointer>
+#include <QQmlEngine>
+#include <QQueue>
+#include <QSet>
+
+#include "qmlhttprequest_global.hpp"
+
+namespace qhr {
+
+class Request;
+
+class QHR_EXPORT Client : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("Client can not be created from QML, use "
+                    "QmlHttpRequest.client() instead")
+    Q_PROPERTY(QString  name    READ name       CONSTANT)
+    Q_PROPERTY(QUrl     baseUrl READ baseUrl    WRITE setBaseUrl)
+    Q_PROPERTY(int      timeout READ timeout    WRITE setTimeout)
+    Q_PROPERTY(int      redirectPolicy  READ redirectPolicy
+            WRITE setRedirectPolicy)
+    Q_PROPERTY(int      maxConcurrentRequests   READ maxConcurrentRequests
+            WRITE setMaxConcurrentRequests)
+
+public:
+    Client(const QString& name, QObject* parent = nullptr);
+
+    Q_INVOKABLE void configure(const QVariantMap& options);
+    Q_INVOKABLE void setHeader(const QString& header, const QString& value);
+    Q_INVOKABLE qhr::Request* newRequest();
+
+    QString name() const { return mName; }
+
+    void setBaseUrl(const QUrl& url);
+    QUrl baseUrl() const { return mBaseUrl; }
+
+    void setTimeout(int timeout);
+    int timeout() const { return mRequestTemplate.transferTimeout(); }
+
+    void setRedirectPolicy(int policy);
+    int redirectPolicy() const { return mRedirectPolicy; }
+
+    void setMaxConcurrentRequests(int max);
+    int maxConcurrentRequests() const { return mMaxConcurrentRequests; }
+
+    const QNetworkRequest& requestTemplate() const { return mRequestTemplate; }
+    QUrl resolvedUrl(const QUrl& url) const;
+
+    bool acquire(Request* request);
+    void release(Request* request);
+    bool isQueued(const Request* request) const;
+
+    bool acquireHedge(Request* request);
+    void releaseHedge(Request* request);
+
+private:
+    bool hasFreeSlot() const;
+    void sendPending();
+
+private:
+    QString mName;
+    QUrl mBaseUrl;
+    QNetworkRequest mRequestTemplate;
+    int mRedirectPolicy;
+    int mMaxConcurrentRequests;
+
+    QSet<Request*> mActiveRequests;
+    // Requests with a hedge reply in flight, each one using a slot
+    QSet<Request*> mHedgingRequests;
+    QQueue<QPointer<Request>> mPendingRequests;
+};
+
+}
+
+#endif // CLIENT_HPP
@@ -0,0 +1,94 @@
+#include "hedgingpolicy.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace qhr {
+
+/*!
+ * \class HedgingPolicy
+ * \brief HedgingPolicy class holding the state shared by hedged requests: the
+ * recent time to first byte of each host and the budget limiting hedges to a
+ * percentage of the requests sent.
+ *
+ * The budget is a token bucket: each sent request adds a fraction of a token
+ * matching \ref maxHedgeRatio and each hedge takes a whole one, so bursts of
+ * slow responses can not multiply the traffic.
+ */
+
+static constexpr int MinimumSamples = 16;
+static constexpr double MaximumTokens = 10.0;
+
+HedgingPolicy::HedgingPolicy() : mMaxHedgeRatio(5.0), mTokens(0) { }
+
+/*!
+ * \brief HedgingPolicy::setMaxHedgeRatio() Set the maximum percentage of sent
+ * requests that may be hedged.
+ * \param percent
+ */
+void HedgingPolicy::setMaxHedgeRatio(double percent)
+{
+    mMaxHedgeRatio = qBound(0.0, percent, 100.0);
+}
+
+/*!
+ * \brief HedgingPolicy::recordLatency() Records a time to first byte of \a
+ * host, in milliseconds. Only the most recent samples are kept.
+ * \param host
+ * \param latency
+ */
+void HedgingPolicy::recordLatency(const QString& host, int latency)
+{
+    Samples& samples = mLatencies[host];
+    samples.values[samples.next] = latency;
+    samples.next = (samples.next + 1) % int(samples.values.size());
+    samples.count = qMin(samples.count + 1, int(samples.values.size()));
+}
+
+/*!
+ * \brief HedgingPolicy::latencyPercentile() Returns the \a percentile, between
+ * 0 and 1, of the recent times to first byte of \a host or -1 if not enough of
+ * them were recorded yet.
+ * \param host
+ * \param percentile
+ * \return
+ */
+int HedgingPolicy::latencyPercentile(
+    const QString& host, double percentile) const
+{
+    auto it = mLatencies.constFind(host);
+    if (it == mLatencies.constEnd() || it->count < MinimumSamples) {
+        return -1;
+    }
+
+    std::array<int, 64> values = it->values;
+    const auto end = values.begin() + it->count;
+    const auto nth = values.begin()
+        + qBound(0, int(std::ceil(percentile * it->count)) - 1, it->count - 1);
+    std::nth_element(values.begin(), nth, end);
+    return *nth;
+}
+
+/*!
+ * \brief HedgingPolicy::requestSent() Adds the share of a hedge a sent request
+ * earns to the budget.
+ */
+void HedgingPolicy::requestSent()
+{
+    mTokens = qMin(MaximumTokens, mTokens + mMaxHedgeRatio / 100.0);
+}
+
+/*!
+ * \brief HedgingPolicy::tryHedge() Takes a hedge from the budget.
+ * \return False if the budget is exhausted and the request must not be hedged
+ */
+bool HedgingPolicy::tryHedge()
+{
+    if (mTokens < 1.0) {
+        return false;
+    }
+    mTokens -= 1.0;
+    return true;
+}
+
+}
@@ -0,0 +1,65 @@
+/*!
+ * Copyright (c) 2023 Alireza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef HEDGINGPOLICY_HPP
+#define HEDGINGPOLICY_HPP
+
+#include <QHash>
+#include <QString>
+
+#include <array>
+
+#include "qmlhttprequest_global.hpp"
+
+namespace qhr {
+
+class QHR_EXPORT HedgingPolicy
+{
+public:
+    HedgingPolicy();
+
+    void setMaxHedgeRatio(double percent);
+    double maxHedgeRatio() const { return mMaxHedgeRatio; }
+
+    void recordLatency(const QString& host, int latency);
+    int latencyPercentile(const QString& host, double percentile) const;
+
+    void requestSent();
+    bool tryHedge();
+
+private:
+    struct Samples
+    {
+        std::array<int, 64> values;
+        int count = 0;
+        int next = 0;
+    };
+
+    QHash<QString, Samples> mLatencies;
+    double mMaxHedgeRatio;
+    double mTokens;
+};
+
+}
+
+#endif // HEDGINGPOLICY_HPP
@@ -0,0 +1,707 @@
+#include "imageprovider.hpp"
+#include "qmlhttprequest.hpp"
+#include "request.hpp"
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QImageReader>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <limits>
+
+namespace qhr {
+
+/*!
+ * \class ImageProvider
+ * \brief ImageProvider class serving \a\b image://qhr/ urls to QML \a\b Image
+ * items. The rest of the url is fetched through \ref QmlHttpRequest::
+ * newRequest(), so the image gets the same headers, client profile, timeouts
+ * and circuit breaker as any \ref Request, and is decoded and scaled to the
+ * requested \a\b sourceSize on a thread pool by \ref ImageLoader.
+ */
+
+/*!
+ * \class ImageLoader
+ * \brief ImageLoader class living on the QML thread behind \ref
+ * ImageProvider. It keeps decoded images in a memory cache bounded in bytes
+ * and evicting the least recently used first, and raw bytes in a disk cache
+ * trimmed the same way. Disk entries expire as their \a Cache-Control or \a
+ * Expires header says, and responses which must not be stored are not. Loads
+ * of the same url share a single fetch, which is aborted once every \ref
+ * ImageTicket waiting for it is gone.
+ */
+
+/*!
+ * \class ImageTicket
+ * \brief ImageTicket class standing for one image load on the QML thread. It
+ * is owned by its \ref ImageResponse, which deletes it when cancelled or
+ * destroyed.
+ */
+
+static const QByteArray DiskMagic = "qhr-image/1 ";
+
+ImageTicket::ImageTicket(const QUrl& url, const QSize& requestedSize)
+    : QObject { nullptr }, mUrl(url), mRequestedSize(requestedSize)
+{
+}
+
+ImageLoader::ImageLoader(QmlHttpRequest* qhr, QObject* parent)
+    : QObject { parent }, mQhr(qhr), mDiskSize(DefaultDiskCacheSize),
+      mDiskUsage(-1)
+{
+    setMemoryCacheSize(DefaultMemoryCacheSize);
+    mDiskDirectory = QStandardPaths::writableLocation(
+                         QStandardPaths::CacheLocation)
+        + "/qhr-images";
+}
+
+ImageLoader::~ImageLoader()
+{
+    mPool.clear();
+    mPool.waitForDone();
+
+    for (const auto& fetch : std::as_const(mFetches)) {
+        if (fetch.request) {
+            disconnect(fetch.request, nullptr, this, nullptr);
+            fetch.request->abort();
+            fetch.request->deleteLater();
+        }
+    }
+}
+
+/*!
+ * \brief ImageLoader::configure() Updates this loader from \a options.
+ * Supported keys are \a client, \a memoryCacheSize and \a diskCacheSize in
+ * bytes, \a diskCacheDirectory and \a threads.
+ * \param options
+ */
+void ImageLoader::configure(const QVariantMap& options)
+{
+    if (options.contains("client")) {
+        setClient(options.value("client").toString());
+    }
+    if (options.contains("memoryCacheSize")) {
+        setMemoryCacheSize(options.value("memoryCacheSize").toInt());
+    }
+    if (options.contains("diskCacheSize")) {
+        setDiskCacheSize(options.value("diskCacheSize").toLongLong());
+    }
+    if (options.contains("diskCacheDirectory")) {
+        setDiskCacheDirectory(options.value("diskCacheDirectory").toString());
+    }
+    if (options.contains("threads")) {
+        setMaxThreadCount(options.value("threads").toInt());
+    }
+}
+
+/*!
+ * \brief ImageLoader::setMemoryCacheSize() Sets the total size of decoded
+ * images kept in memory, zero disables the memory cache.
+ * \param bytes
+ */
+void ImageLoader::setMemoryCacheSize(int bytes)
+{
+    // Costs are counted in KiB to stay within int on Qt 5
+    mImages.setMaxCost(qMax(0, bytes / 1024));
+}
+
+int ImageLoader::memoryCacheSize() const
+{
+    return int(mImages.maxCost()) * 1024;
+}
+
+void ImageLoader::setDiskCacheDirectory(const QString& directory)
+{
+    QMutexLocker locker(&mDiskMutex);
+    mDiskDirectory = directory;
+    mDiskUsage = -1;
+}
+
+/*!
+ * \brief ImageLoader::setDiskCacheSize() Sets the total size of raw images
+ * kept in \ref diskCacheDirectory(), zero disables the disk cache.
+ * \param bytes
+ */
+void ImageLoader::setDiskCacheSize(qint64 bytes)
+{
+    QMutexLocker locker(&mDiskMutex);
+    mDiskSize = qMax<qint64>(0, bytes);
+}
+
+void ImageLoader::setMaxThreadCount(int count)
+{
+    mPool.setMaxThreadCount(
+        count > 0 ? count : QThread::idealThreadCount());
+}
+
+/*!
+ * \brief ImageLoader::diskPath() Returns the file the raw bytes of \a url are
+ * cached in.
+ * \param url
+ * \return
+ */
+QString ImageLoader::diskPath(const QUrl& url) const
+{
+    return mDiskDirectory + '/'
+        + QCryptographicHash::hash(url.toEncoded(), QCryptographicHash::Sha1)
+              .toHex();
+}
+
+/*!
+ * \brief ImageLoader::cacheKey() Returns the memory cache key of \a url
+ * decoded for \a size.
+ * \param url
+ * \param size
+ * \return
+ */
+QString ImageLoader::cacheKey(const QUrl& url, const QSize& size)
+{
+    return QString("%1x%2|%3")
+        .arg(size.width())
+        .arg(size.height())
+        .arg(url.toString(QUrl::FullyEncoded));
+}
+
+/*!
+ * \brief ImageLoader::scaledSize() Returns \a size scaled down to fit in \a
+ * requestedSize keeping its aspect ratio. A requested width or height not
+ * greater than zero is unbounded, like \a\b sourceSize of QML \a\b Image, and
+ * images are never scaled up.
+ * \param size
+ * \param requestedSize
+ * \return
+ */
+QSize ImageLoader::scaledSize(const QSize& size, const QSize& requestedSize)
+{
+    const QSize bounds(requestedSize.width() > 0
+            ? requestedSize.width()
+            : std::numeric_limits<int>::max(),
+        requestedSize.height() > 0 ? requestedSize.height()
+                                   : std::numeric_limits<int>::max());
+    if (size.isEmpty()
+        || (size.width() <= bounds.width()
+            && size.height() <= bounds.height())) {
+        return size;
+    }
+    return size.scaled(bounds, Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+}
+
+/*!
+ * \brief ImageLoader::decode() Decodes \a bytes, scaled by \ref scaledSize()
+ * while decoding so large JPEGs are never fully expanded in memory. It is
+ * safe to call from any thread.
+ * \param bytes
+ * \param requestedSize
+ * \param error Set to the reason when decoding fails
+ * \return The image, or a null image on failure
+ */
+QImage ImageLoader::decode(
+    const QByteArray& bytes, const QSize& requestedSize, QString* error)
+{
+    QBuffer buffer;
+    buffer.setData(bytes);
+    buffer.open(QIODevice::ReadOnly);
+
+    QImageReader reader(&buffer);
+    reader.setAutoTransform(true);
+
+    // The scaled size applies before the EXIF rotation
+    auto bounds = requestedSize;
+    if (reader.transformation() & QImageIOHandler::TransformationRotate90) {
+        bounds.transpose();
+    }
+    const auto size = reader.size();
+    const auto scaled = scaledSize(size, bounds);
+    if (scaled != size) {
+        reader.setScaledSize(scaled);
+    }
+
+    QImage image;
+    if (!reader.read(&image) && error) {
+        *error = reader.errorString();
+    }
+    return image;
+}
+
+/*!
+ * \brief ImageLoader::diskExpiry() Returns until when a response with the \a
+ * cacheControl and \a expires headers, received at \a now, may be served
+ * from the disk cache. \a max-age takes precedence over \a Expires, and a
+ * response with neither is kept \ref DefaultDiskLifetime seconds.
+ * \param cacheControl
+ * \param expires
+ * \param now
+ * \return The expiry, or an invalid date if the response must not be stored
+ */
+QDateTime ImageLoader::diskExpiry(const QByteArray& cacheControl,
+    const QByteArray& expires, const QDateTime& now)
+{
+    qint64 maxAge = -1;
+    for (const auto& part : cacheControl.split(',')) {
+        const auto directive = part.trimmed().toLower();
+        // The cache outlives the session and is not revalidated
+        if (directive == "no-store" || directive == "no-cache"
+            || directive.startsWith("private")) {
+            return QDateTime();
+        }
+        if (directive.startsWith("max-age=")) {
+            bool ok = false;
+            const auto value
+                = directive.mid(8).replace('"', "").toLongLong(&ok);
+            maxAge = ok ? qMax<qint64>(0, value) : 0;
+        }
+    }
+
+    if (maxAge >= 0) {
+        return maxAge > 0 ? now.addSecs(maxAge) : QDateTime();
+    }
+    if (!expires.trimmed().isEmpty()) {
+        // An invalid date, like "0", means already expired
+        auto date = QString::fromLatin1(expires.trimmed());
+        if (date.endsWith(" GMT")) {
+            date.replace(date.size() - 3, 3, "+0000");
+        }
+        const auto expiry = QDateTime::fromString(date, Qt::RFC2822Date);
+        return expiry.isValid() && expiry > now ? expiry : QDateTime();
+    }
+    return now.addSecs(DefaultDiskLifetime);
+}
+
+/*!
+ * \brief ImageLoader::diskEntry() Returns the content of the cache file of
+ * \a bytes, which starts with a line holding its \a expiry.
+ * \param bytes
+ * \param expiry
+ * \return
+ */
+QByteArray ImageLoader::diskEntry(
+    const QByteArray& bytes, const QDateTime& expiry)
+{
+    return DiskMagic + QByteArray::number(expiry.toMSecsSinceEpoch()) + '\n'
+        + bytes;
+}
+
+/*!
+ * \brief ImageLoader::diskBytes() Returns the bytes cached in \a entry, the
+ * content of a cache file, if it is still fresh at \a now.
+ * \param entry
+ * \param now
+ * \return The bytes, or an empty array if the entry is expired or invalid
+ */
+QByteArray ImageLoader::diskBytes(const QByteArray& entry, const QDateTime& now)
+{
+    const auto end = entry.indexOf('\n');
+    if (!entry.startsWith(DiskMagic) || end < 0) {
+        return QByteArray();
+    }
+
+    bool ok = false;
+    const auto expiry = entry.mid(DiskMagic.size(), end - DiskMagic.size())
+                            .toLongLong(&ok);
+    if (!ok || expiry <= now.toMSecsSinceEpoch()) {
+        return QByteArray();
+    }
+    return entry.mid(end + 1);
+}
+
+/*!
+ * \brief ImageLoader::load() Answers \a ticket from the memory cache, or
+ * joins it to the fetch of its url, starting one from the disk cache or the
+ * network if none is in progress.
+ * \param ticket
+ */
+void ImageLoader::load(ImageTicket* ticket)
+{
+    const auto url = ticket->url();
+    if (!url.isValid() || url.isRelative()) {
+        emit ticket->done(
+            QImage(), QString("Invalid image url \"%1\"").arg(url.toString()));
+        return;
+    }
+
+    if (const auto image
+        = mImages.object(cacheKey(url, ticket->requestedSize()))) {
+        emit ticket->done(*image, QString());
+        return;
+    }
+
+    connect(ticket, &QObject::destroyed, this,
+        [this, url]() { onTicketDestroyed(url); });
+
+    const bool started = mFetches.contains(url);
+    auto& fetch = mFetches[url];
+    fetch.tickets.append(ticket);
+    if (fetch.loaded) {
+        decodeFor(url, fetch);
+    } else if (!started) {
+        readDisk(url);
+    }
+}
+
+void ImageLoader::readDisk(const QUrl& url)
+{
+    if (mDiskSize <= 0) {
+        fetchNetwork(url);
+        return;
+    }
+
+    const auto path = diskPath(url);
+    mPool.start([this, url, path]() {
+        QByteArray bytes;
+        QFile file(path);
+        if (file.open(QIODevice::ReadWrite)) {
+            bytes = diskBytes(file.readAll(), QDateTime::currentDateTimeUtc());
+            if (bytes.isEmpty()) {
+                file.close();
+                removeFromDisk(path);
+            } else {
+                // Keeps recently used files last to be trimmed
+                file.setFileTime(QDateTime::currentDateTime(),
+                    QFileDevice::FileModificationTime);
+            }
+        }
+        QMetaObject::invokeMethod(
+            this, [this, url, bytes]() { onDiskRead(url, bytes); },
+            Qt::QueuedConnection);
+    });
+}
+
+void ImageLoader::onDiskRead(const QUrl& url, const QByteArray& bytes)
+{
+    auto it = mFetches.find(url);
+    if (it == mFetches.end()) {
+        return;
+    }
+
+    if (bytes.isEmpty()) {
+        fetchNetwork(url);
+        return;
+    }
+    it->bytes = bytes;
+    it->loaded = true;
+    decodeFor(url, *it);
+}
+
+void ImageLoader::fetchNetwork(const QUrl& url)
+{
+    if (!mQhr) {
+        fail(url, "QmlHttpRequest is not available");
+        return;
+    }
+
+    auto request = mQhr->newRequest(mClient);
+    request->setAutoRelease(false);
+    mFetches[url].request = request;
+    connect(request, &Request::finished, this,
+        [this, url, request]() { onRequestFinished(url, request); });
+    request->open("GET", url);
+    request->send();
+}
+
+void ImageLoader::onRequestFinished(const QUrl& url, Request* request)
+{
+    request->deleteLater();
+
+    auto it = mFetches.find(url);
+    if (it == mFetches.end() || it->request != request) {
+        return;
+    }
+    it->request = nullptr;
+
+    const auto status = request->status();
+    if (status < 200 || status >= 300) {
+        fail(url,
+            status ? QString("Image request failed with status %1").arg(status)
+                   : QString("Image request failed"));
+        return;
+    }
+
+    it->bytes = request->responseBody();
+    it->loaded = true;
+    const auto expiry = diskExpiry(request->responseHeader("Cache-Control"),
+        request->responseHeader("Expires"), QDateTime::currentDateTimeUtc());
+    if (expiry.isValid()) {
+        writeDisk(url, it->bytes, expiry);
+    }
+    decodeFor(url, *it);
+}
+
+/*!
+ * \brief ImageLoader::decodeFor() Starts decoding the bytes of \a fetch once
+ * for each size its tickets requested and is not already being decoded.
+ * \param url
+ * \param fetch
+ */
+void ImageLoader::decodeFor(const QUrl& url, Fetch& fetch)
+{
+    for (const auto& ticket : std::as_const(fetch.tickets)) {
+        if (!ticket) {
+            continue;
+        }
+
+        const auto size = ticket->requestedSize();
+        const auto key = cacheKey(url, size);
+        if (fetch.decoding.contains(key)) {
+            continue;
+        }
+        fetch.decoding.insert(key);
+
+        const auto bytes = fetch.bytes;
+        mPool.start([this, url, size, bytes]() {
+            QString error;
+            const auto image = decode(bytes, size, &error);
+            QMetaObject::invokeMethod(
+                this,
+                [this, url, size, image, error]() {
+                    onDecoded(url, size, image, error);
+                },
+                Qt::QueuedConnection);
+        });
+    }
+}
+
+void ImageLoader::onDecoded(const QUrl& url, const QSize& size,
+    const QImage& image, const QString& error)
+{
+    const auto key = cacheKey(url, size);
+    if (!image.isNull()) {
+        mImages.insert(key, new QImage(image),
+            qMax<qsizetype>(1, image.sizeInBytes() / 1024));
+    }
+
+    auto it = mFetches.find(url);
+    if (it == mFetches.end()) {
+        return;
+    }
+    it->decoding.remove(key);
+
+    const auto reason = image.isNull()
+        ? QString("Could not decode image: %1").arg(error)
+        : QString();
+    auto& tickets = it->tickets;
+    for (int i = 0; i < tickets.size();) {
+        const auto ticket = tickets[i];
+        if (!ticket) {
+            tickets.removeAt(i);
+        } else if (ticket->requestedSize() == size) {
+            tickets.removeAt(i);
+            disconnect(ticket, nullptr, this, nullptr);
+            emit ticket->done(image, reason);
+        } else {
+            ++i;
+        }
+    }
+
+    if (tickets.isEmpty() && it->decoding.isEmpty()) {
+        mFetches.erase(it);
+    }
+}
+
+void ImageLoader::fail(const QUrl& url, const QString& error)
+{
+    const auto fetch = mFetches.take(url);
+    for (const auto& ticket : fetch.tickets) {
+        if (ticket) {
+            disconnect(ticket, nullptr, this, nullptr);
+            emit ticket->done(QImage(), error);
+        }
+    }
+}
+
+/*!
+ * \brief ImageLoader::onTicketDestroyed() Drops the fetch of \a url and
+ * aborts its request once no ticket is waiting for it anymore, as when the
+ * delegates showing it are destroyed while scrolling.
+ * \param url
+ */
+void ImageLoader::onTicketDestroyed(const QUrl& url)
+{
+    auto it = mFetches.find(url);
+    if (it == mFetches.end()) {
+        return;
+    }
+
+    auto& tickets = it->tickets;
+    tickets.erase(std::remove_if(tickets.begin(), tickets.end(),
+                      [](const QPointer<ImageTicket>& ticket) {
+                          return ticket.isNull();
+                      }),
+        tickets.end());
+    if (!tickets.isEmpty()) {
+        return;
+    }
+
+    const auto request = it->request;
+    mFetches.erase(it);
+    if (request) {
+        request->abort();
+        request->deleteLater();
+    }
+}
+
+void ImageLoader::writeDisk(
+    const QUrl& url, const QByteArray& bytes, const QDateTime& expiry)
+{
+    if (mDiskSize <= 0 || bytes.isEmpty()) {
+        return;
+    }
+
+    const auto path = diskPath(url);
+    mPool.start([this, path, bytes, expiry]() {
+        storeOnDisk(path, diskEntry(bytes, expiry));
+    });
+}
+
+/*!
+ * \brief ImageLoader::storeOnDisk() Writes \a bytes to \a path, then removes
+ * the least recently used files once the cache grows over its size. The size
+ * in use is only counted from the directory the first time.
+ * \param path
+ * \param bytes
+ */
+void ImageLoader::storeOnDisk(const QString& path, const QByteArray& bytes)
+{
+    QMutexLocker locker(&mDiskMutex);
+    QDir directory(mDiskDirectory);
+    if (!directory.mkpath(".")) {
+        qWarning() << "Could not create image cache" << mDiskDirectory;
+        return;
+    }
+
+    const auto entries = directory.entryInfoList(QDir::Files, QDir::Time);
+    if (mDiskUsage < 0) {
+        mDiskUsage = 0;
+        for (const auto& entry : entries) {
+            mDiskUsage += entry.size();
+        }
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(bytes) != bytes.size()
+        || !file.commit()) {
+        qWarning() << "Could not cache image in" << path;
+        return;
+    }
+    mDiskUsage += bytes.size();
+
+    if (mDiskUsage <= mDiskSize) {
+        return;
+    }
+
+    // Trims to 90% so not every following write lists the directory again
+    for (auto entry = entries.crbegin();
+         entry != entries.crend() && mDiskUsage > mDiskSize * 9 / 10;
+         ++entry) {
+        if (entry->filePath() != path && QFile::remove(entry->filePath())) {
+            mDiskUsage -= entry->size();
+        }
+    }
+}
+
+/*!
+ * \brief ImageLoader::removeFromDisk() Removes the expired or invalid cache
+ * file \a path.
+ * \param path
+ */
+void ImageLoader::removeFromDisk(const QString& path)
+{
+    QMutexLocker locker(&mDiskMutex);
+    const auto size = QFileInfo(path).size();
+    if (QFile::remove(path) && mDiskUsage >= 0) {
+        mDiskUsage -= size;
+    }
+}
+
+/*!
+ * \class ImageResponse
+ * \brief ImageResponse class handed to QML for each image load. It is created
+ * on the image loading thread and receives the result of its \ref
+ * ImageTicket from the QML thread.
+ */
+
+ImageResponse::ImageResponse(ImageTicket* ticket)
+    : mTicket(ticket), mFinished(false)
+{
+    connect(ticket, &ImageTicket::done, this, &ImageResponse::onDone);
+}
+
+ImageResponse::~ImageResponse()
+{
+    releaseTicket();
+}
+
+QQuickTextureFactory* ImageResponse::textureFactory() const
+{
+    return mImage.isNull()
+        ? nullptr
+        : QQuickTextureFactory::textureFactoryForImage(mImage);
+}
+
+/*!
+ * \brief ImageResponse::cancel() Releases the ticket, which aborts the fetch
+ * if no other load waits for it, and finishes right away.
+ */
+void ImageResponse::cancel()
+{
+    releaseTicket();
+    if (!mFinished) {
+        mFinished = true;
+        emit finished();
+    }
+}
+
+void ImageResponse::onDone(const QImage& image, const QString& error)
+{
+    if (mFinished) {
+        return;
+    }
+
+    mImage = image;
+    mError = error;
+    mFinished = true;
+    emit finished();
+}
+
+void ImageResponse::releaseTicket()
+{
+    // The ticket lives on the QML thread
+    if (mTicket) {
+        mTicket->deleteLater();
+        mTicket = nullptr;
+    }
+}
+
+ImageProvider::ImageProvider(QmlHttpRequest* qhr)
+    : mLoader(std::make_unique<ImageLoader>(qhr))
+{
+}
+
+ImageProvider::~ImageProvider() = default;
+
+/*!
+ * \brief ImageProvider::requestImageResponse() Called on the image loading
+ * thread with \a id being the url to fetch. The load itself is queued to the
+ * loader on the QML thread.
+ * \param id
+ * \param requestedSize
+ * \return
+ */
+QQuickImageResponse* ImageProvider::requestImageResponse(
+    const QString& id, const QSize& requestedSize)
+{
+    auto ticket = new ImageTicket(QUrl(id), requestedSize);
+    ticket->moveToThread(mLoader->thread());
+    auto response = new ImageResponse(ticket);
+
+    const auto loader = mLoader.get();
+    QMetaObject::invokeMethod(
+        loader, [loader, ticket]() { loader->load(ticket); },
+        Qt::QueuedConnection);
+    return response;
+}
+
+}
@@ -0,0 +1,189 @@
+/*!
+ * Copyright (c) 2023 Alireza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#ifndef IMAGEPROVIDER_HPP
+#define IMAGEPROVIDER_HPP
+
+#include <QCache>
+#include <QDateTime>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QPointer>
+#include <QQuickAsyncImageProvider>
+#include <QSet>
+#include <QThreadPool>
+#include <QUrl>
+
+#include <memory>
+
+#include "qmlhttprequest_global.hpp"
+
+namespace qhr {
+
+class QmlHttpRequest;
+class Request;
+
+class QHR_EXPORT ImageTicket : public QObject
+{
+    Q_OBJECT
+
+public:
+    ImageTicket(const QUrl& url, const QSize& requestedSize);
+
+    QUrl url() const { return mUrl; }
+    QSize requestedSize() const { return mRequestedSize; }
+
+signals:
+    void done(const QImage& image, const QString& error);
+
+private:
+    QUrl mUrl;
+    QSize mRequestedSize;
+};
+
+class QHR_EXPORT ImageLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultMemoryCacheSize = 64 * 1024 * 1024;
+    static constexpr qint64 DefaultDiskCacheSize = 256 * 1024 * 1024;
+    //! Seconds a response without freshness headers is kept on disk
+    static constexpr qint64 DefaultDiskLifetime = 24 * 60 * 60;
+
+    ImageLoader(QmlHttpRequest* qhr, QObject* parent = nullptr);
+    ~ImageLoader();
+
+    void configure(const QVariantMap& options);
+    void load(ImageTicket* ticket);
+
+    void setClient(const QString& client) { mClient = client; }
+    QString client() const { return mClient; }
+
+    void setMemoryCacheSize(int bytes);
+    int memoryCacheSize() const;
+
+    void setDiskCacheDirectory(const QString& directory);
+    QString diskCacheDirectory() const { return mDiskDirectory; }
+    void setDiskCacheSize(qint64 bytes);
+    qint64 diskCacheSize() const { return mDiskSize; }
+
+    void setMaxThreadCount(int count);
+    int maxThreadCount() const { return mPool.maxThreadCount(); }
+
+    int pendingCount() const { return mFetches.size(); }
+    QString diskPath(const QUrl& url) const;
+
+    static QString cacheKey(const QUrl& url, const QSize& size);
+    static QSize scaledSize(const QSize& size, const QSize& requestedSize);
+    static QImage decode(const QByteArray& bytes, const QSize& requestedSize,
+        QString* error = nullptr);
+    static QDateTime diskExpiry(const QByteArray& cacheControl,
+        const QByteArray& expires, const QDateTime& now);
+    static QByteArray diskEntry(
+        const QByteArray& bytes, const QDateTime& expiry);
+    static QByteArray diskBytes(const QByteArray& entry, const QDateTime& now);
+
+private:
+    struct Fetch
+    {
+        QList<QPointer<ImageTicket>> tickets;
+        QSet<QString> decoding;
+        QByteArray bytes;
+        Request* request = nullptr;
+        bool loaded = false;
+    };
+
+    void readDisk(const QUrl& url);
+    void onDiskRead(const QUrl& url, const QByteArray& bytes);
+    void fetchNetwork(const QUrl& url);
+    void onRequestFinished(const QUrl& url, Request* request);
+    void decodeFor(const QUrl& url, Fetch& fetch);
+    void onDecoded(const QUrl& url, const QSize& size, const QImage& image,
+        const QString& error);
+    void fail(const QUrl& url, const QString& error);
+    void onTicketDestroyed(const QUrl& url);
+    void writeDisk(
+        const QUrl& url, const QByteArray& bytes, const QDateTime& expiry);
+    void storeOnDisk(const QString& path, const QByteArray& bytes);
+    void removeFromDisk(const QString& path);
+
+private:
+    QPointer<QmlHttpRequest> mQhr;
+    QString mClient;
+    QCache<QString, QImage> mImages;
+    QHash<QUrl, Fetch> mFetches;
+
+    QString mDiskDirectory;
+    qint64 mDiskSize;
+    qint64 mDiskUsage;
+    QMutex mDiskMutex;
+
+    QThreadPool mPool;
+};
+
+class QHR_EXPORT ImageResponse : public QQuickImageResponse
+{
+    Q_OBJECT
+
+public:
+    ImageResponse(ImageTicket* ticket);
+    ~ImageResponse();
+
+    QQuickTextureFactory* textureFactory() const override;
+    QString errorString() const override { return mError; }
+    void cancel() override;
+
+private:
+    void onDone(const QImage& image, const QString& error);
+    void releaseTicket();
+
+private:
+    ImageTicket* mTicket;
+    QImage mImage;
+    QString mError;
+    bool mFinished;
+};
+
+class QHR_EXPORT ImageProvider : public QQuickAsyncImageProvider
+{
+public:
+    static constexpr const char* Id = "qhr";
+
+    ImageProvider(QmlHttpRequest* qhr);
+    ~ImageProvider();
+
+    ImageLoader* loader() const { return mLoader.get(); }
+
+    QQuickImageResponse* requestImageResponse(
+        const QString& id, const QSize& requestedSize) override;
+
+private:
+    std::unique_ptr<ImageLoader> mLoader;
+};
+
+}
+
+#endif // IMAGEPROVIDER_HPP
@@ -0,0 +1,270 @@
+#include "jsonstreamparser.hpp"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include <cstring>
+
+namespace qhr {
+
+static inline bool isJsonSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool isJsonBlank(const char* data, int size)
+{
+    for (int i = 0; i < size; ++i) {
+        if (!isJsonSpace(data[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+ * \class JsonStreamParser
+ * \brief JsonStreamParser class splitting a JSON body into items while it is
+ * received. The body is either a top level JSON array, whose elements are the
+ * items, or newline delimited JSON, whose lines are the items. Only the item
+ * being received is buffered, so memory use depends on the size of an item
+ * and not of the body.
+ *
+ * Parsed items are emitted by \ref itemsParsed() in batches of at most \ref
+ * batchSize items. The parser is meant to live in \ref workerThread() and be
+ * fed through queued connections.
+ */
+
+JsonStreamParser::JsonStreamParser(QObject* parent)
+    : QObject { parent }, mFormat(Detect), mArrayClosed(false),
+      mArrayLength(0), mDepth(0), mInString(false), mEscape(false),
+      mBatchSize(64)
+{
+}
+
+/*!
+ * \brief JsonStreamParser::feed() Parses the next \a chunk of the body.
+ * \param chunk
+ */
+void JsonStreamParser::feed(const QByteArray& chunk)
+{
+    if (!mError.isEmpty()) {
+        return;
+    }
+
+    int from = 0;
+    if (mFormat == Detect) {
+        while (from < chunk.size() && isJsonSpace(chunk[from])) {
+            ++from;
+        }
+        if (from == chunk.size()) {
+            return;
+        }
+        if (chunk[from] == '[') {
+            mFormat = Array;
+            ++from;
+        } else {
+            mFormat = Lines;
+        }
+    }
+
+    if (mFormat == Array) {
+        feedArray(chunk, from);
+    } else {
+        feedLines(chunk, from);
+    }
+    flushItems();
+}
+
+/*!
+ * \brief JsonStreamParser::finish() Parses the rest of the body and emits \ref
+ * finished().
+ */
+void JsonStreamParser::finish()
+{
+    if (mError.isEmpty()) {
+        if (mFormat == Lines) {
+            addItem(mPartial.constData(), mPartial.size());
+            mPartial.clear();
+        } else if (mFormat == Array && !mArrayClosed) {
+            setError("Unexpected end of JSON array");
+        }
+        flushItems();
+    }
+    emit finished(mError);
+}
+
+/*!
+ * \brief JsonStreamParser::feedArray() Scans \a chunk from \a from for the
+ * commas and the bracket ending top level array elements, copying bytes in
+ * spans rather than one by one. Only white space may follow the array.
+ */
+void JsonStreamParser::feedArray(const QByteArray& chunk, int from)
+{
+    const char* data = chunk.constData();
+    int start = from;
+    int i = from;
+
+    for (; i < chunk.size() && !mArrayClosed; ++i) {
+        const char c = data[i];
+        if (mInString) {
+            if (mEscape) {
+                mEscape = false;
+            } else if (c == '\\') {
+                mEscape = true;
+            } else if (c == '"') {
+                mInString = false;
+            }
+            continue;
+        }
+
+        switch (c) {
+        case '"':
+            mInString = true;
+            break;
+        case '{':
+        case '[':
+            ++mDepth;
+            break;
+        case '}':
+            if (mDepth == 0) {
+                // Only a bracket closes the top level array
+                setError("Unexpected '}' in JSON array");
+                break;
+            }
+            --mDepth;
+            break;
+        case ']':
+            if (mDepth > 0) {
+                --mDepth;
+                break;
+            }
+            mArrayClosed = true;
+            Q_FALLTHROUGH();
+        case ',':
+            if (mDepth == 0) {
+                if (mPartial.isEmpty()) {
+                    endElement(data + start, i - start, mArrayClosed);
+                } else {
+                    mPartial.append(data + start, i - start);
+                    endElement(mPartial.constData(), mPartial.size(),
+                        mArrayClosed);
+                    mPartial.clear();
+                }
+                start = i + 1;
+            }
+            break;
+        default:
+            break;
+        }
+
+        if (!mError.isEmpty()) {
+            return;
+        }
+    }
+
+    if (!mArrayClosed) {
+        mPartial.append(data + start, chunk.size() - start);
+    } else if (mError.isEmpty() && !isJsonBlank(data + i, chunk.size() - i)) {
+        setError("Unexpected data after JSON array");
+    }
+}
+
+/*!
+ * \brief JsonStreamParser::endElement() Adds the top level array element of
+ * \a size bytes at \a data, ended by a comma or by the closing bracket when
+ * \a last. An empty element is an error, except the one of an empty array.
+ */
+void JsonStreamParser::endElement(const char* data, int size, bool last)
+{
+    if (isJsonBlank(data, size)) {
+        if (!last || mArrayLength > 0) {
+            setError("Empty element in JSON array");
+        }
+        return;
+    }
+    ++mArrayLength;
+    addItem(data, size);
+}
+
+/*!
+ * \brief JsonStreamParser::feedLines() Splits \a chunk from \a from on new
+ * lines.
+ */
+void JsonStreamParser::feedLines(const QByteArray& chunk, int from)
+{
+    const char* data = chunk.constData();
+    int start = from;
+
+    while (mError.isEmpty()) {
+        const auto newLine = static_cast<const char*>(
+            std::memchr(data + start, '\n', size_t(chunk.size() - start)));
+        if (!newLine) {
+            break;
+        }
+
+        const int end = int(newLine - data);
+        if (mPartial.isEmpty()) {
+            addItem(data + start, end - start);
+        } else {
+            mPartial.append(data + start, end - start);
+            addItem(mPartial.constData(), mPartial.size());
+            mPartial.clear();
+        }
+        start = end + 1;
+    }
+    mPartial.append(data + start, chunk.size() - start);
+}
+
+/*!
+ * \brief JsonStreamParser::addItem() Parses the \a size bytes of one item
+ * starting at \a data. Blank items, like empty lines, are skipped.
+ */
+void JsonStreamParser::addItem(const char* data, int size)
+{
+    while (size > 0 && isJsonSpace(*data)) {
+        ++data;
+        --size;
+    }
+    while (size > 0 && isJsonSpace(data[size - 1])) {
+        --size;
+    }
+    if (size == 0) {
+        return;
+    }
+
+    // Wrapped in an array since a document can not be a scalar in Qt 5
+    QByteArray json;
+    json.reserve(size + 2);
+    json.append('[').append(data, size).append(']');
+
+    QJsonParseError error;
+    const auto document = QJsonDocument::fromJson(json, &error);
+    if (error.error != QJsonParseError::NoError
+        || document.array().size() != 1) {
+        setError(QString("Invalid JSON item: %1").arg(error.errorString()));
+        return;
+    }
+
+    mItems.append(document.array().first().toVariant());
+    if (mItems.size() >= mBatchSize) {
+        flushItems();
+    }
+}
+
+void JsonStreamParser::flushItems()
+{
+    if (!mItems.isEmpty()) {
+        emit itemsParsed(mItems);
+        mItems.clear();
+    }
+}
+
+void JsonStreamParser::setError(const QString& error)
+{
+    mError = error;
+    mItems.clear();
+    mPartial.clear();
+}
+
+}
@@ -0,0 +1,85 @@
+/*!
+ * Copyright (c) 2023 Alireza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef JSONSTREAMPARSER_HPP
+#define JSONSTREAMPARSER_HPP
+
+#include <QObject>
+#include <QVariantList>
+
+#include "qmlhttprequest_global.hpp"
+
+namespace qhr {
+
+class QHR_EXPORT JsonStreamParser : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Format
+    {
+        Detect = 0,
+        Array,
+        Lines,
+    };
+
+    JsonStreamParser(QObject* parent = nullptr);
+
+    void setBatchSize(int size) { mBatchSize = qMax(1, size); }
+    int batchSize() const { return mBatchSize; }
+
+    Format format() const { return mFormat; }
+    QString errorString() const { return mError; }
+
+public slots:
+    void feed(const QByteArray& chunk);
+    void finish();
+
+signals:
+    void itemsParsed(const QVariantList& items);
+    void finished(const QString& error);
+
+private:
+    void feedArray(const QByteArray& chunk, int from);
+    void feedLines(const QByteArray& chunk, int from);
+    void endElement(const char* data, int size, bool last);
+    void addItem(const char* data, int size);
+    void flushItems();
+    void setError(const QString& error);
+
+private:
+    Format mFormat;
+    bool mArrayClosed;
+    int mArrayLength;
+    int mDepth;
+    bool mInString;
+    bool mEscape;
+    int mBatchSize;
+    QByteArray mPartial;
+    QVariantList mItems;
+    QString mError;
+};
+
+}
+
+#endif // JSONSTREAMPARSER_HPP
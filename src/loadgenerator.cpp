@@ -0,0 +1,274 @@
+#include "loadgenerator.hpp"
+#include "qmlhttprequest.hpp"
+#include "replaynetworkaccessmanager.hpp"
+#include "request.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace qhr {
+
+/*!
+ * \class LoadGenerator
+ * \brief LoadGenerator class replaying the requests of a HAR recording through
+ * \ref Request objects, with their client profiles, circuit breakers and
+ * callbacks, against a \ref ReplayNetworkAccessManager instead of the
+ * network. Requests are sent with their recorded spacing divided by \ref rate,
+ * so a rate of 10 drives the client code at ten times the recorded load.
+ *
+ * A replayed request is \ref failed when its status differs from the recorded
+ * one, for instance because a circuit breaker opened or a client queue timed
+ * out under load.
+ */
+
+LoadGenerator::LoadGenerator(QmlHttpRequest* qhr, QObject* parent)
+    : QObject { parent }, mQhr { qhr },
+      mNam(new ReplayNetworkAccessManager(this)), mRate(1.0), mIterations(1),
+      mRunning(false), mNext(0), mIteration(0), mIterationStart(0), mSent(0),
+      mCompleted(0), mFailed(0)
+{
+    mTimer.setSingleShot(true);
+    connect(&mTimer, &QTimer::timeout, this, &LoadGenerator::sendDue);
+}
+
+LoadGenerator::~LoadGenerator()
+{
+    // Requests must not call back into a destroyed generator
+    for (auto it = mInFlight.keyBegin(); it != mInFlight.keyEnd(); ++it) {
+        (*it)->disconnect(this);
+        (*it)->deleteLater();
+    }
+}
+
+/*!
+ * \qmlmethod configure()
+ * \brief LoadGenerator::configure() Updates this generator from \a options.
+ * Supported keys are \a rate, \a latencyScale, \a iterations and \a client.
+ * \param options
+ */
+void LoadGenerator::configure(const QVariantMap& options)
+{
+    if (options.contains("rate")) {
+        setRate(options.value("rate").toDouble());
+    }
+    if (options.contains("latencyScale")) {
+        setLatencyScale(options.value("latencyScale").toDouble());
+    }
+    if (options.contains("iterations")) {
+        setIterations(options.value("iterations").toInt());
+    }
+    if (options.contains("client")) {
+        setClient(options.value("client").toString());
+    }
+}
+
+/*!
+ * \qmlmethod start()
+ * \brief LoadGenerator::start() Starts replaying the HAR file \a harUrl.
+ * \param harUrl
+ * \return False if the file could not be loaded or a run is in progress
+ */
+bool LoadGenerator::start(const QUrl& harUrl)
+{
+    bool ok = false;
+    const auto entries = Recorder::load(Recorder::fileName(harUrl), &ok);
+    return ok && start(entries);
+}
+
+/*!
+ * \brief LoadGenerator::start() Starts replaying \a entries, which are served
+ * by the replay network access manager as well.
+ * \param entries
+ * \return False if \a entries is empty or a run is in progress
+ */
+bool LoadGenerator::start(const QList<Recorder::Entry>& entries)
+{
+    if (mRunning || entries.isEmpty() || !mQhr) {
+        return false;
+    }
+
+    mEntries = entries;
+    std::stable_sort(mEntries.begin(), mEntries.end(),
+        [](const Recorder::Entry& left, const Recorder::Entry& right) {
+            return left.startedDateTime < right.startedDateTime;
+        });
+    mNam->setEntries(mEntries);
+
+    mOffsets.clear();
+    mOffsets.reserve(mEntries.size());
+    const auto first = mEntries.first().startedDateTime;
+    for (const auto& entry : std::as_const(mEntries)) {
+        mOffsets.push_back(qMax(qint64(0), first.msecsTo(entry.startedDateTime)));
+    }
+
+    mLatencies.clear();
+    mSent = 0;
+    mCompleted = 0;
+    mFailed = 0;
+    mNext = 0;
+    mIteration = 0;
+    mIterationStart = 0;
+    mRunning = true;
+    mClock.start();
+
+    emit runningChanged();
+    emit statsChanged();
+    sendDue();
+    return true;
+}
+
+/*!
+ * \qmlmethod stop()
+ * \brief LoadGenerator::stop() Stops sending requests and aborts the ones in
+ * flight.
+ */
+void LoadGenerator::stop()
+{
+    if (!mRunning) {
+        return;
+    }
+
+    mTimer.stop();
+    mNext = int(mOffsets.size());
+    mIteration = mIterations;
+
+    const auto requests = mInFlight.keys();
+    mInFlight.clear();
+    for (auto request : requests) {
+        request->disconnect(this);
+        request->abort();
+        request->deleteLater();
+    }
+    checkFinished();
+}
+
+/*!
+ * \qmlmethod latencyPercentile()
+ * \brief LoadGenerator::latencyPercentile() Returns the \a percentile (0-100)
+ * of the latencies of completed requests in milliseconds, or -1 if none
+ * completed.
+ * \param percentile
+ * \return
+ */
+int LoadGenerator::latencyPercentile(double percentile) const
+{
+    if (mLatencies.empty()) {
+        return -1;
+    }
+
+    auto latencies = mLatencies;
+    const auto rank = size_t(std::ceil(
+        qBound(0.0, percentile, 100.0) / 100.0 * double(latencies.size())));
+    const auto nth = latencies.begin() + qMax(size_t(1), rank) - 1;
+    std::nth_element(latencies.begin(), nth, latencies.end());
+    return *nth;
+}
+
+/*!
+ * \brief LoadGenerator::setRate() Set the multiplier of the recorded request
+ * rate. Default is 1.
+ * \param rate
+ */
+void LoadGenerator::setRate(double rate)
+{
+    mRate = rate > 0 ? rate : 1.0;
+}
+
+/*!
+ * \brief LoadGenerator::setLatencyScale() Set the factor recorded response
+ * latencies are multiplied by. Default is 1.
+ * \see ReplayNetworkAccessManager::setLatencyScale()
+ * \param scale
+ */
+void LoadGenerator::setLatencyScale(double scale)
+{
+    mNam->setLatencyScale(scale);
+}
+
+double LoadGenerator::latencyScale() const
+{
+    return mNam->latencyScale();
+}
+
+qint64 LoadGenerator::dueTime(int index) const
+{
+    return mIterationStart + qint64(double(mOffsets[index]) / mRate);
+}
+
+void LoadGenerator::sendDue()
+{
+    const auto now = mClock.elapsed();
+    while (mNext < int(mOffsets.size()) && dueTime(mNext) <= now) {
+        sendEntry(mNext++);
+    }
+
+    if (mNext == int(mOffsets.size()) && ++mIteration < mIterations) {
+        mNext = 0;
+        mIterationStart = now;
+        sendDue();
+        return;
+    }
+
+    if (mNext < int(mOffsets.size())) {
+        mTimer.start(int(qMax(qint64(0), dueTime(mNext) - now)));
+    } else {
+        checkFinished();
+    }
+}
+
+void LoadGenerator::sendEntry(int index)
+{
+    const auto& entry = mEntries[index];
+
+    auto request = mQhr->newRequest(mClient);
+    request->setAutoRelease(false);
+    request->setNetworkAccessManager(mNam);
+    request->open(QString::fromUtf8(entry.method), entry.url);
+    for (const auto& header : entry.requestHeaders) {
+        if (header.first.compare("Content-Length", Qt::CaseInsensitive) != 0) {
+            request->setRequestHeader(QString::fromUtf8(header.first),
+                QString::fromUtf8(header.second));
+        }
+    }
+
+    mInFlight.insert(request, { index, mClock.elapsed() });
+    connect(request, &Request::finished, this,
+        [this, request]() { onRequestFinished(request); });
+
+    ++mSent;
+    emit statsChanged();
+
+    if (entry.requestBody.isEmpty()) {
+        request->send();
+    } else {
+        request->send(entry.requestBody);
+    }
+}
+
+void LoadGenerator::onRequestFinished(Request* request)
+{
+    const auto sent = mInFlight.take(request);
+    request->disconnect(this);
+    request->deleteLater();
+
+    mLatencies.push_back(int(mClock.elapsed() - sent.second));
+    ++mCompleted;
+    if (request->status() != mEntries[sent.first].status) {
+        ++mFailed;
+    }
+    emit statsChanged();
+
+    checkFinished();
+}
+
+void LoadGenerator::checkFinished()
+{
+    if (mRunning && mNext == int(mOffsets.size()) && mIteration >= mIterations
+        && mInFlight.isEmpty()) {
+        mRunning = false;
+        emit runningChanged();
+        emit finished();
+    }
+}
+
+}
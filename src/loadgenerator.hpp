@@ -0,0 +1,127 @@
+/*!
+ * Copyright (c) 2023 Alireza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef LOADGENERATOR_HPP
+#define LOADGENERATOR_HPP
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QQmlEngine>
+#include <QTimer>
+
+#include <vector>
+
+#include "qmlhttprequest_global.hpp"
+#include "recorder.hpp"
+
+namespace qhr {
+
+class QmlHttpRequest;
+class ReplayNetworkAccessManager;
+class Request;
+
+class QHR_EXPORT LoadGenerator : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("LoadGenerator can not be created from QML, use "
+                    "QmlHttpRequest.loadGenerator() instead")
+    Q_PROPERTY(double   rate            READ rate   WRITE setRate)
+    Q_PROPERTY(double   latencyScale    READ latencyScale
+            WRITE setLatencyScale)
+    Q_PROPERTY(int      iterations      READ iterations WRITE setIterations)
+    Q_PROPERTY(QString  client          READ client WRITE setClient)
+    Q_PROPERTY(bool     running     READ isRunning  NOTIFY runningChanged)
+    Q_PROPERTY(int      sent        READ sent       NOTIFY statsChanged)
+    Q_PROPERTY(int      completed   READ completed  NOTIFY statsChanged)
+    Q_PROPERTY(int      failed      READ failed     NOTIFY statsChanged)
+
+public:
+    LoadGenerator(QmlHttpRequest* qhr, QObject* parent = nullptr);
+    ~LoadGenerator();
+
+    Q_INVOKABLE void configure(const QVariantMap& options);
+    Q_INVOKABLE bool start(const QUrl& harUrl);
+    Q_INVOKABLE void stop();
+    Q_INVOKABLE int latencyPercentile(double percentile) const;
+
+    bool start(const QList<Recorder::Entry>& entries);
+
+    void setRate(double rate);
+    double rate() const { return mRate; }
+
+    void setLatencyScale(double scale);
+    double latencyScale() const;
+
+    void setIterations(int iterations) { mIterations = qMax(1, iterations); }
+    int iterations() const { return mIterations; }
+
+    void setClient(const QString& client) { mClient = client; }
+    QString client() const { return mClient; }
+
+    bool isRunning() const { return mRunning; }
+    int sent() const { return mSent; }
+    int completed() const { return mCompleted; }
+    int failed() const { return mFailed; }
+
+signals:
+    void runningChanged();
+    void statsChanged();
+    void finished();
+
+private:
+    qint64 dueTime(int index) const;
+    void sendDue();
+    void sendEntry(int index);
+    void onRequestFinished(Request* request);
+    void checkFinished();
+
+private:
+    QPointer<QmlHttpRequest> mQhr;
+    ReplayNetworkAccessManager* mNam;
+    QList<Recorder::Entry> mEntries;
+    std::vector<qint64> mOffsets;
+    QHash<Request*, QPair<int, qint64>> mInFlight;
+    std::vector<int> mLatencies;
+
+    double mRate;
+    int mIterations;
+    QString mClient;
+
+    bool mRunning;
+    int mNext;
+    int mIteration;
+    qint64 mIterationStart;
+    int mSent;
+    int mCompleted;
+    int mFailed;
+
+    QTimer mTimer;
+    QElapsedTimer mClock;
+};
+
+}
+
+#endif // LOADGENERATOR_HPP
@@ -0,0 +1,986 @@
+#include "localsocketnetworkaccessmanager.hpp"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QTimer>
+#include <QTimerEvent>
+
+#include <cstring>
+
+namespace qhr {
+
+static constexpr qint64 ChunkSize = 64 * 1024;
+static constexpr qsizetype MaxLineSize = 64 * 1024;
+
+/*!
+ * \class LocalSocketNetworkAccessManager
+ * \brief LocalSocketNetworkAccessManager class speaking HTTP/1.1 over local
+ * sockets, Unix domain sockets or Windows named pipes, to reach local agents
+ * without the cost of loopback TCP. It handles urls of two forms:
+ *
+ * - \a "unix:/run/agent.sock:/v1/status" or \a
+ * "http+unix:///run/agent.sock:/v1/status", the socket path followed by a
+ * colon and the request path
+ * - \a "http+unix://agent/v1/status", the host being the name of the server
+ * as given to \a\b QLocalServer::listen()
+ *
+ * Connections are kept alive and pooled per server, at most \ref
+ * maxConnectionsPerServer of them being open at once. Other urls are handled
+ * by \a\b QNetworkAccessManager.
+ */
+
+LocalSocketNetworkAccessManager::LocalSocketNetworkAccessManager(
+    QObject* parent)
+    : QNetworkAccessManager { parent }, mMaxConnections(6)
+{
+}
+
+/*!
+ * \brief LocalSocketNetworkAccessManager::shared() Returns the manager used by
+ * all requests to local socket urls, created on first use.
+ * \return
+ */
+LocalSocketNetworkAccessManager* LocalSocketNetworkAccessManager::shared()
+{
+    static QPointer<LocalSocketNetworkAccessManager> manager;
+    if (!manager) {
+        manager
+            = new LocalSocketNetworkAccessManager(QCoreApplication::instance());
+    }
+    return manager;
+}
+
+bool LocalSocketNetworkAccessManager::isLocalUrl(const QUrl& url)
+{
+    const auto scheme = url.scheme();
+    return scheme == "unix" || scheme == "http+unix";
+}
+
+/*!
+ * \brief LocalSocketNetworkAccessManager::splitUrl() Splits the local socket
+ * \a url into the name of the server to connect to and the request target,
+ * the encoded path and query sent in the request line.
+ * \param url
+ * \param serverName
+ * \param target
+ * \return False if \a url is not a local socket url
+ */
+bool LocalSocketNetworkAccessManager::splitUrl(
+    const QUrl& url, QString& serverName, QByteArray& target)
+{
+    if (!isLocalUrl(url)) {
+        return false;
+    }
+
+    const auto path = url.path(QUrl::FullyEncoded).toUtf8();
+    if (!url.host().isEmpty()) {
+        serverName = url.host();
+        target = path;
+    } else {
+        const auto colon = path.indexOf(':');
+        serverName = QUrl::fromPercentEncoding(
+            colon < 0 ? path : path.left(colon));
+        target = colon < 0 ? QByteArray() : path.mid(colon + 1);
+    }
+
+    if (!target.startsWith('/')) {
+        target.prepend('/');
+    }
+    if (url.hasQuery()) {
+        target += '?' + url.query(QUrl::FullyEncoded).toUtf8();
+    }
+    return !serverName.isEmpty();
+}
+
+/*!
+ * \brief LocalSocketNetworkAccessManager::resolvedUrl() Resolves the \a
+ * location of a redirect response to the request to \a url. A relative \a
+ * location stays on the same server.
+ * \param url
+ * \param location Value of the \a Location header
+ * \return
+ */
+QUrl LocalSocketNetworkAccessManager::resolvedUrl(
+    const QUrl& url, const QByteArray& location)
+{
+    const auto target = QUrl::fromEncoded(location);
+    if (!target.isRelative()) {
+        return target;
+    }
+
+    QString serverName;
+    QByteArray path;
+    splitUrl(url, serverName, path);
+
+    // Resolved against the request target as a http url would be
+    const auto resolved
+        = QUrl("http://localhost" + QString::fromUtf8(path)).resolved(target);
+
+    QUrl result = url;
+    auto resolvedPath = resolved.path(QUrl::FullyEncoded);
+    if (url.host().isEmpty()) {
+        const auto encodedPath = url.path(QUrl::FullyEncoded);
+        resolvedPath.prepend(encodedPath.left(encodedPath.indexOf(':')) + ':');
+    }
+    result.setPath(resolvedPath, QUrl::TolerantMode);
+    result.setQuery(resolved.hasQuery() ? resolved.query(QUrl::FullyEncoded)
+                                        : QString());
+    return result;
+}
+
+/*!
+ * \brief LocalSocketNetworkAccessManager::setMaxConnectionsPerServer() Set the
+ * number of connections opened at once to the same server. Other requests wait
+ * for one of them to be free. Default is 6.
+ * \param count
+ */
+void LocalSocketNetworkAccessManager::setMaxConnectionsPerServer(int count)
+{
+    mMaxConnections = qMax(1, count);
+}
+
+/*!
+ * \brief LocalSocketNetworkAccessManager::openConnections() Returns the number
+ * of connections to \a serverName, busy or idle.
+ * \param serverName
+ * \return
+ */
+int LocalSocketNetworkAccessManager::openConnections(
+    const QString& serverName) const
+{
+    const auto it = mPools.constFind(serverName);
+    return it == mPools.cend() ? 0 : it->open;
+}
+
+QNetworkReply* LocalSocketNetworkAccessManager::createRequest(
+    Operation op, const QNetworkRequest& request, QIODevice* outgoingData)
+{
+    if (!isLocalUrl(request.url())) {
+        return QNetworkAccessManager::createRequest(op, request, outgoingData);
+    }
+
+    QByteArray method;
+    switch (op) {
+    case HeadOperation:
+        method = "HEAD";
+        break;
+    case GetOperation:
+        method = "GET";
+        break;
+    case PutOperation:
+        method = "PUT";
+        break;
+    case PostOperation:
+        method = "POST";
+        break;
+    case DeleteOperation:
+        method = "DELETE";
+        break;
+    default:
+        method = request.attribute(QNetworkRequest::CustomVerbAttribute)
+                     .toByteArray();
+        break;
+    }
+
+    return new LocalSocketReply(this, op, request, method, outgoingData);
+}
+
+void LocalSocketNetworkAccessManager::timerEvent(QTimerEvent* event)
+{
+    if (event->timerId() != mIdleTimer.timerId()) {
+        QNetworkAccessManager::timerEvent(event);
+        return;
+    }
+
+    const auto now = QDateTime::currentMSecsSinceEpoch();
+    QList<QPair<QString, QLocalSocket*>> expired;
+    bool idle = false;
+    for (auto it = mPools.cbegin(); it != mPools.cend(); ++it) {
+        for (const auto& entry : it->idle) {
+            if (now - entry.since >= IdleTimeout) {
+                expired.append({ it.key(), entry.socket });
+            } else {
+                idle = true;
+            }
+        }
+    }
+
+    for (const auto& entry : std::as_const(expired)) {
+        closeIdle(entry.first, entry.second);
+    }
+    if (!idle) {
+        mIdleTimer.stop();
+    }
+}
+
+/*!
+ * \brief LocalSocketNetworkAccessManager::acquire() Starts \a reply on an idle
+ * connection to its server or on a new one, or queues it if all connections
+ * allowed are busy.
+ * \param reply
+ */
+void LocalSocketNetworkAccessManager::acquire(LocalSocketReply* reply)
+{
+    auto& pool = mPools[reply->serverName()];
+    while (!pool.idle.isEmpty()) {
+        auto socket = pool.idle.takeLast().socket;
+        socket->disconnect(this);
+        if (socket->state() == QLocalSocket::ConnectedState
+            && socket->bytesAvailable() == 0) {
+            reply->start(socket, true);
+            return;
+        }
+        --pool.open;
+        socket->abort();
+        socket->deleteLater();
+    }
+
+    if (pool.open < mMaxConnections) {
+        ++pool.open;
+        reply->start(new QLocalSocket(this), false);
+        return;
+    }
+    pool.waiting.append(reply);
+}
+
+/*!
+ * \brief LocalSocketNetworkAccessManager::release() Hands \a socket over to
+ * the next waiting reply or keeps it idle if it is \a reusable, otherwise
+ * closes it.
+ * \param serverName
+ * \param socket
+ * \param reusable
+ */
+void LocalSocketNetworkAccessManager::release(
+    const QString& serverName, QLocalSocket* socket, bool reusable)
+{
+    auto& pool = mPools[serverName];
+    if (!reusable || socket->state() != QLocalSocket::ConnectedState
+        || socket->bytesAvailable() > 0) {
+        --pool.open;
+        socket->abort();
+        socket->deleteLater();
+        socket = nullptr;
+    }
+
+    while (!pool.waiting.isEmpty()) {
+        auto reply = pool.waiting.takeFirst();
+        if (!reply) {
+            continue;
+        }
+        if (!socket) {
+            ++pool.open;
+            socket = new QLocalSocket(this);
+        }
+        reply->start(socket, socket->state() == QLocalSocket::ConnectedState);
+        return;
+    }
+
+    if (!socket) {
+        if (pool.open == 0) {
+            mPools.remove(serverName);
+        }
+        return;
+    }
+
+    pool.idle.append({ socket, QDateTime::currentMSecsSinceEpoch() });
+    connect(socket, &QLocalSocket::disconnected, this,
+        [this, serverName, socket]() { closeIdle(serverName, socket); });
+    if (!mIdleTimer.isActive()) {
+        mIdleTimer.start(IdleTimeout / 4, this);
+    }
+}
+
+void LocalSocketNetworkAccessManager::dequeue(LocalSocketReply* reply)
+{
+    const auto it = mPools.find(reply->serverName());
+    if (it != mPools.end()) {
+        it->waiting.removeAll(QPointer<LocalSocketReply>(reply));
+    }
+}
+
+void LocalSocketNetworkAccessManager::closeIdle(
+    const QString& serverName, QLocalSocket* socket)
+{
+    const auto it = mPools.find(serverName);
+    if (it == mPools.end()) {
+        return;
+    }
+
+    for (int i = 0; i < it->idle.size(); ++i) {
+        if (it->idle[i].socket == socket) {
+            it->idle.removeAt(i);
+            --it->open;
+            socket->disconnect(this);
+            socket->abort();
+            socket->deleteLater();
+            break;
+        }
+    }
+    if (it->open == 0 && it->waiting.isEmpty()) {
+        mPools.erase(it);
+    }
+}
+
+/*!
+ * \class LocalSocketReply
+ * \brief LocalSocketReply class is a \a\b QNetworkReply created by \ref
+ * LocalSocketNetworkAccessManager that sends its request over a pooled local
+ * socket connection. The body is uploaded in chunks as the socket drains,
+ * with \a Transfer-Encoding: chunked when its size is not known, and the
+ * response is delivered as it arrives. A request sent on a kept alive
+ * connection the server closed meanwhile is retried once on a new one.
+ */
+
+LocalSocketReply::LocalSocketReply(LocalSocketNetworkAccessManager* manager,
+    QNetworkAccessManager::Operation op, const QNetworkRequest& request,
+    const QByteArray& method, QIODevice* outgoingData)
+    : QNetworkReply { manager }, mManager(manager), mOutgoing(outgoingData),
+      mOutgoingStart(outgoingData ? outgoingData->pos() : 0), mMethod(method),
+      mPhase(Phase::Queued), mRequestWritten(false), mReused(false),
+      mRetried(false), mKeepAlive(false), mChunkedUpload(false),
+      mUploadDone(false), mOutgoingFinished(false), mUploaded(0),
+      mUploadTotal(-1), mInputOffset(0), mStatus(0), mRemaining(0),
+      mReceived(0), mDownloadTotal(-1), mBufferOffset(0)
+{
+    setOperation(op);
+    setRequest(request);
+    setUrl(request.url());
+    setAttribute(QNetworkRequest::CustomVerbAttribute, method);
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+
+    if (!LocalSocketNetworkAccessManager::splitUrl(
+            request.url(), mServerName, mTarget)) {
+        QTimer::singleShot(0, this, [this]() {
+            fail(ProtocolUnknownError,
+                QString("Invalid local socket url %1").arg(url().toString()));
+        });
+        return;
+    }
+
+    if (mOutgoing && mOutgoing->isSequential()) {
+        connect(mOutgoing, &QIODevice::readyRead, this,
+            &LocalSocketReply::writeBody);
+        connect(mOutgoing, &QIODevice::readChannelFinished, this, [this]() {
+            mOutgoingFinished = true;
+            writeBody();
+        });
+    }
+
+    // Started once the caller is connected to the signals of this reply
+    QTimer::singleShot(0, this, [this]() {
+        if (mManager && !isFinished()) {
+            mManager->acquire(this);
+        }
+    });
+}
+
+LocalSocketReply::~LocalSocketReply()
+{
+    if (!isFinished()) {
+        releaseSocket(false);
+    }
+}
+
+void LocalSocketReply::abort()
+{
+    if (!isFinished()) {
+        fail(OperationCanceledError, "Operation canceled");
+    }
+}
+
+qint64 LocalSocketReply::bytesAvailable() const
+{
+    return mBuffer.size() - mBufferOffset + QIODevice::bytesAvailable();
+}
+
+qint64 LocalSocketReply::readData(char* data, qint64 maxSize)
+{
+    const qint64 available = mBuffer.size() - mBufferOffset;
+    if (available <= 0) {
+        return isFinished() ? -1 : 0;
+    }
+
+    const auto size = qMin(maxSize, available);
+    std::memcpy(data, mBuffer.constData() + mBufferOffset, size_t(size));
+    mBufferOffset += size;
+    if (mBufferOffset == mBuffer.size()) {
+        mBuffer.clear();
+        mBufferOffset = 0;
+    }
+    return size;
+}
+
+void LocalSocketReply::timerEvent(QTimerEvent* event)
+{
+    if (event->timerId() == mTimeout.timerId()) {
+        fail(TimeoutError, "Transfer timed out");
+        return;
+    }
+    QNetworkReply::timerEvent(event);
+}
+
+/*!
+ * \brief LocalSocketReply::start() Sends the request on \a socket, connecting
+ * it first if needed.
+ * \param socket
+ * \param reused True if \a socket was kept alive from a previous request
+ */
+void LocalSocketReply::start(QLocalSocket* socket, bool reused)
+{
+    mSocket = socket;
+    mReused = reused;
+    mPhase = Phase::StatusLine;
+
+    connect(socket, &QLocalSocket::readyRead, this,
+        &LocalSocketReply::onReadyRead);
+    connect(socket, &QLocalSocket::bytesWritten, this,
+        &LocalSocketReply::writeBody);
+    connect(socket, &QLocalSocket::disconnected, this,
+        &LocalSocketReply::onDisconnected);
+    connect(socket, &QLocalSocket::errorOccurred, this,
+        &LocalSocketReply::onSocketError);
+
+    restartTimeout();
+    if (socket->state() == QLocalSocket::ConnectedState) {
+        writeRequest();
+    } else {
+        connect(socket, &QLocalSocket::connected, this,
+            &LocalSocketReply::writeRequest);
+        socket->connectToServer(mServerName);
+    }
+}
+
+void LocalSocketReply::writeRequest()
+{
+    disconnect(mSocket, &QLocalSocket::connected, this,
+        &LocalSocketReply::writeRequest);
+
+    const auto req = request();
+    QByteArray head = mMethod + ' ' + mTarget + " HTTP/1.1\r\n"
+        + "Host: localhost\r\n";
+    for (const auto& name : req.rawHeaderList()) {
+        if (name.compare("Host", Qt::CaseInsensitive) == 0
+            || name.compare("Content-Length", Qt::CaseInsensitive) == 0
+            || name.compare("Transfer-Encoding", Qt::CaseInsensitive) == 0) {
+            continue;
+        }
+        head += name + ": " + req.rawHeader(name) + "\r\n";
+    }
+
+    mUploadTotal = -1;
+    if (mOutgoing) {
+        const auto length = req.header(QNetworkRequest::ContentLengthHeader);
+        if (length.isValid()) {
+            mUploadTotal = length.toLongLong();
+        } else if (!mOutgoing->isSequential()) {
+            mUploadTotal = mOutgoing->size() - mOutgoingStart;
+        }
+        mChunkedUpload = mUploadTotal < 0;
+        head += mChunkedUpload
+            ? QByteArray("Transfer-Encoding: chunked\r\n")
+            : "Content-Length: " + QByteArray::number(mUploadTotal) + "\r\n";
+    } else if (mMethod.compare("POST", Qt::CaseInsensitive) == 0
+        || mMethod.compare("PUT", Qt::CaseInsensitive) == 0
+        || mMethod.compare("PATCH", Qt::CaseInsensitive) == 0) {
+        head += "Content-Length: 0\r\n";
+    }
+    head += "\r\n";
+
+    mSocket->write(head);
+    mRequestWritten = true;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+    emit requestSent();
+#endif
+    mUploadDone = !mOutgoing;
+    writeBody();
+}
+
+/*!
+ * \brief LocalSocketReply::writeBody() Writes the next chunks of the body
+ * while less than four of them are waiting to be written to the socket.
+ */
+void LocalSocketReply::writeBody()
+{
+    if (!mSocket || !mRequestWritten || mUploadDone || !mOutgoing) {
+        return;
+    }
+
+    while (mSocket->bytesToWrite() < 4 * ChunkSize) {
+        auto size = ChunkSize;
+        if (mUploadTotal >= 0) {
+            size = qMin(size, mUploadTotal - mUploaded);
+        }
+        const auto chunk = size > 0 ? mOutgoing->read(size) : QByteArray();
+
+        if (chunk.isEmpty()) {
+            const bool end = mUploadTotal >= 0 ? mUploaded >= mUploadTotal
+                : mOutgoing->isSequential()     ? mOutgoingFinished
+                                                : mOutgoing->atEnd();
+            if (!end) {
+                if (!mOutgoing->isSequential()) {
+                    fail(UnknownContentError, "Cannot read the body to upload");
+                }
+                // Otherwise written once more of the body is ready
+                return;
+            }
+            if (mChunkedUpload) {
+                mSocket->write("0\r\n\r\n");
+            }
+            mUploadDone = true;
+            emit uploadProgress(mUploaded, mUploaded);
+            return;
+        }
+
+        if (mChunkedUpload) {
+            mSocket->write(QByteArray::number(chunk.size(), 16) + "\r\n");
+            mSocket->write(chunk);
+            mSocket->write("\r\n");
+        } else {
+            mSocket->write(chunk);
+        }
+        mUploaded += chunk.size();
+        emit uploadProgress(mUploaded, mUploadTotal);
+        restartTimeout();
+    }
+}
+
+/*!
+ * \brief LocalSocketReply::onReadyRead() Parses the response received so far
+ * and delivers its body as it arrives.
+ */
+void LocalSocketReply::onReadyRead()
+{
+    if (!mSocket || isFinished()) {
+        return;
+    }
+
+    mInput.append(mSocket->readAll());
+    restartTimeout();
+
+    const auto received = mReceived;
+    QByteArray line;
+    bool more = true;
+    while (more && mPhase != Phase::Done) {
+        switch (mPhase) {
+        case Phase::StatusLine:
+            more = readLine(line);
+            // Empty lines before the status line are tolerated
+            if (more && !line.isEmpty() && !parseStatusLine(line)) {
+                fail(ProtocolFailure, "Invalid HTTP status line");
+                return;
+            }
+            break;
+        case Phase::Headers:
+            more = readLine(line);
+            if (more && line.isEmpty()) {
+                headersReceived();
+            } else if (more) {
+                parseHeaderLine(line);
+            }
+            break;
+        case Phase::Body: {
+            auto size = mInput.size() - mInputOffset;
+            if (mRemaining >= 0) {
+                size = qMin<qint64>(size, mRemaining);
+            }
+            more = size > 0;
+            appendBody(size);
+            if (mRemaining == 0) {
+                mPhase = Phase::Done;
+            }
+            break;
+        }
+        case Phase::ChunkSize: {
+            more = readLine(line);
+            if (!more) {
+                break;
+            }
+            bool ok = false;
+            mRemaining = line.split(';').first().trimmed().toLongLong(&ok, 16);
+            if (!ok || mRemaining < 0) {
+                fail(ProtocolFailure, "Invalid chunk size");
+                return;
+            }
+            mPhase = mRemaining > 0 ? Phase::ChunkData : Phase::Trailers;
+            break;
+        }
+        case Phase::ChunkData: {
+            const auto size
+                = qMin<qint64>(mInput.size() - mInputOffset, mRemaining);
+            appendBody(size);
+            more = mRemaining == 0;
+            if (more) {
+                mPhase = Phase::ChunkEnd;
+            }
+            break;
+        }
+        case Phase::ChunkEnd:
+            more = readLine(line);
+            if (more) {
+                mPhase = Phase::ChunkSize;
+            }
+            break;
+        case Phase::Trailers:
+            more = readLine(line);
+            if (more && line.isEmpty()) {
+                mPhase = Phase::Done;
+            }
+            break;
+        default:
+            more = false;
+            break;
+        }
+    }
+
+    mInput.remove(0, mInputOffset);
+    mInputOffset = 0;
+    if (mPhase != Phase::Body && mPhase != Phase::ChunkData
+        && mInput.size() > MaxLineSize) {
+        fail(ProtocolFailure, "HTTP header line too long");
+        return;
+    }
+
+    if (mReceived != received) {
+        emit downloadProgress(mReceived, mDownloadTotal);
+        emit readyRead();
+    }
+    if (mPhase == Phase::Done && !isFinished()) {
+        complete();
+    }
+}
+
+void LocalSocketReply::onDisconnected()
+{
+    if (!mSocket || isFinished()) {
+        return;
+    }
+    if (mSocket->bytesAvailable() > 0) {
+        onReadyRead();
+        if (isFinished()) {
+            return;
+        }
+    }
+
+    if (mPhase == Phase::Body && mRemaining < 0) {
+        // The body of a response without a length ends with the connection
+        mPhase = Phase::Done;
+        complete();
+    } else if (canRetry()) {
+        retry();
+    } else {
+        fail(RemoteHostClosedError, "Connection closed by the local server");
+    }
+}
+
+void LocalSocketReply::onSocketError(QLocalSocket::LocalSocketError error)
+{
+    if (!mSocket || isFinished()) {
+        return;
+    }
+
+    switch (error) {
+    case QLocalSocket::PeerClosedError:
+        // Handled by onDisconnected()
+        return;
+    case QLocalSocket::ServerNotFoundError:
+        fail(HostNotFoundError, mSocket->errorString());
+        return;
+    case QLocalSocket::ConnectionRefusedError:
+        fail(ConnectionRefusedError, mSocket->errorString());
+        return;
+    case QLocalSocket::SocketAccessError:
+        fail(ContentAccessDenied, mSocket->errorString());
+        return;
+    case QLocalSocket::SocketTimeoutError:
+        fail(TimeoutError, mSocket->errorString());
+        return;
+    default:
+        if (canRetry()) {
+            retry();
+        } else {
+            fail(UnknownNetworkError, mSocket->errorString());
+        }
+        return;
+    }
+}
+
+bool LocalSocketReply::readLine(QByteArray& line)
+{
+    const auto end = mInput.indexOf("\r\n", mInputOffset);
+    if (end < 0) {
+        return false;
+    }
+    line = mInput.mid(mInputOffset, end - mInputOffset);
+    mInputOffset = end + 2;
+    return true;
+}
+
+bool LocalSocketReply::parseStatusLine(const QByteArray& line)
+{
+    if (!line.startsWith("HTTP/1.")) {
+        return false;
+    }
+
+    const auto first = line.indexOf(' ');
+    auto second = line.indexOf(' ', first + 1);
+    if (first < 0) {
+        return false;
+    }
+    if (second < 0) {
+        second = line.size();
+    }
+
+    bool ok = false;
+    mStatus = line.mid(first + 1, second - first - 1).toInt(&ok);
+    if (!ok || mStatus < 100) {
+        return false;
+    }
+    mReason = line.mid(second + 1);
+    // An HTTP/1.0 server closes the connection unless told otherwise
+    mKeepAlive = line.startsWith("HTTP/1.1");
+    mHeaders.clear();
+    mPhase = Phase::Headers;
+    return true;
+}
+
+void LocalSocketReply::parseHeaderLine(const QByteArray& line)
+{
+    if ((line.startsWith(' ') || line.startsWith('\t')) && !mHeaders.isEmpty()) {
+        // Obsolete line folding
+        mHeaders.last().second += ' ' + line.trimmed();
+        return;
+    }
+
+    const auto colon = line.indexOf(':');
+    if (colon <= 0) {
+        return;
+    }
+    const auto name = line.left(colon).trimmed();
+    const auto value = line.mid(colon + 1).trimmed();
+    for (auto& header : mHeaders) {
+        if (header.first.compare(name, Qt::CaseInsensitive) == 0) {
+            header.second += ", " + value;
+            return;
+        }
+    }
+    mHeaders.append({ name, value });
+}
+
+/*!
+ * \brief LocalSocketReply::headersReceived() Publishes the status and headers
+ * of the response and finds out how its body is delimited. Interim responses
+ * are skipped.
+ */
+void LocalSocketReply::headersReceived()
+{
+    if (mStatus == 101) {
+        fail(ProtocolFailure, "Protocol upgrade is not supported");
+        return;
+    }
+    if (mStatus < 200) {
+        mPhase = Phase::StatusLine;
+        return;
+    }
+
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, mStatus);
+    setAttribute(QNetworkRequest::HttpReasonPhraseAttribute, mReason);
+
+    QByteArray connection;
+    QByteArray transferEncoding;
+    qint64 length = -1;
+    for (const auto& header : std::as_const(mHeaders)) {
+        setRawHeader(header.first, header.second);
+
+        const auto name = header.first.toLower();
+        if (name == "connection") {
+            connection = header.second.toLower();
+        } else if (name == "transfer-encoding") {
+            transferEncoding = header.second.toLower();
+        } else if (name == "content-length") {
+            bool ok = false;
+            length = header.second.toLongLong(&ok);
+            if (!ok) {
+                length = -1;
+            }
+        }
+    }
+
+    if (connection.contains("close")) {
+        mKeepAlive = false;
+    } else if (connection.contains("keep-alive")) {
+        mKeepAlive = true;
+    }
+
+    const auto location = rawHeader("Location");
+    if (mStatus >= 300 && mStatus < 400 && !location.isEmpty()) {
+        setAttribute(QNetworkRequest::RedirectionTargetAttribute,
+            LocalSocketNetworkAccessManager::resolvedUrl(url(), location));
+    }
+
+    mDownloadTotal = -1;
+    if (mMethod.compare("HEAD", Qt::CaseInsensitive) == 0 || mStatus == 204
+        || mStatus == 304) {
+        mPhase = Phase::Done;
+    } else if (transferEncoding.contains("chunked")) {
+        mPhase = Phase::ChunkSize;
+    } else if (length >= 0) {
+        mDownloadTotal = length;
+        mRemaining = length;
+        mPhase = length > 0 ? Phase::Body : Phase::Done;
+    } else {
+        mRemaining = -1;
+        mKeepAlive = false;
+        mPhase = Phase::Body;
+    }
+
+    emit metaDataChanged();
+}
+
+void LocalSocketReply::appendBody(qint64 size)
+{
+    if (size <= 0) {
+        return;
+    }
+    mBuffer.append(mInput.constData() + mInputOffset, size);
+    mInputOffset += size;
+    mReceived += size;
+    if (mRemaining > 0) {
+        mRemaining -= size;
+    }
+}
+
+void LocalSocketReply::complete()
+{
+    mTimeout.stop();
+    releaseSocket(mKeepAlive && mUploadDone && mInput.isEmpty());
+
+    if (mStatus >= 400) {
+        const auto error = statusError(mStatus);
+        setError(error,
+            QString("Error transferring %1 - server replied: %2")
+                .arg(url().toString(), QString::fromUtf8(mReason)));
+        emit errorOccurred(error);
+    }
+    setFinished(true);
+    emit finished();
+}
+
+void LocalSocketReply::fail(NetworkError error, const QString& errorString)
+{
+    if (isFinished()) {
+        return;
+    }
+
+    mPhase = Phase::Done;
+    mTimeout.stop();
+    releaseSocket(false);
+
+    mBuffer.clear();
+    mBufferOffset = 0;
+    setError(error, errorString);
+    setFinished(true);
+    emit errorOccurred(error);
+    emit finished();
+}
+
+/*!
+ * \brief LocalSocketReply::canRetry() Checks whether the request can be sent
+ * again after its kept alive connection failed before any response.
+ * \return
+ */
+bool LocalSocketReply::canRetry() const
+{
+    return mReused && !mRetried && mManager && mPhase == Phase::StatusLine
+        && mStatus == 0 && mInput.isEmpty()
+        && (!mOutgoing || !mOutgoing->isSequential() || mUploaded == 0);
+}
+
+void LocalSocketReply::retry()
+{
+    auto socket = mSocket.data();
+    mSocket = nullptr;
+    socket->disconnect(this);
+    mManager->release(mServerName, socket, false);
+
+    mRetried = true;
+    mPhase = Phase::Queued;
+    mRequestWritten = false;
+    mUploaded = 0;
+    mUploadDone = false;
+    if (mOutgoing && !mOutgoing->isSequential()) {
+        mOutgoing->seek(mOutgoingStart);
+    }
+    mManager->acquire(this);
+}
+
+void LocalSocketReply::releaseSocket(bool reusable)
+{
+    if (mOutgoing) {
+        mOutgoing->disconnect(this);
+    }
+
+    if (!mSocket) {
+        if (mManager) {
+            mManager->dequeue(this);
+        }
+        return;
+    }
+
+    auto socket = mSocket.data();
+    mSocket = nullptr;
+    socket->disconnect(this);
+    if (mManager) {
+        mManager->release(mServerName, socket, reusable);
+    } else {
+        socket->abort();
+        socket->deleteLater();
+    }
+}
+
+/*!
+ * \brief LocalSocketReply::restartTimeout() Restarts the transfer timeout of
+ * the request, or of the manager if the request has none, on any progress.
+ */
+void LocalSocketReply::restartTimeout()
+{
+    int timeout = request().transferTimeout();
+    if (timeout == 0 && mManager) {
+        timeout = mManager->transferTimeout();
+    }
+    if (timeout > 0) {
+        mTimeout.start(timeout, this);
+    }
+}
+
+QNetworkReply::NetworkError LocalSocketReply::statusError(int status)
+{
+    switch (status) {
+    case 400:
+        return ProtocolInvalidOperationError;
+    case 401:
+        return AuthenticationRequiredError;
+    case 403:
+        return ContentAccessDenied;
+    case 404:
+        return ContentNotFoundError;
+    case 405:
+        return ContentOperationNotPermittedError;
+    case 407:
+        return ProxyAuthenticationRequiredError;
+    case 409:
+        return ContentConflictError;
+    case 410:
+        return ContentGoneError;
+    case 500:
+        return InternalServerError;
+    case 501:
+        return OperationNotImplementedError;
+    case 503:
+        return ServiceUnavailableError;
+    default:
+        return status >= 500 ? UnknownServerError : UnknownContentError;
+    }
+}
+
+}
@@ -0,0 +1,188 @@
+/*!
+ * Copyright (c) 2023 Alireza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef LOCALSOCKETNETWORKACCESSMANAGER_HPP
+#define LOCALSOCKETNETWORKACCESSMANAGER_HPP
+
+#include <QBasicTimer>
+#include <QHash>
+#include <QLocalSocket>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QPointer>
+
+#include "qmlhttprequest_global.hpp"
+
+namespace qhr {
+
+class LocalSocketReply;
+
+class QHR_EXPORT LocalSocketNetworkAccessManager : public QNetworkAccessManager
+{
+    Q_OBJECT
+
+public:
+    //! Time an idle keep-alive connection is kept open, in milliseconds
+    static constexpr int IdleTimeout = 30000;
+
+    LocalSocketNetworkAccessManager(QObject* parent = nullptr);
+
+    static LocalSocketNetworkAccessManager* shared();
+
+    static bool isLocalUrl(const QUrl& url);
+    static bool splitUrl(const QUrl& url, QString& serverName, QByteArray& target);
+    static QUrl resolvedUrl(const QUrl& url, const QByteArray& location);
+
+    void setMaxConnectionsPerServer(int count);
+    int maxConnectionsPerServer() const { return mMaxConnections; }
+
+    int openConnections(const QString& serverName) const;
+
+protected:
+    QNetworkReply* createRequest(Operation op, const QNetworkRequest& request,
+        QIODevice* outgoingData = nullptr) override;
+
+    void timerEvent(QTimerEvent* event) override;
+
+private:
+    struct IdleSocket
+    {
+        QLocalSocket* socket;
+        qint64 since;
+    };
+
+    struct Pool
+    {
+        int open = 0;
+        QList<IdleSocket> idle;
+        QList<QPointer<LocalSocketReply>> waiting;
+    };
+
+    void acquire(LocalSocketReply* reply);
+    void release(const QString& serverName, QLocalSocket* socket, bool reusable);
+    void dequeue(LocalSocketReply* reply);
+    void closeIdle(const QString& serverName, QLocalSocket* socket);
+
+private:
+    QHash<QString, Pool> mPools;
+    QBasicTimer mIdleTimer;
+    int mMaxConnections;
+
+    friend class LocalSocketReply;
+};
+
+class QHR_EXPORT LocalSocketReply : public QNetworkReply
+{
+    Q_OBJECT
+
+public:
+    LocalSocketReply(LocalSocketNetworkAccessManager* manager,
+        QNetworkAccessManager::Operation op, const QNetworkRequest& request,
+        const QByteArray& method, QIODevice* outgoingData);
+    ~LocalSocketReply() override;
+
+    void abort() override;
+    qint64 bytesAvailable() const override;
+    bool isSequential() const override { return true; }
+
+    QString serverName() const { return mServerName; }
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    void timerEvent(QTimerEvent* event) override;
+
+private:
+    enum class Phase
+    {
+        Queued,
+        StatusLine,
+        Headers,
+        Body,
+        ChunkSize,
+        ChunkData,
+        ChunkEnd,
+        Trailers,
+        Done,
+    };
+
+    void start(QLocalSocket* socket, bool reused);
+    void writeRequest();
+    void writeBody();
+    void onReadyRead();
+    void onDisconnected();
+    void onSocketError(QLocalSocket::LocalSocketError error);
+
+    bool readLine(QByteArray& line);
+    bool parseStatusLine(const QByteArray& line);
+    void parseHeaderLine(const QByteArray& line);
+    void headersReceived();
+    void appendBody(qint64 size);
+
+    void complete();
+    void fail(NetworkError error, const QString& errorString);
+    bool canRetry() const;
+    void retry();
+    void releaseSocket(bool reusable);
+    void restartTimeout();
+
+    static NetworkError statusError(int status);
+
+private:
+    QPointer<LocalSocketNetworkAccessManager> mManager;
+    QPointer<QLocalSocket> mSocket;
+    QPointer<QIODevice> mOutgoing;
+    qint64 mOutgoingStart;
+    QString mServerName;
+    QByteArray mTarget;
+    QByteArray mMethod;
+
+    Phase mPhase;
+    bool mRequestWritten;
+    bool mReused;
+    bool mRetried;
+    bool mKeepAlive;
+    bool mChunkedUpload;
+    bool mUploadDone;
+    bool mOutgoingFinished;
+    qint64 mUploaded;
+    qint64 mUploadTotal;
+
+    QByteArray mInput;
+    qsizetype mInputOffset;
+    QList<QPair<QByteArray, QByteArray>> mHeaders;
+    int mStatus;
+    QByteArray mReason;
+    qint64 mRemaining;
+    qint64 mReceived;
+    qint64 mDownloadTotal;
+
+    QByteArray mBuffer;
+    qsizetype mBufferOffset;
+    QBasicTimer mTimeout;
+
+    friend class LocalSocketNetworkAccessManager;
+};
+
+}
+
+#endif // LOCALSOCKETNETWORKACCESSMANAGER_HPP
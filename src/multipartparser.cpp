@@ -0,0 +1,279 @@
+#include "multipartparser.hpp"
+
+#include <cstring>
+
+namespace qhr {
+
+/*!
+ * \class MultipartParser
+ * \brief MultipartParser class splitting a \a multipart/mixed or \a
+ * multipart/byteranges body into parts while it is received. Boundaries are
+ * searched with \a memchr, vectorized by the C library, and each finished part
+ * refers to the received bytes instead of copying them. Bytes are only copied
+ * when a part is finished, and only the start of the next part is.
+ */
+
+MultipartParser::MultipartParser(const QByteArray& boundary)
+    : mDelimiter("\r\n--" + boundary), mBuffer("\r\n"),
+      mState(State::Preamble), mPos(0), mPartBegin(0), mHeadersEnd(0),
+      mBodyBegin(0), mIndex(0)
+{
+    // The first delimiter may start the body, it is found after a line break
+    // like the others thanks to the one the buffer starts with
+}
+
+/*!
+ * \brief MultipartParser::boundary() Returns the \a boundary parameter of \a
+ * contentType if it is a multipart type.
+ * \param contentType
+ * \return The boundary, or an empty array
+ */
+QByteArray MultipartParser::boundary(const QByteArray& contentType)
+{
+    const auto params = contentType.split(';');
+    if (!params.first().trimmed().toLower().startsWith("multipart/")) {
+        return QByteArray();
+    }
+
+    for (int i = 1; i < params.size(); ++i) {
+        const auto param = params[i].trimmed();
+        if (param.size() > 9 && param.left(9).toLower() == "boundary=") {
+            auto value = param.mid(9).trimmed();
+            if (value.size() >= 2 && value.startsWith('"')
+                && value.endsWith('"')) {
+                value = value.mid(1, value.size() - 2);
+            }
+            // RFC 2046 limits boundaries to 70 characters
+            return value.size() <= 70 ? value : QByteArray();
+        }
+    }
+    return QByteArray();
+}
+
+/*!
+ * \brief MultipartParser::find() Returns the index of \a needle in \a
+ * haystack at or after \a from. Candidates are found with \a memchr on the
+ * last byte of \a needle, which for a delimiter is the last byte of the
+ * boundary, rare in most bodies, and only those are compared.
+ * \param haystack
+ * \param needle
+ * \param from
+ * \return The index, or -1 if not found
+ */
+qsizetype MultipartParser::find(
+    const QByteArray& haystack, const QByteArray& needle, qsizetype from)
+{
+    const auto data = haystack.constData();
+    const auto size = haystack.size();
+    const auto last = needle.size() - 1;
+
+    for (auto pos = qMax<qsizetype>(0, from) + last; pos < size;) {
+        const auto hit = static_cast<const char*>(
+            std::memchr(data + pos, needle[last], size_t(size - pos)));
+        if (!hit) {
+            return -1;
+        }
+
+        const auto start = hit - data - last;
+        if (std::memcmp(data + start, needle.constData(), size_t(last)) == 0) {
+            return start;
+        }
+        pos = hit - data + 1;
+    }
+    return -1;
+}
+
+/*!
+ * \brief MultipartParser::feed() Parses \a chunk, the next bytes of the body.
+ * The parts it finishes are returned by \ref takeParts().
+ * \param chunk
+ */
+void MultipartParser::feed(const QByteArray& chunk)
+{
+    if (mState == State::Epilogue) {
+        return;
+    }
+
+    mBuffer.append(chunk);
+    const auto parts = mParts.size();
+    while (parseNext()) {
+    }
+
+    if (mParts.size() != parts || mState == State::Preamble) {
+        compact();
+    }
+}
+
+/*!
+ * \brief MultipartParser::takeParts() Returns the parts finished since the
+ * last call.
+ * \return
+ */
+QList<MultipartParser::Part> MultipartParser::takeParts()
+{
+    QList<Part> parts;
+    parts.swap(mParts);
+    return parts;
+}
+
+/*!
+ * \brief MultipartParser::parseNext() Moves to the next state if the buffer
+ * holds enough bytes for it.
+ * \return False when more bytes are needed
+ */
+bool MultipartParser::parseNext()
+{
+    switch (mState) {
+    case State::Preamble:
+    case State::Body: {
+        const auto index = find(mBuffer, mDelimiter, mPos);
+        if (index < 0) {
+            // The delimiter may have started at the end of the buffer
+            mPos = qMax(mPos, mBuffer.size() - mDelimiter.size() + 1);
+            return false;
+        }
+
+        // A delimiter is followed by "--" when closing, otherwise by optional
+        // transport padding and a line break
+        auto after = index + mDelimiter.size();
+        if (mBuffer.size() - after < 2) {
+            mPos = index;
+            return false;
+        }
+        const bool closing
+            = mBuffer.at(after) == '-' && mBuffer.at(after + 1) == '-';
+        if (!closing) {
+            while (after < mBuffer.size()
+                && (mBuffer.at(after) == ' ' || mBuffer.at(after) == '\t')) {
+                ++after;
+            }
+            if (mBuffer.size() - after < 2) {
+                mPos = index;
+                return false;
+            }
+            if (mBuffer.at(after) != '\r' || mBuffer.at(after + 1) != '\n') {
+                // Only looks like a delimiter
+                mPos = index + 1;
+                return true;
+            }
+        }
+
+        if (mState == State::Body) {
+            Part part;
+            part.index = mIndex++;
+            part.buffer = mBuffer;
+            part.headersBegin = qMin(mPartBegin, mHeadersEnd);
+            part.headersEnd = mHeadersEnd;
+            part.bodyBegin = mBodyBegin;
+            part.bodyEnd = qMax(index, mBodyBegin);
+            mParts.append(part);
+        }
+
+        if (closing) {
+            // The epilogue is ignored
+            mState = State::Epilogue;
+            mBuffer.clear();
+            mPos = 0;
+            return false;
+        }
+        mPartBegin = after + 2;
+        mPos = after;
+        mState = State::Headers;
+        return true;
+    }
+    case State::Headers: {
+        // Searched from the line break ending the delimiter so a part without
+        // headers is found too
+        const auto index = find(mBuffer, "\r\n\r\n", mPos);
+        if (index < 0) {
+            mPos = qMax(mPos, mBuffer.size() - 3);
+            return false;
+        }
+        mHeadersEnd = index;
+        mBodyBegin = index + 4;
+        // Some senders end an empty body with the line break of the headers
+        mPos = mBodyBegin - 2;
+        mState = State::Body;
+        return true;
+    }
+    case State::Epilogue:
+        return false;
+    }
+    return false;
+}
+
+/*!
+ * \brief MultipartParser::compact() Drops the bytes before the part being
+ * received. The buffer is shared with the finished parts, so this copies the
+ * received start of the next part only.
+ */
+void MultipartParser::compact()
+{
+    const auto drop = mState == State::Headers || mState == State::Body
+        ? qMin(mPos, mPartBegin)
+        : mPos;
+    if (drop <= 0) {
+        return;
+    }
+
+    mBuffer = mBuffer.mid(drop);
+    mPos -= drop;
+    mPartBegin -= drop;
+    mHeadersEnd -= drop;
+    mBodyBegin -= drop;
+}
+
+/*!
+ * \brief MultipartParser::Part::rawHeaders() Returns the header lines of this
+ * part. It refers to \ref buffer and is only valid while this part is.
+ * \return
+ */
+QByteArray MultipartParser::Part::rawHeaders() const
+{
+    return QByteArray::fromRawData(
+        buffer.constData() + headersBegin, int(headersEnd - headersBegin));
+}
+
+QList<QPair<QByteArray, QByteArray>> MultipartParser::Part::headers() const
+{
+    QList<QPair<QByteArray, QByteArray>> headers;
+    const auto lines = rawHeaders().split('\n');
+    for (const auto& line : lines) {
+        const auto colon = line.indexOf(':');
+        if (colon > 0) {
+            headers.append(
+                { line.left(colon).trimmed(), line.mid(colon + 1).trimmed() });
+        }
+    }
+    return headers;
+}
+
+/*!
+ * \brief MultipartParser::Part::header() Returns the value of the header \a
+ * name, compared case insensitively.
+ * \param name
+ * \return
+ */
+QByteArray MultipartParser::Part::header(const QByteArray& name) const
+{
+    const auto all = headers();
+    for (const auto& header : all) {
+        if (header.first.compare(name, Qt::CaseInsensitive) == 0) {
+            return header.second;
+        }
+    }
+    return QByteArray();
+}
+
+/*!
+ * \brief MultipartParser::Part::body() Returns the body of this part. It
+ * refers to \ref buffer and is only valid while this part is.
+ * \return
+ */
+QByteArray MultipartParser::Part::body() const
+{
+    return QByteArray::fromRawData(
+        buffer.constData() + bodyBegin, int(bodyEnd - bodyBegin));
+}
+
+}
@@ -0,0 +1,97 @@
+/*!
+ * Copyright (c) 2023 Alireza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#ifndef MULTIPARTPARSER_HPP
+#define MULTIPARTPARSER_HPP
+
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+#include <QString>
+
+#include "qmlhttprequest_global.hpp"
+
+namespace qhr {
+
+class QHR_EXPORT MultipartParser
+{
+public:
+    /*!
+     * \brief A part of a multipart body. Its headers and body are ranges of
+     * \a buffer, which is shared with the parser and not copied.
+     */
+    struct Part
+    {
+        int index = 0;
+        QByteArray buffer;
+        qsizetype headersBegin = 0;
+        qsizetype headersEnd = 0;
+        qsizetype bodyBegin = 0;
+        qsizetype bodyEnd = 0;
+
+        QByteArray rawHeaders() const;
+        QList<QPair<QByteArray, QByteArray>> headers() const;
+        QByteArray header(const QByteArray& name) const;
+        QByteArray body() const;
+    };
+
+    explicit MultipartParser(const QByteArray& boundary);
+
+    static QByteArray boundary(const QByteArray& contentType);
+    static qsizetype find(
+        const QByteArray& haystack, const QByteArray& needle, qsizetype from);
+
+    void feed(const QByteArray& chunk);
+    QList<Part> takeParts();
+
+    bool isComplete() const { return mState == State::Epilogue; }
+    int partCount() const { return mIndex; }
+
+private:
+    enum class State
+    {
+        Preamble,
+        Headers,
+        Body,
+        Epilogue,
+    };
+
+    bool parseNext();
+    void compact();
+
+private:
+    QByteArray mDelimiter;
+    QByteArray mBuffer;
+    State mState;
+    qsizetype mPos;
+    qsizetype mPartBegin;
+    qsizetype mHeadersEnd;
+    qsizetype mBodyBegin;
+    int mIndex;
+    QList<Part> mParts;
+};
+
+}
+
+#endif // MULTIPARTPARSER_HPP
@@ -1,6 +1,12 @@
 #include "qmlhttprequest.hpp"
+#include "imageprovider.hpp"
+#include "replaynetworkaccessmanager.hpp"
 #include "request.hpp"
 
+#include <QFile>
+
+#include <utility>
+
 #include "config.hpp"
 
 namespace qhr {
@@ -19,6 +25,7 @@ void QmlHttpRequest::registerQmlHttpRequest()
         [](QQmlEngine* engine, QJSEngine* script) -> QmlHttpRequest* {
             if (auto engineNam = engine->networkAccessManager()) {
                 auto instance = new QmlHttpRequest(engineNam);
+                instance->installImageProvider(engine);
 
                 QQmlEngine::setObjectOwnership(
                     instance, QQmlEngine::JavaScriptOwnership);
@@ -29,6 +36,22 @@ void QmlHttpRequest::registerQmlHttpRequest()
     qmlRegisterUncreatableType<qhr::Request>("QmlHttpRequest",
         PROJECT_VERSION_MAJOR, PROJECT_VERSION_MINOR, "Request",
         "Request can not be created from QML");
+    qmlRegisterUncreatableType<qhr::Client>("QmlHttpRequest",
+        PROJECT_VERSION_MAJOR, PROJECT_VERSION_MINOR, "Client",
+        "Client can not be created from QML, use QmlHttpRequest.client() "
+        "instead");
+    qmlRegisterUncreatableType<qhr::CircuitBreaker>("QmlHttpRequest",
+        PROJECT_VERSION_MAJOR, PROJECT_VERSION_MINOR, "CircuitBreaker",
+        "CircuitBreaker can not be created from QML, use "
+        "QmlHttpRequest.circuitBreaker() instead");
+    qmlRegisterUncreatableType<qhr::BatchQueue>("QmlHttpRequest",
+        PROJECT_VERSION_MAJOR, PROJECT_VERSION_MINOR, "BatchQueue",
+        "BatchQueue can not be created from QML, use "
+        "QmlHttpRequest.batchQueue() instead");
+    qmlRegisterUncreatableType<qhr::LoadGenerator>("QmlHttpRequest",
+        PROJECT_VERSION_MAJOR, PROJECT_VERSION_MINOR, "LoadGenerator",
+        "LoadGenerator can not be created from QML, use "
+        "QmlHttpRequest.loadGenerator() instead");
 }
 #endif
 
@@ -38,6 +61,7 @@ QmlHttpRequest* QmlHttpRequest::create(
 {
     if (auto engineNam = qmlEngine->networkAccessManager()) {
         auto instance = new QmlHttpRequest(engineNam);
+        instance->installImageProvider(qmlEngine);
 
         QQmlEngine::setObjectOwnership(
             instance, QQmlEngine::JavaScriptOwnership);
@@ -47,21 +71,128 @@ QmlHttpRequest* QmlHttpRequest::create(
 }
 #endif
 
+/*!
+ * \brief QmlHttpRequest::initializeEngine() Creates the singleton of \a engine
+ * right away, so its \ref ImageProvider serves \a\b image://qhr/ urls even
+ * before the singleton is used from QML. It is called by the QML plugin of the
+ * module, Qt 5 applications call it once \a engine is created.
+ * \param engine
+ */
+void QmlHttpRequest::initializeEngine(QQmlEngine* engine)
+{
+    const int typeId = qmlTypeId(PROJECT_NAME, PROJECT_VERSION_MAJOR,
+        PROJECT_VERSION_MINOR, "QmlHttpRequest");
+    if (typeId < 0) {
+        qWarning("QmlHttpRequest module is not registered.");
+        return;
+    }
+    engine->singletonInstance<QmlHttpRequest*>(typeId);
+}
+
 QmlHttpRequest::QmlHttpRequest(QNetworkAccessManager* nam)
-    : QObject { nullptr }, mNam { nam }
+    : QObject { nullptr }, mNam { nam }, mAutoRelease(false),
+      mLowSpeedLimit(0), mLowSpeedTime(30000), mConnectTimeout(0),
+      mFirstByteTimeout(0), mDeadline(0),
+      mCircuitBreakerEnabled(false), mRecording(false), mRealNam(nullptr),
+      mReplayNam(nullptr)
 {
 }
 
+QmlHttpRequest::~QmlHttpRequest()
+{
+    if (mTracer && Tracer::active() == mTracer.get()) {
+        Tracer::setActive(nullptr);
+    }
+}
+
 /*!
  * \brief QmlHttpRequest::newRequest() Creates a new \ref Request object that
  * can be used to make HTTP request.
  * \note This \ref Request object should be deleted when done with using \ref
- * Request::destroy() from QML or \a\b Request::deleteLater()
+ * Request::destroy() from QML or \a\b Request::deleteLater(), unless \ref
+ * autoRelease is enabled
+ * \param client Optional name of a \ref Client profile created by \ref
+ * client() the request takes its base url, headers and policies from
  * \return A \ref Request
  */
-Request* QmlHttpRequest::newRequest()
+Request* QmlHttpRequest::newRequest(const QString& client)
 {
-    return new Request(mNam);
+    auto request = new Request(mNam);
+    request->setQmlHttpRequest(this);
+    request->setAutoRelease(mAutoRelease);
+    if (mLowSpeedLimit > 0) {
+        request->setLowSpeedLimit(mLowSpeedLimit);
+        request->setLowSpeedTime(mLowSpeedTime);
+    }
+    request->setConnectTimeout(mConnectTimeout);
+    request->setFirstByteTimeout(mFirstByteTimeout);
+    request->setDeadline(mDeadline);
+
+    if (!client.isEmpty()) {
+        if (auto profile = mClients.value(client)) {
+            request->setClient(profile);
+        } else {
+            qWarning() << "No client profile named" << client;
+        }
+    }
+    return request;
+}
+
+/*!
+ * \brief QmlHttpRequest::client() Returns the \ref Client profile named \a
+ * name, creating it if it does not exist yet, and updates it with \a options.
+ * \see Client::configure()
+ * \param name
+ * \param options
+ * \return A \ref Client owned by this object
+ */
+Client* QmlHttpRequest::client(const QString& name, const QVariantMap& options)
+{
+    auto profile = mClients.value(name);
+    if (!profile) {
+        profile = new Client(name, this);
+        QQmlEngine::setObjectOwnership(profile, QQmlEngine::CppOwnership);
+        mClients.insert(name, profile);
+    }
+
+    if (!options.isEmpty()) {
+        profile->configure(options);
+    }
+    return profile;
+}
+
+/*!
+ * \brief QmlHttpRequest::batchQueue() Returns the \ref BatchQueue named \a
+ * name, creating it if it does not exist yet, and updates it with \a options.
+ * The \a client option takes the name of a \ref Client profile to send
+ * batches with.
+ * \see BatchQueue::configure()
+ * \param name
+ * \param options
+ * \return A \ref BatchQueue owned by this object
+ */
+BatchQueue* QmlHttpRequest::batchQueue(
+    const QString& name, const QVariantMap& options)
+{
+    auto queue = mBatchQueues.value(name);
+    if (!queue) {
+        queue = new BatchQueue(mNam, this);
+        QQmlEngine::setObjectOwnership(queue, QQmlEngine::CppOwnership);
+        mBatchQueues.insert(name, queue);
+    }
+
+    if (options.contains("client")) {
+        const auto client = options.value("client").toString();
+        if (auto profile = mClients.value(client)) {
+            queue->setClient(profile);
+        } else {
+            qWarning() << "No client profile named" << client;
+        }
+    }
+    if (!options.isEmpty()) {
+        queue->configure(options);
+    }
+    return queue;
 }
 
 /*!
@@ -74,6 +205,16 @@ void QmlHttpRequest::setDefaultTimeout(int timeout)
     mNam->setTransferTimeout(timeout);
 }
 
+/*!
+ * \brief QmlHttpRequest::liveRequestCount() Returns the number of \ref Request
+ * objects currently alive, useful to check that requests are not leaked.
+ * \return
+ */
+int QmlHttpRequest::liveRequestCount() const
+{
+    return Request::liveCount();
+}
+
 void QmlHttpRequest::setNetworkAccessManager(QNetworkAccessManager *nam)
 {
     mNam = nam;
@@ -99,4 +240,430 @@ QmlHttpRequest::RedirectPolicy QmlHttpRequest::redirectPolicy() const
     return RedirectPolicy(mNam->redirectPolicy());
 }
 
+/*!
+ * \brief QmlHttpRequest::setAutoRelease() Set whether requests created after
+ * this call delete themselves once they are done and their ready state
+ * callback returned. \ref Request::autoRelease can still be changed per
+ * request.
+ * \param autoRelease
+ */
+void QmlHttpRequest::setAutoRelease(bool autoRelease)
+{
+    mAutoRelease = autoRelease;
+}
+
+/*!
+ * \brief QmlHttpRequest::setLowSpeedLimit() Set the default \ref
+ * Request::lowSpeedLimit, in bytes per second, of requests created after this
+ * call. Zero, the default, disables it.
+ * \param bytesPerSecond
+ */
+void QmlHttpRequest::setLowSpeedLimit(int bytesPerSecond)
+{
+    mLowSpeedLimit = qMax(0, bytesPerSecond);
+}
+
+/*!
+ * \brief QmlHttpRequest::setLowSpeedTime() Set the default \ref
+ * Request::lowSpeedTime, in milliseconds, of requests created after this call.
+ * Default is 30000.
+ * \param time
+ */
+void QmlHttpRequest::setLowSpeedTime(int time)
+{
+    mLowSpeedTime = qMax(0, time);
+}
+
+/*!
+ * \brief QmlHttpRequest::setConnectTimeout() Set the default \ref
+ * Request::connectTimeout, in milliseconds, of requests created after this
+ * call. Zero, the default, disables it.
+ * \param timeout
+ */
+void QmlHttpRequest::setConnectTimeout(int timeout)
+{
+    mConnectTimeout = qMax(0, timeout);
+}
+
+/*!
+ * \brief QmlHttpRequest::setFirstByteTimeout() Set the default \ref
+ * Request::firstByteTimeout, in milliseconds, of requests created after this
+ * call. Zero, the default, disables it.
+ * \param timeout
+ */
+void QmlHttpRequest::setFirstByteTimeout(int timeout)
+{
+    mFirstByteTimeout = qMax(0, timeout);
+}
+
+/*!
+ * \brief QmlHttpRequest::setDeadline() Set the default \ref Request::deadline,
+ * in milliseconds, of requests created after this call. Zero, the default,
+ * disables it.
+ * \param deadline
+ */
+void QmlHttpRequest::setDeadline(int deadline)
+{
+    mDeadline = qMax(0, deadline);
+}
+
+/*!
+ * \brief QmlHttpRequest::setMaxHedgeRatio() Set the maximum percentage of sent
+ * requests that may be hedged by requests with \ref Request::hedgeDelay set.
+ * Default is 5.
+ * \param percent
+ */
+void QmlHttpRequest::setMaxHedgeRatio(double percent)
+{
+    mHedgingPolicy.setMaxHedgeRatio(percent);
+}
+
+/*!
+ * \brief QmlHttpRequest::setCircuitBreakerEnabled() Enables a circuit breaker
+ * per host, or per client profile for requests created from one. While a
+ * breaker is open requests fail immediately with \a CircuitOpenError.
+ * \see CircuitBreaker
+ * \param enabled
+ */
+void QmlHttpRequest::setCircuitBreakerEnabled(bool enabled)
+{
+    mCircuitBreakerEnabled = enabled;
+}
+
+/*!
+ * \brief QmlHttpRequest::setCircuitBreakerPolicy() Configures every existing
+ * and future circuit breaker with \a options.
+ * \see CircuitBreaker::configure()
+ * \param options
+ */
+void QmlHttpRequest::setCircuitBreakerPolicy(const QVariantMap& options)
+{
+    mCircuitBreakerPolicy = options;
+    for (auto breaker : std::as_const(mCircuitBreakers)) {
+        breaker->configure(options);
+    }
+}
+
+/*!
+ * \brief QmlHttpRequest::circuitBreaker() Returns the circuit breaker of \a
+ * key, a host name or a client profile name, creating it if needed.
+ * \param key
+ * \return A \ref CircuitBreaker owned by this object
+ */
+CircuitBreaker* QmlHttpRequest::circuitBreaker(const QString& key)
+{
+    auto breaker = mCircuitBreakers.value(key);
+    if (!breaker) {
+        breaker = new CircuitBreaker(key, this);
+        QQmlEngine::setObjectOwnership(breaker, QQmlEngine::CppOwnership);
+        breaker->configure(mCircuitBreakerPolicy);
+        connect(breaker, &CircuitBreaker::stateChanged, this, [this, breaker]() {
+            emit circuitBreakerStateChanged(breaker->key(), breaker->state());
+        });
+        mCircuitBreakers.insert(key, breaker);
+    }
+    return breaker;
+}
+
+/*!
+ * \brief QmlHttpRequest::circuitBreakerFor() Returns the circuit breaker
+ * guarding \a request, or nullptr if circuit breakers are disabled.
+ * \param request
+ * \return
+ */
+CircuitBreaker* QmlHttpRequest::circuitBreakerFor(const Request* request)
+{
+    if (!mCircuitBreakerEnabled) {
+        return nullptr;
+    }
+
+    if (auto client = request->client()) {
+        return circuitBreaker(client->name());
+    }
+    return circuitBreaker(request->url().host());
+}
+
+/*!
+ * \brief QmlHttpRequest::abortGroup() Aborts every request tagged with \a
+ * group, whether it is in flight or queued by its client profile. Requests
+ * that are done or were never sent are left as they are.
+ * \see Request::group
+ * \param group
+ * \return Number of requests aborted
+ */
+int QmlHttpRequest::abortGroup(const QString& group)
+{
+    const auto members = mGroups.value(group);
+    if (members.isEmpty()) {
+        return 0;
+    }
+
+    // Callbacks of an aborted request may delete other requests of the group
+    QList<QPointer<Request>> requests;
+    requests.reserve(members.size());
+    for (auto request : members) {
+        requests.append(request);
+    }
+
+    int aborted = 0;
+    for (const auto& request : std::as_const(requests)) {
+        if (request && request->isPending()) {
+            ++aborted;
+            request->abort();
+        }
+    }
+    return aborted;
+}
+
+/*!
+ * \brief QmlHttpRequest::bindGroup() Aborts the requests of \a group when \a
+ * owner is destroyed, like a page of a \a StackView being popped.
+ * \param group
+ * \param owner
+ */
+void QmlHttpRequest::bindGroup(const QString& group, QObject* owner)
+{
+    if (!owner) {
+        return;
+    }
+    connect(owner, &QObject::destroyed, this,
+        [this, group]() { abortGroup(group); });
+}
+
+/*!
+ * \brief QmlHttpRequest::groupSize() Returns the number of alive requests
+ * tagged with \a group.
+ * \param group
+ * \return
+ */
+int QmlHttpRequest::groupSize(const QString& group) const
+{
+    return mGroups.value(group).size();
+}
+
+void QmlHttpRequest::addToGroup(Request* request, const QString& group)
+{
+    mGroups[group].insert(request);
+}
+
+void QmlHttpRequest::removeFromGroup(Request* request, const QString& group)
+{
+    auto it = mGroups.find(group);
+    if (it != mGroups.end()) {
+        it->remove(request);
+        if (it->isEmpty()) {
+            mGroups.erase(it);
+        }
+    }
+}
+
+/*!
+ * \brief QmlHttpRequest::startTracing() Starts recording the lifecycle of every
+ * \ref Request: its state transitions, redirects, errors and the time spent in
+ * each of its callbacks. Events of a previous tracing session are discarded.
+ * \param capacity Number of the most recent events kept
+ */
+void QmlHttpRequest::startTracing(int capacity)
+{
+    auto tracer = std::make_unique<Tracer>(capacity);
+    Tracer::setActive(tracer.get());
+    mTracer = std::move(tracer);
+
+    emit tracingChanged();
+}
+
+/*!
+ * \brief QmlHttpRequest::stopTracing() Stops recording events. Recorded events
+ * are kept and can still be exported.
+ */
+void QmlHttpRequest::stopTracing()
+{
+    if (mTracer && Tracer::active() == mTracer.get()) {
+        Tracer::setActive(nullptr);
+        emit tracingChanged();
+    }
+}
+
+/*!
+ * \brief QmlHttpRequest::traceJson() Returns the recorded events as Chrome
+ * Trace Event JSON, or an empty string if tracing was never started.
+ * \return
+ */
+QString QmlHttpRequest::traceJson() const
+{
+    if (!mTracer) {
+        return QString();
+    }
+    return QString::fromUtf8(mTracer->toChromeTraceJson());
+}
+
+/*!
+ * \brief QmlHttpRequest::saveTrace() Writes the recorded events as Chrome Trace
+ * Event JSON into the local file \a fileUrl, which can be loaded in Perfetto.
+ * \param fileUrl
+ * \return True on success
+ */
+bool QmlHttpRequest::saveTrace(const QUrl& fileUrl) const
+{
+    if (!mTracer) {
+        return false;
+    }
+
+    QFile file(fileUrl.isLocalFile() ? fileUrl.toLocalFile() : fileUrl.path());
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        qWarning() << "Cannot open trace file: " << fileUrl;
+        return false;
+    }
+    return file.write(mTracer->toChromeTraceJson()) != -1;
+}
+
+bool QmlHttpRequest::isTracing() const
+{
+    return mTracer && Tracer::active() == mTracer.get();
+}
+
+/*!
+ * \brief QmlHttpRequest::startRecording() Starts recording every finished
+ * \ref Request with its headers, bodies, response and timing. Entries of a
+ * previous recording are discarded.
+ * \see saveRecording()
+ */
+void QmlHttpRequest::startRecording()
+{
+    mRecorder = std::make_unique<Recorder>();
+    mRecording = true;
+
+    emit recordingChanged();
+}
+
+/*!
+ * \brief QmlHttpRequest::stopRecording() Stops recording requests. Recorded
+ * entries are kept and can still be saved.
+ */
+void QmlHttpRequest::stopRecording()
+{
+    if (mRecording) {
+        mRecording = false;
+        emit recordingChanged();
+    }
+}
+
+/*!
+ * \brief QmlHttpRequest::saveRecording() Writes the recorded requests as a HAR
+ * file into the local file \a fileUrl, which can be replayed by \ref
+ * startReplay() and \ref loadGenerator().
+ * \param fileUrl
+ * \return True on success
+ */
+bool QmlHttpRequest::saveRecording(const QUrl& fileUrl) const
+{
+    if (!mRecorder) {
+        return false;
+    }
+    return mRecorder->save(Recorder::fileName(fileUrl));
+}
+
+/*!
+ * \brief QmlHttpRequest::startReplay() Answers requests created after this
+ * call from the HAR file \a harUrl instead of the network, until \ref
+ * stopReplay() is called.
+ * \param harUrl
+ * \param latencyScale Factor recorded latencies are multiplied by, zero
+ * answers immediately
+ * \return False if the file could not be loaded
+ */
+bool QmlHttpRequest::startReplay(const QUrl& harUrl, double latencyScale)
+{
+    if (!mReplayNam) {
+        mReplayNam = new ReplayNetworkAccessManager(this);
+    }
+    if (!mReplayNam->load(Recorder::fileName(harUrl))) {
+        return false;
+    }
+    mReplayNam->setLatencyScale(latencyScale);
+
+    if (!isReplaying()) {
+        mRealNam = mNam;
+        mNam = mReplayNam;
+        emit replayingChanged();
+    }
+    return true;
+}
+
+/*!
+ * \brief QmlHttpRequest::stopReplay() Restores network access for requests
+ * created after this call. Requests being replayed are still answered.
+ */
+void QmlHttpRequest::stopReplay()
+{
+    if (isReplaying()) {
+        mNam = mRealNam;
+        mRealNam = nullptr;
+        emit replayingChanged();
+    }
+}
+
+/*!
+ * \brief QmlHttpRequest::loadGenerator() Returns the \ref LoadGenerator named
+ * \a name, creating it if it does not exist yet, and updates it with \a
+ * options.
+ * \see LoadGenerator::configure()
+ * \param name
+ * \param options
+ * \return A \ref LoadGenerator owned by this object
+ */
+LoadGenerator* QmlHttpRequest::loadGenerator(
+    const QString& name, const QVariantMap& options)
+{
+    auto generator = mLoadGenerators.value(name);
+    if (!generator) {
+        generator = new LoadGenerator(this, this);
+        QQmlEngine::setObjectOwnership(generator, QQmlEngine::CppOwnership);
+        mLoadGenerators.insert(name, generator);
+    }
+
+    if (!options.isEmpty()) {
+        generator->configure(options);
+    }
+    return generator;
+}
+
+/*!
+ * \brief QmlHttpRequest::configureImages() Updates the loader behind the \a\b
+ * image://qhr/ provider from \a options.
+ * \see ImageLoader::configure()
+ * \param options
+ */
+void QmlHttpRequest::configureImages(const QVariantMap& options)
+{
+    if (!mImageLoader) {
+        qWarning() << "No image provider is installed";
+        return;
+    }
+    mImageLoader->configure(options);
+}
+
+/*!
+ * \brief QmlHttpRequest::installImageProvider() Adds the \ref ImageProvider
+ * serving \a\b image://qhr/ urls through this object to \a engine, unless
+ * it already has one. It is called when the singleton is created, see \ref
+ * initializeEngine().
+ * \param engine
+ */
+void QmlHttpRequest::installImageProvider(QQmlEngine* engine)
+{
+    if (engine->imageProvider(ImageProvider::Id)) {
+        return;
+    }
+
+    auto provider = new ImageProvider(this);
+    mImageLoader = provider->loader();
+    engine->addImageProvider(ImageProvider::Id, provider);
+}
+
+ImageLoader* QmlHttpRequest::imageLoader() const
+{
+    return mImageLoader;
+}
+
 }
@@ -23,15 +23,30 @@
 #ifndef QMLHTTPREQUEST_HPP
 #define QMLHTTPREQUEST_HPP
 
+#include <QHash>
 #include <QNetworkAccessManager>
 #include <QObject>
+#include <QPointer>
 #include <QQmlEngine>
+#include <QSet>
 #include <QSharedPointer>
 
+#include <memory>
+
+#include "batchqueue.hpp"
+#include "circuitbreaker.hpp"
+#include "client.hpp"
+#include "hedgingpolicy.hpp"
+#include "loadgenerator.hpp"
+#include "recorder.hpp"
 #include "request.hpp"
+#include "tracer.hpp"
 
 namespace qhr {
 
+class ImageLoader;
+class ReplayNetworkAccessManager;
+
 class QmlHttpRequest : public QObject
 {
     Q_OBJECT
@@ -39,6 +54,19 @@ class QmlHttpRequest : public QObject
     QML_SINGLETON
     Q_PROPERTY(RedirectPolicy redirectPolicy READ redirectPolicy WRITE
             setRedirectPolicy)
+    Q_PROPERTY(bool tracing READ isTracing NOTIFY tracingChanged)
+    Q_PROPERTY(bool autoRelease READ autoRelease WRITE setAutoRelease)
+    Q_PROPERTY(double maxHedgeRatio READ maxHedgeRatio WRITE setMaxHedgeRatio)
+    Q_PROPERTY(bool circuitBreakerEnabled READ isCircuitBreakerEnabled WRITE
+            setCircuitBreakerEnabled)
+    Q_PROPERTY(bool recording READ isRecording NOTIFY recordingChanged)
+    Q_PROPERTY(bool replaying READ isReplaying NOTIFY replayingChanged)
+    Q_PROPERTY(int lowSpeedLimit READ lowSpeedLimit WRITE setLowSpeedLimit)
+    Q_PROPERTY(int lowSpeedTime READ lowSpeedTime WRITE setLowSpeedTime)
+    Q_PROPERTY(int connectTimeout READ connectTimeout WRITE setConnectTimeout)
+    Q_PROPERTY(
+        int firstByteTimeout READ firstByteTimeout WRITE setFirstByteTimeout)
+    Q_PROPERTY(int deadline READ deadline WRITE setDeadline)
 
 public:
     enum RedirectPolicy
@@ -60,6 +88,15 @@ public:
     };
     Q_ENUM(State);
 
+    enum Error
+    {
+        CircuitOpenError = int(qhr::Request::Error::CircuitOpenError),
+        StreamParseError = int(qhr::Request::Error::StreamParseError),
+        IntegrityError = int(qhr::Request::Error::IntegrityError),
+        BodyReadError = int(qhr::Request::Error::BodyReadError),
+    };
+    Q_ENUM(Error);
+
 public:
 #if QT_VERSION_MAJOR == 5
     static void registerQmlHttpRequest();
@@ -68,11 +105,18 @@ public:
 #if QT_VERSION_MAJOR == 6
     static QmlHttpRequest* create(QQmlEngine* qmlEngine, QJSEngine* jsEngine);
 #endif
+    static void initializeEngine(QQmlEngine* engine);
 
     QmlHttpRequest(QNetworkAccessManager* nam);
+    ~QmlHttpRequest();
 
-    Q_INVOKABLE qhr::Request* newRequest();
+    Q_INVOKABLE qhr::Request* newRequest(const QString& client = QString());
+    Q_INVOKABLE qhr::Client* client(
+        const QString& name, const QVariantMap& options = QVariantMap());
+    Q_INVOKABLE qhr::BatchQueue* batchQueue(
+        const QString& name, const QVariantMap& options = QVariantMap());
     Q_INVOKABLE void setDefaultTimeout(int timeout);
+    Q_INVOKABLE int liveRequestCount() const;
 
     void setNetworkAccessManager(QNetworkAccessManager* nam);
     QNetworkAccessManager* networkAccessManager() const;
@@ -80,8 +124,89 @@ public:
     void setRedirectPolicy(RedirectPolicy rp);
     RedirectPolicy redirectPolicy() const;
 
+    void setAutoRelease(bool autoRelease);
+    bool autoRelease() const { return mAutoRelease; }
+
+    void setLowSpeedLimit(int bytesPerSecond);
+    int lowSpeedLimit() const { return mLowSpeedLimit; }
+    void setLowSpeedTime(int time);
+    int lowSpeedTime() const { return mLowSpeedTime; }
+
+    void setConnectTimeout(int timeout);
+    int connectTimeout() const { return mConnectTimeout; }
+    void setFirstByteTimeout(int timeout);
+    int firstByteTimeout() const { return mFirstByteTimeout; }
+    void setDeadline(int deadline);
+    int deadline() const { return mDeadline; }
+
+    void setMaxHedgeRatio(double percent);
+    double maxHedgeRatio() const { return mHedgingPolicy.maxHedgeRatio(); }
+    HedgingPolicy& hedgingPolicy() { return mHedgingPolicy; }
+
+    void setCircuitBreakerEnabled(bool enabled);
+    bool isCircuitBreakerEnabled() const { return mCircuitBreakerEnabled; }
+    Q_INVOKABLE void setCircuitBreakerPolicy(const QVariantMap& options);
+    Q_INVOKABLE qhr::CircuitBreaker* circuitBreaker(const QString& key);
+    CircuitBreaker* circuitBreakerFor(const Request* request);
+
+    Q_INVOKABLE int abortGroup(const QString& group);
+    Q_INVOKABLE void bindGroup(const QString& group, QObject* owner);
+    Q_INVOKABLE int groupSize(const QString& group) const;
+    void addToGroup(Request* request, const QString& group);
+    void removeFromGroup(Request* request, const QString& group);
+
+    Q_INVOKABLE void startTracing(int capacity = 65536);
+    Q_INVOKABLE void stopTracing();
+    Q_INVOKABLE QString traceJson() const;
+    Q_INVOKABLE bool saveTrace(const QUrl& fileUrl) const;
+    bool isTracing() const;
+
+    Q_INVOKABLE void startRecording();
+    Q_INVOKABLE void stopRecording();
+    Q_INVOKABLE bool saveRecording(const QUrl& fileUrl) const;
+    bool isRecording() const { return mRecording; }
+    Recorder* recorder() const { return mRecording ? mRecorder.get() : nullptr; }
+
+    Q_INVOKABLE bool startReplay(const QUrl& harUrl, double latencyScale = 1.0);
+    Q_INVOKABLE void stopReplay();
+    bool isReplaying() const { return mRealNam != nullptr; }
+
+    Q_INVOKABLE qhr::LoadGenerator* loadGenerator(
+        const QString& name, const QVariantMap& options = QVariantMap());
+
+    Q_INVOKABLE void configureImages(const QVariantMap& options);
+    void installImageProvider(QQmlEngine* engine);
+    ImageLoader* imageLoader() const;
+
+signals:
+    void tracingChanged();
+    void recordingChanged();
+    void replayingChanged();
+    void circuitBreakerStateChanged(
+        const QString& key, qhr::CircuitBreaker::State state);
+
 private:
     QNetworkAccessManager* mNam;
+    QHash<QString, Client*> mClients;
+    QHash<QString, BatchQueue*> mBatchQueues;
+    std::unique_ptr<Tracer> mTracer;
+    bool mAutoRelease;
+    int mLowSpeedLimit;
+    int mLowSpeedTime;
+    int mConnectTimeout;
+    int mFirstByteTimeout;
+    int mDeadline;
+    HedgingPolicy mHedgingPolicy;
+    bool mCircuitBreakerEnabled;
+    QVariantMap mCircuitBreakerPolicy;
+    QHash<QString, CircuitBreaker*> mCircuitBreakers;
+    std::unique_ptr<Recorder> mRecorder;
+    bool mRecording;
+    QNetworkAccessManager* mRealNam;
+    ReplayNetworkAccessManager* mReplayNam;
+    QHash<QString, LoadGenerator*> mLoadGenerators;
+    QHash<QString, QSet<Request*>> mGroups;
+    QPointer<ImageLoader> mImageLoader;
 };
 
 }
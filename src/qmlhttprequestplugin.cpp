@@ -0,0 +1,35 @@
+#include <QQmlEngineExtensionPlugin>
+
+#include "qmlhttprequest.hpp"
+
+extern void qml_register_types_QmlHttpRequest();
+Q_GHS_KEEP_REFERENCE(qml_register_types_QmlHttpRequest)
+
+/*!
+ * \class QmlHttpRequestPlugin
+ * \brief QmlHttpRequestPlugin class is the QML plugin of the module, replacing
+ * the generated one to prepare each engine importing it, see \ref
+ * qhr::QmlHttpRequest::initializeEngine()
+ */
+class QmlHttpRequestPlugin : public QQmlEngineExtensionPlugin
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID QQmlEngineExtensionInterface_iid)
+
+public:
+    QmlHttpRequestPlugin(QObject* parent = nullptr)
+        : QQmlEngineExtensionPlugin { parent }
+    {
+        // Keeps the type registration of the backing library linked in
+        volatile auto registration = &qml_register_types_QmlHttpRequest;
+        Q_UNUSED(registration);
+    }
+
+    void initializeEngine(QQmlEngine* engine, const char* uri) override
+    {
+        Q_UNUSED(uri);
+        qhr::QmlHttpRequest::initializeEngine(engine);
+    }
+};
+
+#include "qmlhttprequestplugin.moc"
@@ -0,0 +1,273 @@
+#include "recorder.hpp"
+
+#include "config.hpp"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QUrlQuery>
+
+namespace qhr {
+
+/*!
+ * \class Recorder
+ * \brief Recorder class keeping the traffic of finished requests, their
+ * method, url, headers, bodies, response and timing, and saving it as a HAR
+ * 1.2 file that can be replayed by \ref ReplayNetworkAccessManager or opened
+ * in browser developer tools.
+ */
+
+Recorder::Recorder() { }
+
+/*!
+ * \brief Recorder::record() Appends \a entry to the recording.
+ * \param entry
+ */
+void Recorder::record(const Entry& entry)
+{
+    QJsonArray queryString;
+    const auto queryItems = QUrlQuery(entry.url).queryItems(QUrl::FullyDecoded);
+    for (const auto& item : queryItems) {
+        queryString.append(QJsonObject {
+            { "name", item.first },
+            { "value", item.second },
+        });
+    }
+
+    QJsonObject request {
+        { "method", QString::fromUtf8(entry.method) },
+        { "url", entry.url.toString(QUrl::FullyEncoded) },
+        { "httpVersion", "HTTP/1.1" },
+        { "cookies", QJsonArray() },
+        { "headers", headersToJson(entry.requestHeaders) },
+        { "queryString", queryString },
+        { "headersSize", -1 },
+        { "bodySize", double(entry.requestBody.size()) },
+    };
+    if (!entry.requestBody.isEmpty()) {
+        auto postData = contentToJson(entry.requestBody,
+            header(entry.requestHeaders, "content-type"));
+        postData.remove("size");
+        request.insert("postData", postData);
+    }
+
+    const auto mimeType = header(entry.responseHeaders, "content-type");
+    QJsonObject response {
+        { "status", entry.status },
+        { "statusText", entry.statusText },
+        { "httpVersion", "HTTP/1.1" },
+        { "cookies", QJsonArray() },
+        { "headers", headersToJson(entry.responseHeaders) },
+        { "content", contentToJson(entry.responseBody, mimeType) },
+        { "redirectURL",
+            QString::fromUtf8(header(entry.responseHeaders, "location")) },
+        { "headersSize", -1 },
+        { "bodySize", double(entry.responseBody.size()) },
+    };
+
+    mEntries.append(QJsonObject {
+        { "startedDateTime",
+            entry.startedDateTime.toString(Qt::ISODateWithMs) },
+        { "time", double(entry.wait + entry.receive) },
+        { "request", request },
+        { "response", response },
+        { "cache", QJsonObject() },
+        { "timings",
+            QJsonObject {
+                { "send", 0 },
+                { "wait", double(entry.wait) },
+                { "receive", double(entry.receive) },
+            } },
+    });
+}
+
+void Recorder::clear()
+{
+    mEntries = QJsonArray();
+}
+
+/*!
+ * \brief Recorder::toHar() Returns the recording as a HAR 1.2 document.
+ * \return
+ */
+QByteArray Recorder::toHar() const
+{
+    QJsonObject log {
+        { "version", "1.2" },
+        { "creator",
+            QJsonObject {
+                { "name", PROJECT_NAME },
+                { "version", PROJECT_VERSION_STRING },
+            } },
+        { "entries", mEntries },
+    };
+    return QJsonDocument(QJsonObject { { "log", log } }).toJson();
+}
+
+/*!
+ * \brief Recorder::save() Writes the recording as a HAR file named \a fileName.
+ * \param fileName
+ * \return True on success
+ */
+bool Recorder::save(const QString& fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        qWarning() << "Cannot open HAR file: " << fileName;
+        return false;
+    }
+    return file.write(toHar()) != -1;
+}
+
+/*!
+ * \brief Recorder::fromHar() Parses the entries of the HAR document \a har.
+ * \param har
+ * \param ok Set to false if \a har is not a valid HAR document
+ * \return
+ */
+QList<Recorder::Entry> Recorder::fromHar(const QByteArray& har, bool* ok)
+{
+    QJsonParseError error;
+    const auto document = QJsonDocument::fromJson(har, &error);
+    const auto entries
+        = document.object().value("log").toObject().value("entries");
+
+    if (ok) {
+        *ok = error.error == QJsonParseError::NoError && entries.isArray();
+    }
+
+    QList<Entry> result;
+    const auto array = entries.toArray();
+    result.reserve(array.size());
+    for (const auto& value : array) {
+        const auto object = value.toObject();
+        const auto request = object.value("request").toObject();
+        const auto response = object.value("response").toObject();
+        const auto timings = object.value("timings").toObject();
+
+        Entry entry;
+        entry.startedDateTime = QDateTime::fromString(
+            object.value("startedDateTime").toString(), Qt::ISODateWithMs);
+        entry.method = request.value("method").toString().toUtf8();
+        entry.url = QUrl(request.value("url").toString());
+        entry.requestHeaders
+            = headersFromJson(request.value("headers").toArray());
+        entry.requestBody
+            = contentFromJson(request.value("postData").toObject());
+        entry.status = response.value("status").toInt();
+        entry.statusText = response.value("statusText").toString();
+        entry.responseHeaders
+            = headersFromJson(response.value("headers").toArray());
+        entry.responseBody
+            = contentFromJson(response.value("content").toObject());
+        // Negative timings mean not applicable in HAR
+        entry.wait = qMax(qint64(0), qint64(timings.value("wait").toDouble()));
+        entry.receive
+            = qMax(qint64(0), qint64(timings.value("receive").toDouble()));
+        result.append(entry);
+    }
+    return result;
+}
+
+/*!
+ * \brief Recorder::load() Reads and parses the HAR file named \a fileName.
+ * \see fromHar()
+ */
+QList<Recorder::Entry> Recorder::load(const QString& fileName, bool* ok)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly)) {
+        qWarning() << "Cannot open HAR file: " << fileName;
+        if (ok) {
+            *ok = false;
+        }
+        return QList<Entry>();
+    }
+    return fromHar(file.readAll(), ok);
+}
+
+/*!
+ * \brief Recorder::fileName() Returns the name of the file \a url points to,
+ * a resource for a \a qrc url, to pass to \ref load() or \ref save().
+ * \param url
+ * \return
+ */
+QString Recorder::fileName(const QUrl& url)
+{
+    if (url.isLocalFile()) {
+        return url.toLocalFile();
+    }
+    if (url.scheme().compare("qrc", Qt::CaseInsensitive) == 0) {
+        return ":" + url.path();
+    }
+    return url.path();
+}
+
+QJsonArray Recorder::headersToJson(const Headers& headers)
+{
+    QJsonArray array;
+    for (const auto& header : headers) {
+        array.append(QJsonObject {
+            { "name", QString::fromUtf8(header.first) },
+            { "value", QString::fromUtf8(header.second) },
+        });
+    }
+    return array;
+}
+
+Recorder::Headers Recorder::headersFromJson(const QJsonArray& array)
+{
+    Headers headers;
+    headers.reserve(array.size());
+    for (const auto& value : array) {
+        const auto object = value.toObject();
+        headers.append({ object.value("name").toString().toUtf8(),
+            object.value("value").toString().toUtf8() });
+    }
+    return headers;
+}
+
+/*!
+ * \brief Recorder::contentToJson() Returns a HAR content object for \a body.
+ * Bodies that are not textual according to \a mimeType are base64 encoded.
+ */
+QJsonObject Recorder::contentToJson(
+    const QByteArray& body, const QByteArray& mimeType)
+{
+    const bool isText = mimeType.isEmpty() || mimeType.startsWith("text/")
+        || mimeType.contains("json") || mimeType.contains("xml")
+        || mimeType.contains("javascript")
+        || mimeType.contains("x-www-form-urlencoded");
+
+    QJsonObject content {
+        { "size", double(body.size()) },
+        { "mimeType", QString::fromUtf8(mimeType) },
+    };
+    if (isText) {
+        content.insert("text", QString::fromUtf8(body));
+    } else {
+        content.insert("text", QString::fromLatin1(body.toBase64()));
+        content.insert("encoding", "base64");
+    }
+    return content;
+}
+
+QByteArray Recorder::contentFromJson(const QJsonObject& content)
+{
+    const auto text = content.value("text").toString();
+    if (content.value("encoding").toString() == "base64") {
+        return QByteArray::fromBase64(text.toLatin1());
+    }
+    return text.toUtf8();
+}
+
+QByteArray Recorder::header(const Headers& headers, const QByteArray& name)
+{
+    for (const auto& header : headers) {
+        if (header.first.compare(name, Qt::CaseInsensitive) == 0) {
+            return header.second;
+        }
+    }
+    return QByteArray();
+}
+
+}
@@ -0,0 +1,85 @@
+/*!
+ * Copyright (c) 2023 Alireza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef RECORDER_HPP
+#define RECORDER_HPP
+
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QPair>
+#include <QUrl>
+
+#include "qmlhttprequest_global.hpp"
+
+namespace qhr {
+
+class QHR_EXPORT Recorder
+{
+public:
+    using Headers = QList<QPair<QByteArray, QByteArray>>;
+
+    struct Entry
+    {
+        QDateTime   startedDateTime;
+        QByteArray  method;
+        QUrl        url;
+        Headers     requestHeaders;
+        QByteArray  requestBody;
+        int         status = 0;
+        QString     statusText;
+        Headers     responseHeaders;
+        QByteArray  responseBody;
+        qint64      wait = 0;
+        qint64      receive = 0;
+    };
+
+    Recorder();
+
+    void record(const Entry& entry);
+    void clear();
+    int count() const { return mEntries.size(); }
+
+    QByteArray toHar() const;
+    bool save(const QString& fileName) const;
+
+    static QList<Entry> fromHar(const QByteArray& har, bool* ok = nullptr);
+    static QList<Entry> load(const QString& fileName, bool* ok = nullptr);
+    static QString fileName(const QUrl& url);
+    static QByteArray header(const Headers& headers, const QByteArray& name);
+
+private:
+    static QJsonArray headersToJson(const Headers& headers);
+    static Headers headersFromJson(const QJsonArray& array);
+    static QJsonObject contentToJson(
+        const QByteArray& body, const QByteArray& mimeType);
+    static QByteArray contentFromJson(const QJsonObject& content);
+
+private:
+    QJsonArray mEntries;
+};
+
+}
+
+#endif // RECORDER_HPP
@@ -0,0 +1,229 @@
+#include "replaynetworkaccessmanager.hpp"
+
+#include <QTimer>
+
+#include <cstring>
+
+namespace qhr {
+
+/*!
+ * \class ReplayNetworkAccessManager
+ * \brief ReplayNetworkAccessManager class serving the responses of a HAR
+ * recording instead of accessing the network. A request is answered by the
+ * recorded entry with the same method and url, entries recorded several times
+ * are served in turn. Each response is delayed by its recorded wait and
+ * receive times multiplied by \ref latencyScale.
+ */
+
+ReplayNetworkAccessManager::ReplayNetworkAccessManager(QObject* parent)
+    : QNetworkAccessManager { parent }, mLatencyScale(1.0)
+{
+}
+
+/*!
+ * \brief ReplayNetworkAccessManager::load() Loads the entries of the HAR file
+ * named \a fileName.
+ * \param fileName
+ * \return True on success
+ */
+bool ReplayNetworkAccessManager::load(const QString& fileName)
+{
+    bool ok = false;
+    const auto entries = Recorder::load(fileName, &ok);
+    if (ok) {
+        setEntries(entries);
+    }
+    return ok;
+}
+
+void ReplayNetworkAccessManager::setEntries(
+    const QList<Recorder::Entry>& entries)
+{
+    mEntries = entries;
+    mIndex.clear();
+    mCursors.clear();
+    for (int i = 0; i < mEntries.size(); ++i) {
+        mIndex[entryKey(mEntries[i].method, mEntries[i].url)].append(i);
+    }
+}
+
+/*!
+ * \brief ReplayNetworkAccessManager::setLatencyScale() Set the factor recorded
+ * latencies are multiplied by, zero replays responses as fast as possible.
+ * Default is 1.
+ * \param scale
+ */
+void ReplayNetworkAccessManager::setLatencyScale(double scale)
+{
+    mLatencyScale = qMax(0.0, scale);
+}
+
+QNetworkReply* ReplayNetworkAccessManager::createRequest(
+    Operation op, const QNetworkRequest& request, QIODevice* outgoingData)
+{
+    Q_UNUSED(outgoingData)
+
+    QByteArray method;
+    switch (op) {
+    case HeadOperation:
+        method = "HEAD";
+        break;
+    case GetOperation:
+        method = "GET";
+        break;
+    case PutOperation:
+        method = "PUT";
+        break;
+    case PostOperation:
+        method = "POST";
+        break;
+    case DeleteOperation:
+        method = "DELETE";
+        break;
+    default:
+        method = request.attribute(QNetworkRequest::CustomVerbAttribute)
+                     .toByteArray();
+        break;
+    }
+
+    const Recorder::Entry* entry = nullptr;
+    const auto key = entryKey(method, request.url());
+    const auto indexes = mIndex.value(key);
+    if (!indexes.isEmpty()) {
+        int& cursor = mCursors[key];
+        entry = &mEntries[indexes[cursor]];
+        cursor = (cursor + 1) % indexes.size();
+    }
+
+    return new ReplayReply(op, request, method, entry, mLatencyScale, this);
+}
+
+QString ReplayNetworkAccessManager::entryKey(
+    const QByteArray& method, const QUrl& url)
+{
+    return QString::fromUtf8(method.toUpper()) + ' '
+        + url.adjusted(QUrl::RemoveFragment).toString(QUrl::FullyEncoded);
+}
+
+/*!
+ * \class ReplayReply
+ * \brief ReplayReply class is a \a\b QNetworkReply created by \ref
+ * ReplayNetworkAccessManager that delivers a recorded response. Without a
+ * recorded entry it fails with \a\b QNetworkReply::ContentNotFoundError.
+ */
+
+ReplayReply::ReplayReply(QNetworkAccessManager::Operation op,
+    const QNetworkRequest& request, const QByteArray& method,
+    const Recorder::Entry* entry, double latencyScale, QObject* parent)
+    : QNetworkReply { parent }, mOffset(0)
+{
+    setOperation(op);
+    setRequest(request);
+    setUrl(request.url());
+    setAttribute(QNetworkRequest::CustomVerbAttribute, method);
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+
+    if (!entry) {
+        QTimer::singleShot(0, this, [this, method]() {
+            fail(ContentNotFoundError,
+                QString("No recorded response for %1 %2")
+                    .arg(QString::fromUtf8(method), url().toString()));
+        });
+        return;
+    }
+
+    const int wait = qRound(entry->wait * latencyScale);
+    const int receive = qRound(entry->receive * latencyScale);
+
+    if (entry->status == 0) {
+        QTimer::singleShot(wait + receive, this, [this]() {
+            fail(UnknownNetworkError, "Recorded request failed");
+        });
+        return;
+    }
+
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, entry->status);
+    setAttribute(
+        QNetworkRequest::HttpReasonPhraseAttribute, entry->statusText.toUtf8());
+    for (const auto& header : entry->responseHeaders) {
+        // The recorded body is already decoded
+        if (header.first.compare("Content-Length", Qt::CaseInsensitive) == 0
+            || header.first.compare("Content-Encoding", Qt::CaseInsensitive)
+                == 0) {
+            continue;
+        }
+        setRawHeader(header.first, header.second);
+    }
+    setHeader(QNetworkRequest::ContentLengthHeader, entry->responseBody.size());
+
+    const auto location = Recorder::header(entry->responseHeaders, "location");
+    if (entry->status >= 300 && entry->status < 400 && !location.isEmpty()) {
+        setAttribute(QNetworkRequest::RedirectionTargetAttribute,
+            QUrl::fromEncoded(location));
+    }
+
+    mBody = entry->responseBody;
+
+    QTimer::singleShot(wait, this, &ReplayReply::deliverHeaders);
+    QTimer::singleShot(wait + receive, this, &ReplayReply::deliverBody);
+}
+
+void ReplayReply::abort()
+{
+    if (!isFinished()) {
+        fail(OperationCanceledError, "Operation canceled");
+    }
+}
+
+qint64 ReplayReply::bytesAvailable() const
+{
+    if (!isFinished()) {
+        // The body is held back until its receive time, like readData() does
+        return QIODevice::bytesAvailable();
+    }
+    return mBody.size() - mOffset + QIODevice::bytesAvailable();
+}
+
+qint64 ReplayReply::readData(char* data, qint64 maxSize)
+{
+    if (!isFinished() || mOffset >= mBody.size()) {
+        return isFinished() ? -1 : 0;
+    }
+
+    const auto size = qMin(maxSize, mBody.size() - mOffset);
+    std::memcpy(data, mBody.constData() + mOffset, size_t(size));
+    mOffset += size;
+    return size;
+}
+
+void ReplayReply::deliverHeaders()
+{
+    if (!isFinished()) {
+        emit metaDataChanged();
+    }
+}
+
+void ReplayReply::deliverBody()
+{
+    if (isFinished()) {
+        return;
+    }
+
+    setFinished(true);
+    emit downloadProgress(mBody.size(), mBody.size());
+    if (!mBody.isEmpty()) {
+        emit readyRead();
+    }
+    emit finished();
+}
+
+void ReplayReply::fail(NetworkError error, const QString& errorString)
+{
+    mBody.clear();
+    setError(error, errorString);
+    setFinished(true);
+    emit errorOccurred(error);
+    emit finished();
+}
+
+}
@@ -0,0 +1,93 @@
+/*!
+ * Copyright (c) 2023 Alireza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef REPLAYNETWORKACCESSMANAGER_HPP
+#define REPLAYNETWORKACCESSMANAGER_HPP
+
+#include <QHash>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+
+#include "qmlhttprequest_global.hpp"
+#include "recorder.hpp"
+
+namespace qhr {
+
+class QHR_EXPORT ReplayNetworkAccessManager : public QNetworkAccessManager
+{
+    Q_OBJECT
+
+public:
+    ReplayNetworkAccessManager(QObject* parent = nullptr);
+
+    bool load(const QString& fileName);
+    void setEntries(const QList<Recorder::Entry>& entries);
+    const QList<Recorder::Entry>& entries() const { return mEntries; }
+
+    void setLatencyScale(double scale);
+    double latencyScale() const { return mLatencyScale; }
+
+protected:
+    QNetworkReply* createRequest(Operation op, const QNetworkRequest& request,
+        QIODevice* outgoingData = nullptr) override;
+
+private:
+    static QString entryKey(const QByteArray& method, const QUrl& url);
+
+private:
+    QList<Recorder::Entry> mEntries;
+    QHash<QString, QList<int>> mIndex;
+    QHash<QString, int> mCursors;
+    double mLatencyScale;
+};
+
+class QHR_EXPORT ReplayReply : public QNetworkReply
+{
+    Q_OBJECT
+
+public:
+    ReplayReply(QNetworkAccessManager::Operation op,
+        const QNetworkRequest& request, const QByteArray& method,
+        const Recorder::Entry* entry, double latencyScale,
+        QObject* parent = nullptr);
+
+    void abort() override;
+    qint64 bytesAvailable() const override;
+    bool isSequential() const override { return true; }
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+
+private:
+    void deliverHeaders();
+    void deliverBody();
+    void fail(NetworkError error, const QString& errorString);
+
+private:
+    QByteArray mBody;
+    qint64 mOffset;
+};
+
+}
+
+#endif // REPLAYNETWORKACCESSMANAGER_HPP
@@ -1,14 +1,34 @@
 #include "request.hpp"
-
+#include "bodyencoder.hpp"
+#include "circuitbreaker.hpp"
+#include "client.hpp"
+#include "jsonstreamparser.hpp"
+#include "localsocketnetworkaccessmanager.hpp"
+#include "multipartparser.hpp"
+#include "qmlhttprequest.hpp"
+#include "recorder.hpp"
+#include "replaynetworkaccessmanager.hpp"
+#include "streamhasher.hpp"
+#include "timerwheel.hpp"
+#include "tracer.hpp"
+#include "workerthread.hpp"
+
+#include <QBuffer>
+#include <QCryptographicHash>
 #include <QFile>
+#include <QGuiApplication>
 #include <QHttpMultiPart>
 #include <QHttpPart>
 #include <QMimeDatabase>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
+#include <QTimerEvent>
 
 namespace qhr {
 
+static std::atomic<quint64> sNextTraceId { 1 };
+static std::atomic<int> sLiveCount { 0 };
+
 /*!
  * \class Request
  * \brief Request call encapsulating a network request and a thin wrapper around
@@ -27,16 +47,28 @@ namespace qhr {
  * \param parent
  */
 Request::Request(QNetworkAccessManager* nam, int timeout)
-    : mNam(nam), mMethodName(""), mMethod(Method::INVALID), mNReply(nullptr)
+    : mNam(nam), mMethodName(""), mMethod(Method::INVALID), mNReply(nullptr),
+      mBodyEncoder(nullptr), mRedirectPolicy(-1),
+      mTraceId(sNextTraceId.fetch_add(1)),
+      mAutoRelease(false), mItemParser(nullptr), mState(State::Unsent)
 {
     if (timeout != 0) {
         mNRequest.setTransferTimeout(timeout);
     }
+    sLiveCount.fetch_add(1, std::memory_order_relaxed);
 }
 
 Request::~Request()
 {
-    abort();
+    if (mQhr && !mGroup.isEmpty()) {
+        mQhr->removeFromGroup(this, mGroup);
+    }
+    mPoll.reset();
+    stopBodyEncoding();
+    stopItemParser();
+    stopIntegrityCheck();
+    cancel();
+    sLiveCount.fetch_sub(1, std::memory_order_relaxed);
 }
 
 /*!
@@ -74,7 +106,9 @@ void Request::open(const QString& method, const QUrl& url)
     }
 
     mState = State::Opened;
-    mUrl = url;
+    mUrl = mClient ? mClient->resolvedUrl(url) : url;
+
+    trace("open", 'n', mUrl);
 }
 
 /*!
@@ -96,12 +130,62 @@ void Request::setRequestHeader(const QString& header, const QString& value)
  * \brief Request::send() Sends a method using \a\b QNetworkAccessManager
  * injected into this.
  * \param body Optional parameter for making a send request. If method is GET or
- * HEAD body is ignored
+ * HEAD body is ignored. A local file \a\b QUrl is streamed from disk as the
+ * raw body unless the content type is \a multipart. An object or an array is
+ * serialized natively, as JSON by default, see \ref BodyEncoder
  */
 void Request::send(const QVariant& body)
+{
+    // A value from QML is converted once, binary data to its bytes and other
+    // values to plain variants the encoders and the worker can use
+    QByteArray binary;
+    mBody = binaryBody(body, binary) ? QVariant(binary)
+                                     : BodyEncoder::plain(body);
+    mBodyDevice = nullptr;
+
+    trace("request", 'b', mUrl);
+    startDeadline();
+    if (startBodyEncoding()) {
+        // Sent once the body is encoded
+        return;
+    }
+    if (startUploadChecksum()) {
+        // Sent once the checksum of the body is computed
+        return;
+    }
+    sendRequest();
+}
+
+/*!
+ * \brief Request::send() Sends the request streaming its body from \a device.
+ * Ownership of \a device is not taken and it must stay alive until the request
+ * is done. A random access \a device is sent from its beginning and its size
+ * is used as \a Content-Length. If \a device is sequential, \a Content-Length
+ * header should be set before sending.
+ * \param device
+ */
+void Request::send(QIODevice* device)
+{
+    mBody = QVariant();
+    mBodyDevice = device;
+
+    trace("request", 'b', mUrl);
+    startDeadline();
+    if (startUploadChecksum()) {
+        // Sent once the checksum of the body is computed
+        return;
+    }
+    sendRequest();
+}
+
+/*!
+ * \brief Request::sendRequest() Sends the request using the body stored by
+ * \ref send(). It is also used to resend the request when redirected.
+ */
+void Request::sendRequest()
 {
     if (mNReply) {
-        abort();
+        cancel();
     }
 
     if (!isOpen()) {
@@ -109,13 +193,35 @@ void Request::send(const QVariant& body)
         return;
     }
 
+    if (mQhr && !mCircuitBreaker) {
+        mCircuitBreaker = mQhr->circuitBreakerFor(this);
+        if (mCircuitBreaker && !mCircuitBreaker->allowRequest()) {
+            mCircuitBreaker = nullptr;
+            failFast(Error::CircuitOpenError,
+                QString("Circuit breaker of %1 is open")
+                    .arg(mClient ? mClient->name() : mUrl.host()));
+            return;
+        }
+    }
+
+    if (mClient && !mClient->acquire(this)) {
+        // Queued by the client profile, it sends this request later
+        return;
+    }
+
     if (mNam) {
         mNRequest.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
             QNetworkRequest::ManualRedirectPolicy);
         mNRequest.setUrl(mUrl);
         mNRequest.setMaximumRedirectsAllowed(15);
+        // Content length of a previous body must not leak into this one
+        mNRequest.setHeader(QNetworkRequest::ContentLengthHeader, QVariant());
+        if (transportManager() != mNam
+            && mNRequest.transferTimeout() == 0) {
+            // The default timeout is the one of the injected manager
+            mNRequest.setTransferTimeout(mNam->transferTimeout());
+        }
 
-        mBody = body;
         switch (mMethod) {
         case Method::INVALID:
             return;
@@ -127,10 +233,10 @@ void Request::send(const QVariant& body)
         case Method::PUT:
         case Method::PATCH:
         case Method::DELETE:
-            sendBodyRequest(body);
+            sendBodyRequest(mBody);
             break;
         case Method::CUSTOM:
-            if (body.isNull() || !body.isValid()) {
+            if (!mBodyDevice && (mBody.isNull() || !mBody.isValid())) {
                 sendNoBodyRequest();
             } else {
                 sendBodyRequest(mBody);
@@ -140,20 +246,122 @@ void Request::send(const QVariant& body)
         // Connect to signals of QNetworkReply
         if (mNReply) {
             setupReplyConnections();
+            if (onItem().isCallable()) {
+                startItemParser();
+            }
+            mPartParser.reset();
+            if (mIntegrity && !mIntegrity->expected.isEmpty()) {
+                // Started once the response headers are known
+                stopIntegrityCheck();
+                mIntegrity->pending = true;
+            }
+            trace("send", 'n', mUrl);
+
+            if (mHedging || (mQhr && mQhr->isRecording())) {
+                hedging().sent.start();
+                mHedging->wait = 0;
+            }
+            if (mQhr) {
+                mQhr->hedgingPolicy().requestSent();
+            }
+            startHedgeTimer();
+            startTransferMonitor();
+            startTimeouts();
         }
     }
 }
 
+/*!
+ * \qmlmethod abort()
+ * \brief Request::abort() Aborts this request. An aborted request in flight
+ * reports it once its reply is canceled. A request not sent yet, because it is
+ * queued by its client profile or its body is being encoded or checksummed,
+ * reports it and is done right away.
+ */
 void Request::abort()
 {
+    const bool waiting = isWaiting();
+    cancel();
+    if (!waiting) {
+        return;
+    }
+
+    mResponse.clear();
+    mResponse.setText("{ \"detail\": \"Operation aborted\" }");
+    trace("aborted");
+    if (onAborted().isCallable()) {
+        callCallback("onaborted", onAborted());
+    } else {
+        callCallback("onerror", onError(),
+            { QNetworkReply::OperationCanceledError,
+                QString("Operation canceled") });
+    }
+    finish();
+}
+
+/*!
+ * \brief Request::isPending() Returns true if this request was sent and is not
+ * done: it is in flight, its body is still being parsed or hashed, or it waits
+ * to be sent.
+ * \return
+ */
+bool Request::isPending() const
+{
+    return mNReply || hasBodyStreams() || isWaiting();
+}
+
+/*!
+ * \brief Request::isWaiting() Returns true if this request was sent but waits
+ * for its client profile, or for its body to be encoded or checksummed, before
+ * its reply is created.
+ * \return
+ */
+bool Request::isWaiting() const
+{
+    return !mNReply && mState != State::Done
+        && (mBodyEncoder || (mIntegrity && mIntegrity->uploadHasher)
+            || (mClient && mClient->isQueued(this)));
+}
+
+/*!
+ * \brief Request::cancel() Stops everything this request is doing without
+ * reporting it, except a canceled reply reporting itself.
+ */
+void Request::cancel()
+{
+    if (hasBodyStreams() && !mNReply) {
+        // The reply is done and only parsing or hashing of its body is left
+        stopItemParser();
+        stopIntegrityCheck();
+        finish();
+        return;
+    }
+    stopBodyEncoding();
+    stopItemParser();
+    stopIntegrityCheck();
+    mPartParser.reset();
+    stopTransferMonitor();
+    stopTimeouts(true);
+
+    cancelHedge();
+
+    if (mCircuitBreaker) {
+        mCircuitBreaker->recordCancelled();
+        mCircuitBreaker = nullptr;
+    }
+
+    if (mClient) {
+        mClient->release(this);
+    }
+
     if (mNReply) {
         if (mNReply->isRunning()) {
             mNReply->abort();
         }
 
         mResponse.status = 0;
-        mResponse.statusText = "";
-        mResponse.responseText = "{ \"detail\": \"Operation aborted\" }";
+        mResponse.setStatusText("");
+        mResponse.setText("{ \"detail\": \"Operation aborted\" }");
     }
 }
 
@@ -182,6 +390,192 @@ void Request::setNetworkAccessManager(QNetworkAccessManager* nam)
     mNam = nam;
 }
 
+/*!
+ * \brief Request::setClient() Creates this request from the \a client profile.
+ * The default headers and timeout of \a client are taken by sharing its
+ * template \a\b QNetworkRequest, so it should be called before setting headers
+ * of this request.
+ * \param client
+ */
+void Request::setClient(Client* client)
+{
+    mClient = client;
+    if (mClient) {
+        mNRequest = mClient->requestTemplate();
+        mRedirectPolicy = mClient->redirectPolicy();
+    }
+}
+
+Client* Request::client() const
+{
+    return mClient;
+}
+
+/*!
+ * \brief Request::setQmlHttpRequest() Set the \ref QmlHttpRequest this request
+ * was created by, which holds the state shared between requests.
+ * \param qhr
+ */
+void Request::setQmlHttpRequest(QmlHttpRequest* qhr)
+{
+    mQhr = qhr;
+}
+
+QmlHttpRequest* Request::qmlHttpRequest() const
+{
+    return mQhr;
+}
+
+/*!
+ * \brief Request::liveCount() Returns the number of \ref Request objects alive
+ * in this process.
+ * \return
+ */
+int Request::liveCount()
+{
+    return sLiveCount.load(std::memory_order_relaxed);
+}
+
+/*!
+ * \brief Request::setHedgeDelay() Enables hedging of this request if it is a
+ * \a GET or \a HEAD request. When no response has arrived \a delay
+ * milliseconds after sending, a duplicate request is sent and the first
+ * response wins. A negative \a delay uses the 95th percentile of the time to
+ * first byte observed by the hedged requests of the host. Zero, the default,
+ * disables hedging.
+ * \see QmlHttpRequest::maxHedgeRatio
+ * \param delay
+ */
+void Request::setHedgeDelay(int delay)
+{
+    if (mHedging || delay != 0) {
+        hedging().delay = delay;
+    }
+}
+
+int Request::hedgeDelay() const
+{
+    return mHedging ? mHedging->delay : 0;
+}
+
+Request::Hedging& Request::hedging()
+{
+    if (!mHedging) {
+        mHedging = std::make_unique<Hedging>();
+    }
+    return *mHedging;
+}
+
+QJSValue Request::onDownloadProgress() const
+{
+    return mCallbacks ? mCallbacks->downloadProgress : QJSValue();
+}
+
+void Request::setOnDownloadProgress(const QJSValue& cb)
+{
+    callbacks().downloadProgress = cb;
+}
+
+QJSValue Request::onUploadProgress() const
+{
+    return mCallbacks ? mCallbacks->uploadProgress : QJSValue();
+}
+
+void Request::setOnUploadProgress(const QJSValue& cb)
+{
+    callbacks().uploadProgress = cb;
+}
+
+QJSValue Request::onRedirected() const
+{
+    return mCallbacks ? mCallbacks->redirected : QJSValue();
+}
+
+void Request::setOnRedirected(const QJSValue& cb)
+{
+    callbacks().redirected = cb;
+}
+
+QJSValue Request::onAborted() const
+{
+    return mCallbacks ? mCallbacks->aborted : QJSValue();
+}
+
+void Request::setOnAborted(const QJSValue& cb)
+{
+    callbacks().aborted = cb;
+}
+
+QJSValue Request::onTimeout() const
+{
+    return mCallbacks ? mCallbacks->timeout : QJSValue();
+}
+
+void Request::setOnTimeout(const QJSValue& cb)
+{
+    callbacks().timeout = cb;
+}
+
+QJSValue Request::onError() const
+{
+    return mCallbacks ? mCallbacks->error : QJSValue();
+}
+
+void Request::setOnError(const QJSValue& cb)
+{
+    callbacks().error = cb;
+}
+
+QJSValue Request::onItem() const
+{
+    return mCallbacks ? mCallbacks->item : QJSValue();
+}
+
+/*!
+ * \brief Request::setOnItem() Set the callback receiving the items of a JSON
+ * array or newline delimited JSON response while it is downloaded, as arrays
+ * of up to 64 items. The response is parsed on a worker thread and is not
+ * kept, so \ref responseText stays empty. The request is \a Done once all
+ * items were delivered.
+ * \param cb
+ */
+void Request::setOnItem(const QJSValue& cb)
+{
+    callbacks().item = cb;
+}
+
+QJSValue Request::onPart() const
+{
+    return mCallbacks ? mCallbacks->part : QJSValue();
+}
+
+/*!
+ * \brief Request::setOnPart() Set the callback receiving each part of a
+ * \a multipart/mixed or \a multipart/byteranges response as soon as it is
+ * received, as an object with \a index, \a headers named in lower case, \a
+ * contentType and \a body, a string for textual types and an \a ArrayBuffer
+ * otherwise. The response is not kept, so \ref responseText stays empty. A
+ * response ending before its closing boundary fails with \a StreamParseError.
+ * \param cb
+ */
+void Request::setOnPart(const QJSValue& cb)
+{
+    callbacks().part = cb;
+}
+
+/*!
+ * \brief Request::callbacks() Returns the side storage of rarely used
+ * callbacks, allocating it on first use.
+ * \return
+ */
+Request::Callbacks& Request::callbacks()
+{
+    if (!mCallbacks) {
+        mCallbacks = std::make_unique<Callbacks>();
+    }
+    return *mCallbacks;
+}
+
 /*!
  * \brief Request::setTimeout() Set transfer time out of this request. Zero
  * means no time out.
@@ -205,12 +599,14 @@ QVariant Request::response() const
         // Request is sent
         return mNReply->readAll();
     }
-    return mResponse.response;
+    // Not decoded into a value yet, see responseText()
+    return QVariant();
 }
 
 /*!
  * \brief Returns the response text of this request if content type is 'text'
- * and an empty string if request is not set or was unsuccessful
+ * and an empty string if request is not set or was unsuccessful. The body is
+ * decoded with the charset of its content type on first access.
  * \return
  */
 QString Request::responseText() const
@@ -219,7 +615,7 @@ QString Request::responseText() const
         // Request is sent
         return mNReply->readAll();
     }
-    return mResponse.responseText;
+    return mResponse.text();
 }
 
 /*!
@@ -233,7 +629,8 @@ void Request::sendNoBodyRequest()
         switch (mMethod) {
         case Method::GET:
         case Method::HEAD:
-            mNReply = mNam->sendCustomRequest(mNRequest, mMethodName);
+            mNReply = transportManager()->sendCustomRequest(
+                mNRequest, mMethodName);
             break;
         default:
             break;
@@ -243,7 +640,9 @@ void Request::sendNoBodyRequest()
 
 /*!
  * \brief Request::sendBodyRequest() This method is used by \ref Request::send()
- * to perform sending a request that needs (has) a body
+ * to perform sending a request that needs (has) a body. Objects and arrays
+ * are encoded natively for JSON, form url encoded, CBOR and MessagePack
+ * content types, see \ref BodyEncoder
  * \param body
  */
 void Request::sendBodyRequest(const QVariant& body)
@@ -259,16 +658,40 @@ void Request::sendBodyRequest(const QVariant& body)
                 = mNRequest.header(QNetworkRequest::ContentTypeHeader)
                       .toByteArray();
 
+            if (mBodyDevice) {
+                sendBodyRequestDevice(mBodyDevice);
+                break;
+            }
+            if (!contentType.startsWith("multipart/")
+                && body.userType() == QMetaType::QUrl
+                && body.toUrl().isLocalFile()) {
+                sendBodyRequestFile(body.toUrl());
+                break;
+            }
+
+            QByteArray binary;
+            const bool isBinary = binaryBody(body, binary);
+
             if (contentType.isEmpty()) {
+                if (isBinary) {
+                    contentType = "application/octet-stream";
+                } else if (body.userType() == QMetaType::QString) {
+                    contentType = "text/plain;charset=UTF-8";
+                } else {
+                    contentType = "application/json";
+                }
                 mNRequest.setHeader(
-                    QNetworkRequest::ContentTypeHeader, "application/json");
+                    QNetworkRequest::ContentTypeHeader, contentType);
             }
 
-            if (contentType.startsWith("application/")
-                || contentType.startsWith("text/")) {
-                sendBodyRequestText(body);
-            } else if (contentType.startsWith("multipart/")) {
+            if (contentType.startsWith("multipart/")) {
                 sendBodyRequestMultipart(body);
+            } else if (isBinary) {
+                sendBodyRequestBinary(binary);
+            } else if (BodyEncoder::encode(contentType, body, binary)) {
+                sendBodyRequestBinary(binary);
+            } else {
+                sendBodyRequestText(body);
             }
             break;
         }
@@ -287,11 +710,161 @@ void Request::sendBodyRequest(const QVariant& body)
  */
 void Request::sendBodyRequestText(const QVariant& body)
 {
-    mNReply
-        = mNam->sendCustomRequest(mNRequest, mMethodName, body.toByteArray());
+    mNReply = transportManager()->sendCustomRequest(
+        mNRequest, mMethodName, body.toByteArray());
+    return;
+}
+
+/*!
+ * \brief Request::sendBodyRequestBinary() This method should be used when the
+ * body of this request is binary data, like an \a ArrayBuffer or a \a
+ * TypedArray from QML
+ * \param body The bytes to be sent as is. They are shared with the \a\b
+ * QNetworkReply and not copied.
+ */
+void Request::sendBodyRequestBinary(const QByteArray& body)
+{
+    mNReply = transportManager()->sendCustomRequest(
+        mNRequest, mMethodName, body);
     return;
 }
 
+/*!
+ * \brief Request::binaryBody() Checks whether \a body holds binary data and
+ * stores its bytes in \a bytes if so. The engine converts an \a ArrayBuffer to
+ * a \a\b QByteArray, which is shared as is. A \a TypedArray or \a DataView
+ * arrives as a \a\b QJSValue and only the bytes of its view are taken from its
+ * underlying buffer, without copying when the view covers the whole buffer.
+ * \param body
+ * \param bytes
+ * \return True if \a body is binary data
+ */
+bool Request::binaryBody(const QVariant& body, QByteArray& bytes)
+{
+    if (body.userType() == QMetaType::QByteArray) {
+        bytes = body.toByteArray();
+        return true;
+    }
+
+    if (body.userType() != qMetaTypeId<QJSValue>()) {
+        return false;
+    }
+
+    const auto view = body.value<QJSValue>();
+    const auto offset = view.property("byteOffset");
+    const auto length = view.property("byteLength");
+    if (!offset.isNumber() || !length.isNumber()) {
+        return false;
+    }
+
+    const auto buffer = view.property("buffer").toVariant();
+    if (buffer.userType() != QMetaType::QByteArray) {
+        return false;
+    }
+
+    bytes = buffer.toByteArray();
+    if (offset.toInt() != 0 || length.toInt() != bytes.size()) {
+        bytes = bytes.mid(offset.toInt(), length.toInt());
+    }
+    return true;
+}
+
+/*!
+ * \brief Request::bodyBytes() Returns the bytes sent for the in memory \a
+ * body, which is binary data, encoded by \ref BodyEncoder for the content type
+ * of this request, or text.
+ * \param body
+ * \return
+ */
+QByteArray Request::bodyBytes(const QVariant& body) const
+{
+    QByteArray bytes;
+    if (!binaryBody(body, bytes)
+        && !BodyEncoder::encode(
+            mNRequest.header(QNetworkRequest::ContentTypeHeader).toByteArray(),
+            body, bytes)) {
+        bytes = body.toByteArray();
+    }
+    return bytes;
+}
+
+/*!
+ * \brief Request::transportManager() Returns the manager sending this
+ * request, the shared \ref LocalSocketNetworkAccessManager for \a unix: and \a
+ * http+unix:// urls unless responses are being replayed.
+ * \return
+ */
+QNetworkAccessManager* Request::transportManager() const
+{
+    if (LocalSocketNetworkAccessManager::isLocalUrl(mUrl)
+        && !qobject_cast<ReplayNetworkAccessManager*>(mNam)) {
+        return LocalSocketNetworkAccessManager::shared();
+    }
+    return mNam;
+}
+
+/*!
+ * \brief Request::startBodyEncoding() Encodes the object or array body stored
+ * by \ref send() on \ref workerThread() if it is estimated to be larger than
+ * \ref BodyEncoder::AsyncThreshold. Smaller bodies are encoded right away
+ * when sent.
+ * \return True if the request must wait for \ref onBodyEncoded()
+ */
+bool Request::startBodyEncoding()
+{
+    if (mMethod == Method::INVALID || mMethod == Method::GET
+        || mMethod == Method::HEAD) {
+        return false;
+    }
+
+    // Converted to plain variants by send()
+    const auto type = mBody.userType();
+    if (type != QMetaType::QVariantMap && type != QMetaType::QVariantList) {
+        return false;
+    }
+
+    const auto contentType
+        = mNRequest.header(QNetworkRequest::ContentTypeHeader).toByteArray();
+    if (!BodyEncoder::hasEncoder(contentType, mBody)
+        || BodyEncoder::estimateSize(mBody) < BodyEncoder::AsyncThreshold) {
+        return false;
+    }
+
+    if (contentType.isEmpty()) {
+        mNRequest.setHeader(
+            QNetworkRequest::ContentTypeHeader, "application/json");
+    }
+
+    mBodyEncoder = new AsyncBodyEncoder(contentType, mBody);
+    mBodyEncoder->moveToThread(workerThread());
+    connect(mBodyEncoder, &AsyncBodyEncoder::encoded, this,
+        &Request::onBodyEncoded);
+    QMetaObject::invokeMethod(mBodyEncoder, &AsyncBodyEncoder::encode);
+    return true;
+}
+
+void Request::stopBodyEncoding()
+{
+    if (!mBodyEncoder) {
+        return;
+    }
+    mBodyEncoder->disconnect(this);
+    mBodyEncoder->deleteLater();
+    mBodyEncoder = nullptr;
+}
+
+void Request::onBodyEncoded(const QByteArray& bytes)
+{
+    stopBodyEncoding();
+
+    // Kept encoded, so a redirect or a recording does not encode it again
+    mBody = bytes;
+    if (startUploadChecksum()) {
+        return;
+    }
+    sendRequest();
+}
+
 /*!
  * \brief Request::sendBodyRequestMultipart() This method should be used when
  * the content-type of this request is multipart type, like \a
@@ -332,12 +905,74 @@ void Request::sendBodyRequestMultipart(const QVariant& body)
             QString("multipart/form-data; boundary=" + mpBody->boundary()));
 
         // Send multipart data request
-        mNReply = mNam->sendCustomRequest(mNRequest, mMethodName, mpBody);
+        mNReply = transportManager()->sendCustomRequest(
+            mNRequest, mMethodName, mpBody);
         mpBody->setParent(mNReply);
     }
     return;
 }
 
+/*!
+ * \brief Request::sendBodyRequestFile() This method is used when the body of
+ * this request is a local file url and content-type is not multipart. The file
+ * is streamed from disk, so memory usage does not depend on file size.
+ * \param url The url of the local file to be sent as the body
+ */
+void Request::sendBodyRequestFile(const QUrl& url)
+{
+    QFile* file = new QFile(url.toLocalFile());
+    if (!file->open(QFile::ReadOnly)) {
+        const auto error = file->errorString();
+        delete file;
+        failFast(Error::BodyReadError,
+            QString("Cannot open file %1: %2").arg(url.toString(), error));
+        return;
+    }
+
+    if (mNRequest.header(QNetworkRequest::ContentTypeHeader).isNull()) {
+        mNRequest.setHeader(QNetworkRequest::ContentTypeHeader,
+            QMimeDatabase().mimeTypeForFile(file->fileName()).name());
+    }
+    mNRequest.setHeader(QNetworkRequest::ContentLengthHeader, file->size());
+
+    mNReply = transportManager()->sendCustomRequest(
+        mNRequest, mMethodName, file);
+    // Set file parent to mNReply so it is deleted automatically
+    file->setParent(mNReply);
+    return;
+}
+
+/*!
+ * \brief Request::sendBodyRequestDevice() This method is used when the body of
+ * this request is a \a\b QIODevice set by \ref send(QIODevice*). The device is
+ * read while uploading and is not owned by this request.
+ * \param device
+ */
+void Request::sendBodyRequestDevice(QIODevice* device)
+{
+    if (!device->isOpen() && !device->open(QIODevice::ReadOnly)) {
+        failFast(Error::BodyReadError,
+            QString("Cannot open body device: %1").arg(device->errorString()));
+        return;
+    }
+
+    if (mNRequest.header(QNetworkRequest::ContentTypeHeader).isNull()) {
+        mNRequest.setHeader(
+            QNetworkRequest::ContentTypeHeader, "application/octet-stream");
+    }
+
+    if (!device->isSequential()) {
+        // The device may be reused for a redirected request
+        device->seek(0);
+        mNRequest.setHeader(
+            QNetworkRequest::ContentLengthHeader, device->size());
+    }
+
+    mNReply = transportManager()->sendCustomRequest(
+        mNRequest, mMethodName, device);
+    return;
+}
+
 void Request::multipartAddObject(
     QHttpMultiPart* mpBody, QString prefix, const QJsonObject& body)
 {
@@ -419,13 +1054,917 @@ void Request::multipartAddValue(
 }
 
 /*!
- * \brief Request::setupReplyConnections() Set up required connections for \a\b
- * QNetworkReply to call related callbacks if they exist.
+ * \brief Request::startItemParser() Creates the parser feeding \ref onItem()
+ * in \ref workerThread().
  */
-void Request::setupReplyConnections()
+void Request::startItemParser()
 {
-    connect(mNReply, &QNetworkReply::readyRead, this, &Request::onReplyReadReady);
-    connect(mNReply, &QNetworkReply::finished, this, &Request::onReplyFinished);
+    stopItemParser();
+
+    mItemParser = new JsonStreamParser;
+    mItemParser->moveToThread(workerThread());
+    connect(mItemParser, &JsonStreamParser::itemsParsed, this,
+        &Request::onItemsParsed);
+    connect(mItemParser, &JsonStreamParser::finished, this,
+        &Request::onItemParserFinished);
+}
+
+void Request::stopItemParser()
+{
+    if (mItemParser) {
+        mItemParser->disconnect(this);
+        mItemParser->deleteLater();
+        mItemParser = nullptr;
+    }
+}
+
+void Request::onItemsParsed(const QVariantList& items)
+{
+    if (auto engine = qjsEngine(this)) {
+        callCallback("onitem", onItem(), { engine->toScriptValue(items) });
+    }
+}
+
+void Request::onItemParserFinished(const QString& error)
+{
+    stopItemParser();
+
+    if (error.isEmpty()) {
+        finishIfDrained();
+    } else {
+        stopIntegrityCheck();
+        failFast(Error::StreamParseError, error);
+    }
+}
+
+/*!
+ * \brief Request::startPartParser() Starts splitting the response into parts
+ * if it is a multipart one. Unlike items, parts are split on this thread, as
+ * finding boundaries costs little next to copying the chunks to a worker.
+ */
+void Request::startPartParser()
+{
+    const auto boundary
+        = MultipartParser::boundary(mNReply->rawHeader("Content-Type"));
+    if (!boundary.isEmpty()) {
+        mPartParser = std::make_unique<MultipartParser>(boundary);
+    }
+}
+
+static bool isTextType(const QByteArray& contentType)
+{
+    const auto type = contentType.split(';').first().trimmed().toLower();
+    // Parts without a type are text/plain
+    return type.isEmpty() || type.startsWith("text/") || type.contains("json")
+        || type.contains("xml") || type.contains("javascript");
+}
+
+void Request::feedParts(const QByteArray& chunk)
+{
+    mPartParser->feed(chunk);
+    const auto parts = mPartParser->takeParts();
+    auto engine = qjsEngine(this);
+    if (!engine) {
+        return;
+    }
+
+    for (const auto& part : parts) {
+        auto headers = engine->newObject();
+        const auto pairs = part.headers();
+        for (const auto& header : pairs) {
+            headers.setProperty(QString::fromLatin1(header.first.toLower()),
+                QString::fromUtf8(header.second));
+        }
+
+        const auto contentType = part.header("Content-Type");
+        const auto body = part.body();
+        auto value = engine->newObject();
+        value.setProperty("index", part.index);
+        value.setProperty("headers", headers);
+        value.setProperty("contentType", QString::fromUtf8(contentType));
+        value.setProperty("body",
+            isTextType(contentType)
+                ? QJSValue(Response::decode(
+                    body, Response::charset(contentType)))
+                : engine->toScriptValue(QByteArray(body.constData(),
+                    body.size())));
+        callCallback("onpart", onPart(), { value });
+    }
+}
+
+/*!
+ * \brief Request::setGroup() Tags this request with \a group, so it can be
+ * aborted together with the other requests of the group by \ref
+ * QmlHttpRequest::abortGroup(), for instance when the page that created them
+ * is closed.
+ * \param group
+ */
+void Request::setGroup(const QString& group)
+{
+    if (group == mGroup) {
+        return;
+    }
+
+    if (mQhr && !mGroup.isEmpty()) {
+        mQhr->removeFromGroup(this, mGroup);
+    }
+    mGroup = group;
+    if (mQhr && !mGroup.isEmpty()) {
+        mQhr->addToGroup(this, mGroup);
+    }
+}
+
+/*!
+ * \brief Request::setLowSpeedLimit() Set the transfer rate in bytes per second
+ * under which the request is aborted once it stayed there for \ref
+ * lowSpeedTime. Unlike \ref timeout this catches transfers that trickle
+ * along. A stalled request calls \ref onTimeout with \a "lowSpeed", or \ref
+ * onError with \a TimeoutError. Zero, the default, disables the limit.
+ * \see QmlHttpRequest::lowSpeedLimit
+ * \param bytesPerSecond
+ */
+void Request::setLowSpeedLimit(int bytesPerSecond)
+{
+    if (mTransfer || bytesPerSecond > 0) {
+        transferMonitor().lowSpeedLimit = qMax(0, bytesPerSecond);
+    }
+}
+
+int Request::lowSpeedLimit() const
+{
+    return mTransfer ? mTransfer->lowSpeedLimit : 0;
+}
+
+/*!
+ * \brief Request::setLowSpeedTime() Set how long, in milliseconds, the
+ * transfer rate must stay under \ref lowSpeedLimit before the request is
+ * aborted. Default is 30000, so setting only a limit is enough.
+ * \param time
+ */
+void Request::setLowSpeedTime(int time)
+{
+    if (mTransfer || time != TransferMonitor::DefaultLowSpeedTime) {
+        transferMonitor().lowSpeedTime = qMax(0, time);
+    }
+}
+
+int Request::lowSpeedTime() const
+{
+    return mTransfer ? mTransfer->lowSpeedTime
+                     : TransferMonitor::DefaultLowSpeedTime;
+}
+
+/*!
+ * \brief Request::transferRate() Returns the rate, in bytes per second, the
+ * request body and response were transferred at over the last seconds. It is
+ * only measured while a \ref lowSpeedLimit is set or the property is bound.
+ * \return
+ */
+double Request::transferRate() const
+{
+    return mTransfer ? mTransfer->rate : 0;
+}
+
+Request::TransferMonitor& Request::transferMonitor()
+{
+    if (!mTransfer) {
+        mTransfer = std::make_unique<TransferMonitor>();
+    }
+    return *mTransfer;
+}
+
+/*!
+ * \brief Request::startTransferMonitor() Starts sampling the transferred bytes
+ * every second if a low speed limit is set or \ref transferRate is observed.
+ */
+void Request::startTransferMonitor()
+{
+    if (mTransfer) {
+        mTransfer->stalled = false;
+    }
+
+    const bool limited = mTransfer && mTransfer->lowSpeedLimit > 0
+        && mTransfer->lowSpeedTime > 0;
+    if (!limited
+        && !isSignalConnected(
+            QMetaMethod::fromSignal(&Request::transferRateChanged))) {
+        return;
+    }
+
+    auto& monitor = transferMonitor();
+    monitor.bytesReceived = 0;
+    monitor.bytesSent = 0;
+    monitor.samples.fill(0);
+    monitor.sampleCount = 1;
+    monitor.slowTime = 0;
+    monitor.stalled = false;
+    monitor.timer.start(TransferMonitor::Interval, this);
+}
+
+void Request::stopTransferMonitor()
+{
+    if (mTransfer && mTransfer->timer.isActive()) {
+        mTransfer->timer.stop();
+        if (mTransfer->rate != 0) {
+            mTransfer->rate = 0;
+            emit transferRateChanged();
+        }
+    }
+}
+
+/*!
+ * \brief Request::sampleTransfer() Updates \ref transferRate over a sliding
+ * window of the last samples and aborts the reply if it stayed under \ref
+ * lowSpeedLimit for \ref lowSpeedTime.
+ */
+void Request::sampleTransfer()
+{
+    auto& monitor = *mTransfer;
+    const int size = int(monitor.samples.size());
+    const qint64 total = monitor.bytesReceived + monitor.bytesSent;
+
+    const int oldest = monitor.sampleCount < size ? 0 : monitor.sampleCount % size;
+    const int window = qMin(monitor.sampleCount, size);
+    const qint64 transferred = total - monitor.samples[oldest];
+    monitor.samples[monitor.sampleCount % size] = total;
+    ++monitor.sampleCount;
+
+    const double rate
+        = double(transferred) * 1000.0 / (window * TransferMonitor::Interval);
+    if (rate != monitor.rate) {
+        monitor.rate = rate;
+        emit transferRateChanged();
+    }
+
+    if (monitor.lowSpeedLimit <= 0 || monitor.lowSpeedTime <= 0 || !mNReply) {
+        return;
+    }
+
+    if (rate < monitor.lowSpeedLimit) {
+        monitor.slowTime += TransferMonitor::Interval;
+    } else {
+        monitor.slowTime = 0;
+    }
+
+    if (monitor.slowTime >= monitor.lowSpeedTime) {
+        trace("stalled");
+        monitor.stalled = true;
+        monitor.timer.stop();
+        mNReply->abort();
+    }
+}
+
+/*!
+ * \brief Request::setConnectTimeout() Set the time, in milliseconds, allowed
+ * to connect to the server and send the request. When it expires the request
+ * is aborted and \ref onTimeout is called with \a "connect", or \ref onError
+ * with \a TimeoutError. A dead host then fails fast while a slow transfer is
+ * left running. Zero, the default, disables it.
+ * \note Before Qt 6.3 the connection is only known to be established once the
+ * body starts uploading or the response arrives, the timeout then covers the
+ * wait for the first byte as well.
+ * \see QmlHttpRequest::connectTimeout
+ * \param timeout
+ */
+void Request::setConnectTimeout(int timeout)
+{
+    if (mTimeouts || timeout > 0) {
+        timeouts().connect = qMax(0, timeout);
+    }
+}
+
+int Request::connectTimeout() const
+{
+    return mTimeouts ? mTimeouts->connect : 0;
+}
+
+/*!
+ * \brief Request::setFirstByteTimeout() Set the time, in milliseconds, allowed
+ * between sending the request and receiving the response headers. When it
+ * expires \ref onTimeout is called with \a "firstByte". Zero, the default,
+ * disables it.
+ * \param timeout
+ */
+void Request::setFirstByteTimeout(int timeout)
+{
+    if (mTimeouts || timeout > 0) {
+        timeouts().firstByte = qMax(0, timeout);
+    }
+}
+
+int Request::firstByteTimeout() const
+{
+    return mTimeouts ? mTimeouts->firstByte : 0;
+}
+
+/*!
+ * \brief Request::setDeadline() Set the total time, in milliseconds, the
+ * request may take from \ref send() until it is done, including redirects and
+ * waiting in the queue of its client profile. When it expires \ref onTimeout
+ * is called with \a "deadline". Zero, the default, disables it.
+ * \param deadline
+ */
+void Request::setDeadline(int deadline)
+{
+    if (mTimeouts || deadline > 0) {
+        timeouts().deadline = qMax(0, deadline);
+    }
+}
+
+int Request::deadline() const
+{
+    return mTimeouts ? mTimeouts->deadline : 0;
+}
+
+Request::Timeouts& Request::timeouts()
+{
+    if (!mTimeouts) {
+        mTimeouts = std::make_unique<Timeouts>();
+    }
+    return *mTimeouts;
+}
+
+void Request::startDeadline()
+{
+    if (!mTimeouts) {
+        return;
+    }
+
+    stopTimeouts(true);
+    mTimeouts->expired = nullptr;
+    if (mTimeouts->deadline > 0) {
+        mTimeouts->deadlineTimer = TimerWheel::shared()->start(
+            mTimeouts->deadline, this, [this]() {
+                mTimeouts->deadlineTimer = 0;
+                onTimeoutExpired("deadline");
+            });
+    }
+}
+
+/*!
+ * \brief Request::startTimeouts() Starts the connect and first byte timeouts
+ * of the reply just sent on the shared \ref TimerWheel.
+ */
+void Request::startTimeouts()
+{
+    if (!mTimeouts) {
+        return;
+    }
+
+    stopTimeouts(false);
+    auto wheel = TimerWheel::shared();
+    if (mTimeouts->connect > 0) {
+        mTimeouts->connectTimer
+            = wheel->start(mTimeouts->connect, this, [this]() {
+                  mTimeouts->connectTimer = 0;
+                  onTimeoutExpired("connect");
+              });
+    }
+    if (mTimeouts->firstByte > 0) {
+        mTimeouts->firstByteTimer
+            = wheel->start(mTimeouts->firstByte, this, [this]() {
+                  mTimeouts->firstByteTimer = 0;
+                  onTimeoutExpired("firstByte");
+              });
+    }
+}
+
+/*!
+ * \brief Request::stopTimeouts() Stops the connect and first byte timeouts,
+ * and the \a deadline too if set.
+ * \param deadline
+ */
+void Request::stopTimeouts(bool deadline)
+{
+    if (!mTimeouts) {
+        return;
+    }
+
+    for (auto timer : { &mTimeouts->connectTimer, &mTimeouts->firstByteTimer,
+             &mTimeouts->deadlineTimer }) {
+        if (*timer && (deadline || timer != &mTimeouts->deadlineTimer)) {
+            TimerWheel::shared()->stop(*timer);
+            *timer = 0;
+        }
+    }
+}
+
+void Request::onReplyConnected()
+{
+    if (mTimeouts && mTimeouts->connectTimer) {
+        TimerWheel::shared()->stop(mTimeouts->connectTimer);
+        mTimeouts->connectTimer = 0;
+    }
+}
+
+void Request::onReplyResponseStarted()
+{
+    stopTimeouts(false);
+}
+
+/*!
+ * \brief Request::onTimeoutExpired() Aborts the request because the timeout
+ * named \a reason expired. A running reply reports it once aborted, otherwise
+ * the request is completed right away.
+ * \param reason
+ */
+void Request::onTimeoutExpired(const char* reason)
+{
+    trace("timeout", 'n', QString(reason));
+    stopTimeouts(true);
+    mTimeouts->expired = reason;
+
+    if (mNReply && mNReply->isRunning()) {
+        // Reported by onReplyErrorOccured()
+        mNReply->abort();
+        return;
+    }
+
+    // Not sent yet, or only parsing or hashing of its body is left
+    mResponse.clear();
+    mResponse.setText(
+        QString("{ \"detail\": \"%1 timeout expired\" }").arg(reason));
+    reportTimeout();
+    cancel();
+    if (mState != State::Done) {
+        finish();
+    }
+}
+
+void Request::reportTimeout()
+{
+    const QString reason = mTimeouts->expired;
+    if (onTimeout().isCallable()) {
+        callCallback("ontimeout", onTimeout(), { reason });
+    } else if (onError().isCallable()) {
+        const int timeout = reason == "connect" ? mTimeouts->connect
+            : reason == "firstByte"             ? mTimeouts->firstByte
+                                                : mTimeouts->deadline;
+        callCallback("onerror", onError(),
+            {
+                QNetworkReply::TimeoutError,
+                QString("%1 timeout of %2 ms expired").arg(reason).arg(timeout),
+            });
+    }
+}
+
+/*!
+ * \qmlmethod poll()
+ * \brief Request::poll() Sends the opened request now and again every \a
+ * interval milliseconds until \ref stopPolling() is called. Polls after the
+ * first are conditional on the \a ETag and \a Last-Modified of the last
+ * response. A \a 304 or a body identical to the last one leaves the response
+ * as it is, does not call \a onreadystatechange and doubles the interval up
+ * to \a maxInterval, the next change resets it to \a interval. Errors back
+ * off the same way but are reported. Conditional headers set by the caller
+ * are sent as they are instead, and a \a 304 to them is reported. The ready
+ * state goes back to \a Opened while a poll is in flight, the last response is
+ * kept until it is replaced. Polls falling due while the application is not
+ * active are sent once it is active again.
+ * \param interval
+ * \param maxInterval Defaults to \ref Polling::MaxBackoff times \a interval
+ */
+void Request::poll(int interval, int maxInterval)
+{
+    if (interval <= 0) {
+        stopPolling();
+        return;
+    }
+    if (!isOpen()) {
+        qCritical("Request should be opened first by calling 'open()' method.");
+        return;
+    }
+
+    const bool started = !mPoll;
+    if (started) {
+        mPoll = std::make_unique<Polling>();
+        mPoll->callerValidators
+            = !mNRequest.rawHeader("If-None-Match").isEmpty()
+            || !mNRequest.rawHeader("If-Modified-Since").isEmpty();
+        if (auto app = qobject_cast<QGuiApplication*>(
+                QCoreApplication::instance())) {
+            mPoll->appState = connect(app,
+                &QGuiApplication::applicationStateChanged, this,
+                [this]() { resumePoll(); });
+        }
+    }
+    mPoll->interval = interval;
+    mPoll->maxInterval = maxInterval > 0 ? qMax(interval, maxInterval)
+                                         : interval * Polling::MaxBackoff;
+    mPoll->current = interval;
+    mPoll->due = false;
+    mPoll->timer.stop();
+
+    if (started) {
+        emit pollingChanged();
+    }
+    sendPoll();
+}
+
+/*!
+ * \qmlmethod stopPolling()
+ * \brief Request::stopPolling() Stops polling started by \ref poll(). A poll
+ * in flight is not aborted, an auto released request is deleted once it is
+ * done.
+ */
+void Request::stopPolling()
+{
+    if (!mPoll) {
+        return;
+    }
+
+    disconnect(mPoll->appState);
+    if (!mPoll->callerValidators) {
+        mNRequest.setRawHeader("If-None-Match", QByteArray());
+        mNRequest.setRawHeader("If-Modified-Since", QByteArray());
+    }
+    mPoll.reset();
+    emit pollingChanged();
+
+    // Otherwise released by finish()
+    if (mAutoRelease && !isPending()) {
+        deleteLater();
+    }
+}
+
+/*!
+ * \brief Request::pollInterval() Returns the interval until the next poll,
+ * grown by unchanged responses, or zero when not polling.
+ * \return
+ */
+int Request::pollInterval() const
+{
+    return mPoll ? mPoll->current : 0;
+}
+
+void Request::sendPoll()
+{
+    if (mNReply || mBodyEncoder || isWaiting()) {
+        // Scheduled again once the request in flight is done
+        return;
+    }
+
+    if (auto app = qobject_cast<QGuiApplication*>(
+            QCoreApplication::instance());
+        app && app->applicationState() != Qt::ApplicationActive) {
+        mPoll->due = true;
+        return;
+    }
+
+    if (!mPoll->callerValidators) {
+        // Empty validators remove the headers
+        mNRequest.setRawHeader("If-None-Match", mPoll->etag);
+        mNRequest.setRawHeader("If-Modified-Since", mPoll->lastModified);
+    }
+    trace("poll", 'n', mUrl);
+    // In flight again, but the last response stays until it is replaced
+    mState = State::Opened;
+    send(mBody);
+}
+
+void Request::schedulePoll(bool changed)
+{
+    mPoll->current = changed
+        ? mPoll->interval
+        : qMin(mPoll->current * 2, mPoll->maxInterval);
+    mPoll->timer.start(mPoll->current, Qt::CoarseTimer, this);
+}
+
+/*!
+ * \brief Request::isPollChanged() Tells whether the response of a poll
+ * changed and updates the validators sent with the next one. Only successful
+ * responses are compared, by their validators and the hash of their \a body
+ * when it was not \a streamed to \a onitem or an integrity check.
+ * \param body
+ * \param streamed
+ * \return
+ */
+bool Request::isPollChanged(const QByteArray& body, bool streamed)
+{
+    const int status
+        = mNReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status == 304) {
+        // Reported when answering the conditional headers of the caller
+        return mPoll->callerValidators;
+    }
+
+    if (mNReply->error() != QNetworkReply::NoError || status < 200
+        || status >= 300) {
+        // The error replaces the response, the next poll is unconditional
+        mPoll->etag.clear();
+        mPoll->lastModified.clear();
+        mPoll->bodyHash.clear();
+        return true;
+    }
+
+    const auto hash = streamed
+        ? QByteArray()
+        : QCryptographicHash::hash(body, QCryptographicHash::Sha1);
+    const bool changed = hash.isEmpty() || hash != mPoll->bodyHash;
+    mPoll->etag = mNReply->rawHeader("ETag");
+    mPoll->lastModified = mNReply->rawHeader("Last-Modified");
+    mPoll->bodyHash = hash;
+    return changed;
+}
+
+void Request::resumePoll()
+{
+    if (mPoll && mPoll->due) {
+        mPoll->due = false;
+        sendPoll();
+    }
+}
+
+/*!
+ * \brief Request::setIntegrity() Set the expected digest of the response body
+ * as a subresource integrity value, like \a "sha256-<base64>", or \a "header"
+ * to verify the body against the \a Digest, \a Content-Digest or \a
+ * Content-MD5 header of the response. The body is hashed on a worker thread
+ * while it is received. On mismatch the request fails with \a IntegrityError
+ * and its response text is cleared.
+ * \param integrity
+ */
+void Request::setIntegrity(const QString& integrity)
+{
+    if (mIntegrity || !integrity.isEmpty()) {
+        integrityCheck().expected = integrity;
+    }
+}
+
+QString Request::integrity() const
+{
+    return mIntegrity ? mIntegrity->expected : QString();
+}
+
+/*!
+ * \brief Request::setUploadChecksum() Set the algorithm, \a md5, \a sha256 or
+ * \a sha512, of a checksum of the request body sent in a \a Content-MD5 or \a
+ * Digest header. It is computed on a worker thread before the request is sent,
+ * reading a file body once. Only a device body other than a \a\b QFile or a \a\b
+ * QBuffer is read right away in the calling thread, since it can not be read in
+ * another one.
+ * \param algorithm
+ */
+void Request::setUploadChecksum(const QString& algorithm)
+{
+    if (mIntegrity || !algorithm.isEmpty()) {
+        integrityCheck().uploadChecksum = algorithm;
+    }
+}
+
+QString Request::uploadChecksum() const
+{
+    return mIntegrity ? mIntegrity->uploadChecksum : QString();
+}
+
+Request::IntegrityCheck& Request::integrityCheck()
+{
+    if (!mIntegrity) {
+        mIntegrity = std::make_unique<IntegrityCheck>();
+    }
+    return *mIntegrity;
+}
+
+/*!
+ * \brief Request::startUploadChecksum() Computes the checksum header of the
+ * body stored by \ref send() if \ref uploadChecksum is set. Bodies are hashed
+ * on \ref workerThread(), except random access devices other than files and
+ * buffers, which are hashed right away.
+ * \return True if the request must wait for \ref onUploadChecksumReady()
+ */
+bool Request::startUploadChecksum()
+{
+    if (!mIntegrity || mIntegrity->uploadChecksum.isEmpty()
+        || mMethod == Method::GET || mMethod == Method::HEAD) {
+        return false;
+    }
+
+    StreamHasher::Algorithm algorithm;
+    if (!StreamHasher::parseAlgorithm(mIntegrity->uploadChecksum, algorithm)) {
+        qWarning() << "Unsupported upload checksum" << mIntegrity->uploadChecksum;
+        return false;
+    }
+
+    QString fileName;
+    QByteArray bytes;
+    if (mBodyDevice) {
+        if (mBodyDevice->isSequential()) {
+            qWarning("Upload checksum needs a random access device");
+            return false;
+        }
+
+        // The device is sent from its beginning, files and buffers are read
+        // again on the worker instead
+        const auto file = qobject_cast<QFile*>(mBodyDevice);
+        const auto buffer = qobject_cast<QBuffer*>(mBodyDevice);
+        if (file && !file->fileName().isEmpty()) {
+            fileName = file->fileName();
+        } else if (buffer) {
+            bytes = buffer->data();
+        } else {
+            // Other devices can only be read in their own thread
+            const auto position = mBodyDevice->pos();
+            if (!mBodyDevice->seek(0)) {
+                qWarning("Upload checksum needs a random access device");
+                return false;
+            }
+            QCryptographicHash hash(algorithm);
+            hash.addData(mBodyDevice);
+            mBodyDevice->seek(position);
+            const auto header
+                = StreamHasher::checksumHeader(algorithm, hash.result());
+            mNRequest.setRawHeader(header.first, header.second);
+            return false;
+        }
+    } else if (mNRequest.header(QNetworkRequest::ContentTypeHeader)
+                   .toByteArray()
+                   .startsWith("multipart/")) {
+        qWarning("Upload checksum is not supported for multipart bodies");
+        return false;
+    } else if (mBody.userType() == QMetaType::QUrl
+        && mBody.toUrl().isLocalFile()) {
+        fileName = mBody.toUrl().toLocalFile();
+    } else {
+        bytes = bodyBytes(mBody);
+    }
+
+    auto hasher = new StreamHasher(algorithm);
+    hasher->moveToThread(workerThread());
+    connect(hasher, &StreamHasher::finished, this,
+        &Request::onUploadChecksumReady);
+    mIntegrity->uploadHasher = hasher;
+
+    if (!fileName.isEmpty()) {
+        QMetaObject::invokeMethod(hasher, [hasher, fileName]() {
+            hasher->addFile(fileName);
+            hasher->finish();
+        });
+    } else {
+        QMetaObject::invokeMethod(hasher, [hasher, bytes]() {
+            hasher->addData(bytes);
+            hasher->finish();
+        });
+    }
+    return true;
+}
+
+void Request::onUploadChecksumReady(const QByteArray& digest)
+{
+    const auto algorithm = mIntegrity->uploadHasher->algorithm();
+    mIntegrity->uploadHasher->disconnect(this);
+    mIntegrity->uploadHasher->deleteLater();
+    mIntegrity->uploadHasher = nullptr;
+
+    if (digest.isEmpty()) {
+        failFast(Error::IntegrityError, "Cannot read the body to upload");
+        return;
+    }
+
+    const auto header = StreamHasher::checksumHeader(algorithm, digest);
+    mNRequest.setRawHeader(header.first, header.second);
+    sendRequest();
+}
+
+/*!
+ * \brief Request::startIntegrityCheck() Starts hashing the response body. A
+ * response without a supported digest to verify it against fails the request
+ * rather than being trusted.
+ * \return False if the request failed
+ */
+bool Request::startIntegrityCheck()
+{
+    mIntegrity->pending = false;
+
+    StreamHasher::Algorithm algorithm;
+    bool ok = false;
+    if (mIntegrity->expected.compare("header", Qt::CaseInsensitive) == 0) {
+        auto digest = mNReply->rawHeader("Content-Digest");
+        if (digest.isEmpty()) {
+            digest = mNReply->rawHeader("Digest");
+        }
+        ok = StreamHasher::parseDigestHeaders(digest,
+            mNReply->rawHeader("Content-MD5"), algorithm, mIntegrity->digests);
+    } else {
+        ok = StreamHasher::parseIntegrity(
+            mIntegrity->expected, algorithm, mIntegrity->digests);
+    }
+    if (!ok) {
+        failIntegrityCheck(
+            QString("No supported digest to verify the response of %1")
+                .arg(mUrl.toString()));
+        return false;
+    }
+
+    auto hasher = new StreamHasher(algorithm);
+    hasher->moveToThread(workerThread());
+    connect(hasher, &StreamHasher::finished, this, &Request::onIntegrityChecked);
+    mIntegrity->hasher = hasher;
+    return true;
+}
+
+void Request::stopIntegrityCheck()
+{
+    if (!mIntegrity) {
+        return;
+    }
+
+    for (auto hasher : { mIntegrity->hasher, mIntegrity->uploadHasher }) {
+        if (hasher) {
+            hasher->disconnect(this);
+            hasher->deleteLater();
+        }
+    }
+    mIntegrity->hasher = nullptr;
+    mIntegrity->uploadHasher = nullptr;
+    mIntegrity->pending = false;
+    mIntegrity->body.clear();
+}
+
+/*!
+ * \brief Request::failIntegrityCheck() Drops the reply, if still receiving,
+ * and the body streams of a response that can not be trusted and fails this
+ * request with \a IntegrityError.
+ * \param errorString
+ */
+void Request::failIntegrityCheck(const QString& errorString)
+{
+    stopItemParser();
+    stopIntegrityCheck();
+    mPartParser.reset();
+
+    if (mNReply) {
+        stopTransferMonitor();
+        cancelHedge();
+        mNReply->disconnect(this);
+        mNReply->abort();
+        mNReply->deleteLater();
+        mNReply = nullptr;
+    }
+    failFast(Error::IntegrityError, errorString);
+}
+
+void Request::onIntegrityChecked(const QByteArray& digest)
+{
+    const bool valid = mIntegrity->digests.contains(digest);
+    stopIntegrityCheck();
+
+    if (valid) {
+        finishIfDrained();
+    } else {
+        failIntegrityCheck(
+            QString("Integrity check of %1 failed").arg(mUrl.toString()));
+    }
+}
+
+/*!
+ * \brief Request::feedBodyStreams() Hands a received \a chunk of the response
+ * body to the item parser and the integrity hasher. A hashed body that is not
+ * parsed into items is kept to become the response text.
+ */
+void Request::feedBodyStreams(const QByteArray& chunk)
+{
+    if (auto hasher = mIntegrity ? mIntegrity->hasher : nullptr) {
+        QMetaObject::invokeMethod(
+            hasher, [hasher, chunk]() { hasher->addData(chunk); });
+        if (!mItemParser) {
+            mIntegrity->body.append(chunk);
+        }
+    }
+
+    if (auto parser = mItemParser) {
+        QMetaObject::invokeMethod(
+            parser, [parser, chunk]() { parser->feed(chunk); });
+    }
+
+    if (mPartParser) {
+        feedParts(chunk);
+    }
+}
+
+bool Request::hasBodyStreams() const
+{
+    return mItemParser || (mIntegrity && mIntegrity->hasher);
+}
+
+/*!
+ * \brief Request::finishIfDrained() Finishes this request once its reply is
+ * done and its body is parsed and hashed.
+ */
+void Request::finishIfDrained()
+{
+    if (!mNReply && !hasBodyStreams()) {
+        finish();
+    }
+}
+
+/*!
+ * \brief Request::setupReplyConnections() Set up required connections for \a\b
+ * QNetworkReply to call related callbacks if they exist.
+ */
+void Request::setupReplyConnections()
+{
+    connect(mNReply, &QNetworkReply::readyRead, this, &Request::onReplyReadReady);
+    connect(mNReply, &QNetworkReply::finished, this, &Request::onReplyFinished);
 
     connect(mNReply, &QNetworkReply::errorOccurred, this,
         &Request::onReplyErrorOccured);
@@ -438,34 +1977,330 @@ void Request::setupReplyConnections()
 
     connect(mNReply, &QNetworkReply::uploadProgress, this,
             &Request::onReplyUploadProgress);
+
+    // A response to the original reply makes a pending hedge useless
+    connect(mNReply, &QNetworkReply::metaDataChanged, this,
+        &Request::cancelHedge);
+
+    connect(mNReply, &QNetworkReply::metaDataChanged, this,
+        &Request::onReplyResponseStarted);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+    connect(mNReply, &QNetworkReply::requestSent, this,
+        &Request::onReplyConnected);
+#endif
+#if QT_CONFIG(ssl)
+    connect(mNReply, &QNetworkReply::encrypted, this,
+        &Request::onReplyConnected);
+#endif
+}
+
+/*!
+ * \brief Request::failFast() Completes this request without sending it,
+ * reporting \a error to the \ref onError callback.
+ * \param error
+ * \param errorString
+ */
+void Request::failFast(Error error, const QString& errorString)
+{
+    trace("error", 'n', errorString);
+
+    if (mCircuitBreaker) {
+        // Nothing was sent, so the host is not to blame
+        mCircuitBreaker->recordCancelled();
+        mCircuitBreaker = nullptr;
+    }
+
+    mResponse.clear();
+    mResponse.setText(QString("{ \"detail\": \"%1\" }").arg(errorString));
+
+    callCallback("onerror", onError(), { int(error), errorString });
+    finish();
+}
+
+/*!
+ * \brief Request::recordCircuitOutcome() Reports the outcome of the finished
+ * reply to the circuit breaker that allowed it. Network errors, timeouts and
+ * server errors count as failures, aborted requests are not counted.
+ */
+void Request::recordCircuitOutcome()
+{
+    if (!mCircuitBreaker) {
+        return;
+    }
+
+    const auto error = mNReply->error();
+    const int status
+        = mNReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    if (error == QNetworkReply::OperationCanceledError
+        && !(mTransfer && mTransfer->stalled)
+        && !(mTimeouts && mTimeouts->expired)) {
+        mCircuitBreaker->recordCancelled();
+    } else if (status >= 500
+        || (error != QNetworkReply::NoError && status == 0)) {
+        mCircuitBreaker->recordFailure();
+    } else {
+        mCircuitBreaker->recordSuccess();
+    }
+    mCircuitBreaker = nullptr;
+}
+
+/*!
+ * \brief Request::startHedgeTimer() Starts waiting for a response before
+ * hedging this request, if hedging is enabled and the request is idempotent.
+ * A negative \ref hedgeDelay waits for the observed 95th percentile of the
+ * time to first byte of the host, and does not hedge until enough responses
+ * of the host were seen.
+ */
+void Request::startHedgeTimer()
+{
+    if (!mHedging || mHedging->delay == 0 || !mQhr
+        || (mMethod != Method::GET && mMethod != Method::HEAD)) {
+        return;
+    }
+
+    int delay = mHedging->delay;
+    if (delay < 0) {
+        delay = mQhr->hedgingPolicy().latencyPercentile(mUrl.host(), 0.95);
+        if (delay < 0) {
+            return;
+        }
+    }
+    mHedging->timer.start(delay, this);
+}
+
+/*!
+ * \brief Request::sendHedgeRequest() Sends a duplicate of this request if no
+ * response has arrived yet, the hedge budget allows it and its client profile,
+ * if any, has a free slot for it. The first of the two replies to receive a
+ * response is used and the other one is aborted.
+ */
+void Request::sendHedgeRequest()
+{
+    if (!mNReply || mHedging->reply || mState >= State::HeadersReceived) {
+        return;
+    }
+    if (mClient && !mClient->acquireHedge(this)) {
+        return;
+    }
+    if (!mQhr->hedgingPolicy().tryHedge()) {
+        if (mClient) {
+            mClient->releaseHedge(this);
+        }
+        return;
+    }
+
+    auto reply = transportManager()->sendCustomRequest(mNRequest, mMethodName);
+    mHedging->reply = reply;
+    trace("hedge", 'n', mUrl);
+
+    connect(reply, &QNetworkReply::metaDataChanged, this,
+        &Request::promoteHedgeReply);
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        if (reply->error() == QNetworkReply::NoError) {
+            promoteHedgeReply();
+        } else {
+            // The hedge failed without a response, keep waiting for the
+            // original reply
+            cancelHedge();
+        }
+    });
+}
+
+/*!
+ * \brief Request::promoteHedgeReply() Makes the hedge reply, which received a
+ * response first, the reply of this request. The original reply is aborted
+ * after being disconnected, so \ref onAborted is not called.
+ */
+void Request::promoteHedgeReply()
+{
+    if (!mHedging || !mHedging->reply) {
+        return;
+    }
+
+    QNetworkReply* loser = mNReply;
+    loser->disconnect(this);
+    loser->abort();
+    loser->deleteLater();
+
+    mNReply = mHedging->reply;
+    mHedging->reply = nullptr;
+    if (mClient) {
+        mClient->releaseHedge(this);
+    }
+    mNReply->disconnect(this);
+    setupReplyConnections();
+    trace("hedgeWon");
+
+    if (mNReply->isFinished()) {
+        onReplyFinished();
+    } else if (mNReply->bytesAvailable() > 0) {
+        onReplyReadReady();
+    }
+}
+
+/*!
+ * \brief Request::cancelHedge() Stops waiting to hedge this request and aborts
+ * the hedge reply, if any.
+ */
+void Request::cancelHedge()
+{
+    if (!mHedging) {
+        return;
+    }
+
+    mHedging->timer.stop();
+    if (auto reply = mHedging->reply) {
+        mHedging->reply = nullptr;
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+        if (mClient) {
+            mClient->releaseHedge(this);
+        }
+    }
+}
+
+void Request::timerEvent(QTimerEvent* event)
+{
+    if (mHedging && event->timerId() == mHedging->timer.timerId()) {
+        mHedging->timer.stop();
+        sendHedgeRequest();
+        return;
+    }
+    if (mTransfer && event->timerId() == mTransfer->timer.timerId()) {
+        sampleTransfer();
+        return;
+    }
+    if (mPoll && event->timerId() == mPoll->timer.timerId()) {
+        mPoll->timer.stop();
+        sendPoll();
+        return;
+    }
+    QObject::timerEvent(event);
+}
+
+/*!
+ * \brief Request::trace() Records an event of this request into the active
+ * \ref Tracer, if tracing is enabled.
+ * \param name
+ * \param phase
+ */
+void Request::trace(const char* name, char phase) const
+{
+    if (auto tracer = Tracer::active()) {
+        tracer->record(name, phase, mTraceId, Tracer::now());
+    }
+}
+
+void Request::trace(const char* name, char phase, const QUrl& url) const
+{
+    if (auto tracer = Tracer::active()) {
+        tracer->record(name, phase, mTraceId, Tracer::now(), 0,
+            mMethodName + ' ' + url.toEncoded());
+    }
+}
+
+void Request::trace(const char* name, char phase, const QString& detail) const
+{
+    if (auto tracer = Tracer::active()) {
+        tracer->record(
+            name, phase, mTraceId, Tracer::now(), 0, detail.toUtf8());
+    }
+}
+
+/*!
+ * \brief Request::isRedirectAllowed() Checks whether the redirect to \a url
+ * should be followed according to the redirect policy of this request. With
+ * \a UserVerifiedRedirectPolicy the \ref onRedirected callback decides by
+ * returning true.
+ * \param url
+ * \return
+ */
+bool Request::isRedirectAllowed(const QUrl& url)
+{
+    switch (mRedirectPolicy) {
+    case QNetworkRequest::ManualRedirectPolicy:
+        return false;
+    case QNetworkRequest::NoLessSafeRedirectPolicy:
+        return !(mUrl.scheme() == "https" && url.scheme() == "http");
+    case QNetworkRequest::SameOriginRedirectPolicy:
+        return mUrl.scheme() == url.scheme() && mUrl.host() == url.host()
+            && mUrl.port() == url.port();
+    case QNetworkRequest::UserVerifiedRedirectPolicy:
+        return callCallback("onredirected", onRedirected(), { url.toString() })
+            .toBool();
+    default:
+        return true;
+    }
 }
 
-void Request::callCallback(QJSValue cb, const QJSValueList& args)
+QJSValue Request::callCallback(
+    const char* name, QJSValue cb, const QJSValueList& args)
 {
     if (cb.isCallable()) {
+        const qint64 start = Tracer::active() ? Tracer::now() : 0;
+
         QJSValue result = cb.call(args);
 
+        // Read again, the callback may have restarted tracing and freed the
+        // tracer active before the call
+        auto tracer = Tracer::active();
+        if (tracer && start != 0) {
+            tracer->record(name, 'X', mTraceId, start, Tracer::now() - start);
+        }
+
         if (result.isError()) {
             qDebug("%s:%s: %s",
                 qPrintable(result.property("fileName").toString()),
                 qPrintable(result.property("lineNumber").toString()),
                 qPrintable(result.toString().toStdString().c_str()));
         }
+        return result;
     }
+    return QJSValue();
 }
 
 void Request::onReplyReadReady()
 {
-    mResponse.status
+    trace("readyRead");
+
+    const int status
         = mNReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-    mResponse.statusText
-        = mNReply->attribute(QNetworkRequest::HttpReasonPhraseAttribute)
-              .toString();
+    if (!mPoll || !mPoll->responded) {
+        // A poll keeps the last response until its own is known to differ
+        mResponse.status = status;
+        mResponse.setStatusText(
+            mNReply->attribute(QNetworkRequest::HttpReasonPhraseAttribute)
+                .toString());
+    }
 
     if (mState < State::HeadersReceived) {
         mState = State::HeadersReceived;
+        trace("HeadersReceived");
+        if (mHedging && mHedging->sent.isValid()) {
+            mHedging->wait = mHedging->sent.elapsed();
+            if (mQhr && mHedging->delay != 0) {
+                mQhr->hedgingPolicy().recordLatency(
+                    mUrl.host(), int(mHedging->wait));
+            }
+        }
         // Call onreadystatuchange callback
-        callCallback(mReadyStateCb);
+        if (!mPoll || !mPoll->responded) {
+            callCallback("onreadystatechange", mReadyStateCb);
+        }
+    }
+
+    if (status < 300) {
+        if (mIntegrity && mIntegrity->pending && !startIntegrityCheck()) {
+            return;
+        }
+        if (!mPartParser && onPart().isCallable()) {
+            startPartParser();
+        }
+        if (hasBodyStreams() || mPartParser) {
+            feedBodyStreams(mNReply->readAll());
+        }
     }
 }
 
@@ -475,11 +2310,15 @@ void Request::onReplyReadReady()
  */
 void Request::onReplyFinished()
 {
+    cancelHedge();
+    stopTransferMonitor();
+    stopTimeouts(false);
+
     QVariant redirect
         = mNReply->attribute(QNetworkRequest::RedirectionTargetAttribute);
     if (redirect.isValid()) {
         QUrl url = mNReply->url().resolved(redirect.toUrl());
-        if (!url.isLocalFile()) {
+        if (!url.isLocalFile() && isRedirectAllowed(url)) {
             // See http://www.ietf.org/rfc/rfc2616.txt, section 10.3.4 "303 See
             // Other": Result of 303 redirection should be a new "GET" request.
             const QVariant code = mNReply->attribute(
@@ -490,39 +2329,169 @@ void Request::onReplyFinished()
                 mMethod = Method::GET;
             }
             mNReply->disconnect();
+            mNReply->deleteLater();
+            mNReply = nullptr;
 
             mUrl = url;
+            trace("redirect", 'n', mUrl);
 
-            send(mBody);
+            sendRequest();
             return;
         }
     }
 
+    recordCircuitOutcome();
+
+    // A body parsed or hashed while received finishes asynchronously
+    if (mNReply->error() != QNetworkReply::NoError
+        || mNReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt()
+            >= 300) {
+        stopItemParser();
+        stopIntegrityCheck();
+        mPartParser.reset();
+    } else if (mIntegrity && mIntegrity->pending && !startIntegrityCheck()) {
+        return;
+    }
+
+    const bool streamed = hasBodyStreams();
+    QByteArray body;
+    if (streamed) {
+        feedBodyStreams(mNReply->readAll());
+        if (auto parser = mItemParser) {
+            QMetaObject::invokeMethod(parser, [parser]() { parser->finish(); });
+        }
+        if (auto hasher = mIntegrity ? mIntegrity->hasher : nullptr) {
+            QMetaObject::invokeMethod(hasher, [hasher]() { hasher->finish(); });
+            body = mIntegrity->body;
+            mIntegrity->body.clear();
+        }
+    } else if (mPartParser) {
+        feedBodyStreams(mNReply->readAll());
+    } else {
+        body = mNReply->readAll();
+    }
+
+    if (mPoll && !isPollChanged(body, streamed || mPartParser)) {
+        // The response is left as it is and the state goes back to Done
+        // without reporting it
+        mNReply->deleteLater();
+        mNReply = nullptr;
+        stopTimeouts(true);
+        mState = State::Done;
+        trace("unchanged");
+        trace("request", 'e');
+        if (mClient) {
+            mClient->release(this);
+        }
+        schedulePoll(false);
+        return;
+    }
+
     // Store mNReply results inside mReponse and delete mNReply
+    mResponse.setBody(body, mNReply->rawHeader("Content-Type"));
+    mResponse.setResponseUrl(mNReply->url());
+    mResponse.setHeaders(mNReply->rawHeaderPairs());
     if (mNReply->error() == QNetworkReply::NoError) {
-        mResponse.response = QVariantMap();
-        mResponse.responseText = mNReply->readAll();
-        mResponse.responseUrl = mNReply->url();
-        mResponse.responseType = mNReply->rawHeader("Content-Type");
-    } else {
-        mResponse.response = QVariantMap();
-        mResponse.responseText = mNReply->readAll();
-        mResponse.responseUrl = mNReply->url();
+        mResponse.setResponseType(mNReply->rawHeader("Content-Type"));
     }
 
     mResponse.status
         = mNReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-    mResponse.statusText
-        = mNReply->attribute(QNetworkRequest::HttpReasonPhraseAttribute)
-              .toString();
+    mResponse.setStatusText(
+        mNReply->attribute(QNetworkRequest::HttpReasonPhraseAttribute)
+            .toString());
+
+    recordExchange();
 
     mNReply->deleteLater();
     mNReply = nullptr;
 
+    if (mPartParser) {
+        const bool complete = mPartParser->isComplete();
+        mPartParser.reset();
+        if (!complete) {
+            stopItemParser();
+            stopIntegrityCheck();
+            failFast(Error::StreamParseError,
+                "Multipart response ended before its closing boundary");
+            return;
+        }
+    }
+
+    if (!streamed) {
+        finish();
+    }
+}
+
+/*!
+ * \brief Request::recordExchange() Adds this request and its response to the
+ * recording of \ref QmlHttpRequest, if any. Only bodies kept in memory are
+ * recorded, file and device bodies are not read again. A response handed to
+ * \a onitem or \a onpart is not kept either, its exchange is skipped rather
+ * than replayed with an empty body.
+ */
+void Request::recordExchange()
+{
+    auto recorder = mQhr ? mQhr->recorder() : nullptr;
+    if (!recorder || mItemParser || mPartParser) {
+        return;
+    }
+
+    // Not timed when the recording started after this request was sent
+    const bool timed = mHedging && mHedging->sent.isValid();
+    const qint64 elapsed = timed ? mHedging->sent.elapsed() : 0;
+
+    Recorder::Entry entry;
+    entry.startedDateTime
+        = QDateTime::currentDateTimeUtc().addMSecs(-elapsed);
+    entry.method = mMethodName;
+    entry.url = mUrl;
+    const auto headerNames = mNRequest.rawHeaderList();
+    for (const auto& name : headerNames) {
+        entry.requestHeaders.append({ name, mNRequest.rawHeader(name) });
+    }
+    if (!mBodyDevice
+        && !(mBody.userType() == QMetaType::QUrl
+            && mBody.toUrl().isLocalFile())) {
+        entry.requestBody = bodyBytes(mBody);
+    }
+    entry.status = mResponse.status;
+    entry.statusText = mResponse.statusText();
+    entry.responseHeaders = mNReply->rawHeaderPairs();
+    entry.responseBody = mResponse.body();
+    entry.wait = timed ? mHedging->wait : 0;
+    entry.receive = timed ? qMax(qint64(0), elapsed - mHedging->wait) : 0;
+
+    recorder->record(entry);
+}
+
+/*!
+ * \brief Request::finish() Moves this request to \a Done state and calls the
+ * ready state callback. An auto released request is deleted afterwards.
+ */
+void Request::finish()
+{
+    stopTimeouts(true);
     mState = State::Done;
+    trace("Done");
+    trace("request", 'e');
+
+    if (mClient) {
+        mClient->release(this);
+    }
 
     // Call ready state callback
-    callCallback(mReadyStateCb);
+    callCallback("onreadystatechange", mReadyStateCb);
+    emit finished();
+
+    if (mPoll) {
+        mPoll->responded = true;
+        schedulePoll(mResponse.status >= 200 && mResponse.status < 300);
+        return;
+    }
+    if (mAutoRelease) {
+        deleteLater();
+    }
 }
 
 /*!
@@ -532,27 +2501,53 @@ void Request::onReplyFinished()
  */
 void Request::onReplyErrorOccured(int error)
 {
+    cancelHedge();
+
+    trace("error", 'n', mNReply->errorString());
+
+    if (mTimeouts && mTimeouts->expired) {
+        // Aborted by this request when one of its timeouts expired
+        reportTimeout();
+        return;
+    }
+
+    if (mTransfer && mTransfer->stalled) {
+        // Aborted by this request because the transfer is too slow
+        if (onTimeout().isCallable()) {
+            callCallback("ontimeout", onTimeout(), { QString("lowSpeed") });
+        } else if (onError().isCallable()) {
+            callCallback("onerror", onError(),
+                {
+                    QNetworkReply::TimeoutError,
+                    QString("Transfer rate below %1 bytes/s for %2 ms")
+                        .arg(mTransfer->lowSpeedLimit)
+                        .arg(mTransfer->lowSpeedTime),
+                });
+        }
+        return;
+    }
+
     if (mNReply->error() == QNetworkReply::TimeoutError) {
         // If time out is reached only call timeout callback
-        if (mTimeoutCb.isCallable()) {
+        if (onTimeout().isCallable()) {
             // Call timeout callback
-            callCallback(mTimeoutCb);
+            callCallback("ontimeout", onTimeout(), { QString("transfer") });
             return;
         }
     }
 
     if (mNReply->error() == QNetworkReply::OperationCanceledError) {
         // If operation was aborted
-        if (mAbortedCb.isCallable()) {
+        if (onAborted().isCallable()) {
             // Call aborted callback
-            callCallback(mAbortedCb);
+            callCallback("onaborted", onAborted());
             return;
         }
     }
 
-    if (mErrorCb.isCallable()) {
+    if (onError().isCallable()) {
         // Call error callback
-        callCallback(mErrorCb, {
+        callCallback("onerror", onError(), {
             mNReply->error(),
             mNReply->errorString(),
         });
@@ -566,7 +2561,7 @@ void Request::onReplyErrorOccured(int error)
  */
 void Request::onReplyRedirected(const QUrl& url)
 {
-    callCallback(mRedirectedCb,
+    callCallback("onredirected", onRedirected(),
         {
             url.toString(),
         });
@@ -579,7 +2574,11 @@ void Request::onReplyRedirected(const QUrl& url)
  */
 void Request::onReplyDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
 {
-    callCallback(mDownloadProgressCb,
+    if (mTransfer) {
+        mTransfer->bytesReceived = bytesReceived;
+    }
+
+    callCallback("ondownloadprogress", onDownloadProgress(),
         {
             double(bytesReceived),
             double(bytesTotal),
@@ -593,7 +2592,14 @@ void Request::onReplyDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
  */
 void Request::onReplyUploadProgress(qint64 bytesSent, qint64 bytesTotal)
 {
-    callCallback(mUploadProgressCb,
+    if (bytesSent > 0) {
+        onReplyConnected();
+    }
+    if (mTransfer) {
+        mTransfer->bytesSent = bytesSent;
+    }
+
+    callCallback("onuploadprogress", onUploadProgress(),
         {
             double(bytesSent),
             double(bytesTotal),
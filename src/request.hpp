@@ -23,12 +23,19 @@
 #ifndef REQUEST_HPP
 #define REQUEST_HPP
 
+#include <QBasicTimer>
+#include <QElapsedTimer>
+#include <QIODevice>
 #include <QJSValue>
 #include <QNetworkRequest>
 #include <QObject>
+#include <QPointer>
 #include <QQmlEngine>
 #include <QSharedPointer>
 
+#include <array>
+#include <memory>
+
 #include "qmlhttprequest_global.hpp"
 #include "response.hpp"
 
@@ -38,6 +45,14 @@ class QHttpMultiPart;
 
 namespace qhr {
 
+class AsyncBodyEncoder;
+class CircuitBreaker;
+class Client;
+class JsonStreamParser;
+class MultipartParser;
+class QmlHttpRequest;
+class StreamHasher;
+
 class QHR_EXPORT Request : public QObject
 {
     Q_OBJECT
@@ -54,13 +69,37 @@ class QHR_EXPORT Request : public QObject
     Q_PROPERTY(int      timeout     READ    timeout WRITE setTimeout)
     Q_PROPERTY(State    readyState  READ    readyState() CONSTANT)
 
-    Q_PROPERTY(QJSValue ondownloadprogress  MEMBER  mDownloadProgressCb)
-    Q_PROPERTY(QJSValue onuploadprogress    MEMBER  mUploadProgressCb)
+    Q_PROPERTY(bool     autoRelease READ    autoRelease WRITE setAutoRelease)
+    Q_PROPERTY(int      hedgeDelay  READ    hedgeDelay  WRITE setHedgeDelay)
+    Q_PROPERTY(QString  integrity   READ    integrity   WRITE setIntegrity)
+    Q_PROPERTY(QString  uploadChecksum  READ uploadChecksum
+            WRITE setUploadChecksum)
+    Q_PROPERTY(QString  group       READ    group       WRITE setGroup)
+    Q_PROPERTY(int      lowSpeedLimit   READ lowSpeedLimit
+            WRITE setLowSpeedLimit)
+    Q_PROPERTY(int      lowSpeedTime    READ lowSpeedTime
+            WRITE setLowSpeedTime)
+    Q_PROPERTY(double   transferRate    READ transferRate
+            NOTIFY transferRateChanged)
+    Q_PROPERTY(int      connectTimeout  READ connectTimeout
+            WRITE setConnectTimeout)
+    Q_PROPERTY(int      firstByteTimeout    READ firstByteTimeout
+            WRITE setFirstByteTimeout)
+    Q_PROPERTY(int      deadline        READ deadline   WRITE setDeadline)
+    Q_PROPERTY(bool     polling     READ    isPolling   NOTIFY pollingChanged)
+
+    Q_PROPERTY(QJSValue ondownloadprogress  READ onDownloadProgress
+            WRITE setOnDownloadProgress)
+    Q_PROPERTY(QJSValue onuploadprogress    READ onUploadProgress
+            WRITE setOnUploadProgress)
     Q_PROPERTY(QJSValue onreadystatechange  MEMBER  mReadyStateCb)
-    Q_PROPERTY(QJSValue onredirected        MEMBER  mRedirectedCb)
-    Q_PROPERTY(QJSValue onaborted           MEMBER  mAbortedCb)
-    Q_PROPERTY(QJSValue ontimeout           MEMBER  mTimeoutCb)
-    Q_PROPERTY(QJSValue onerror             MEMBER  mErrorCb)
+    Q_PROPERTY(QJSValue onredirected        READ onRedirected
+            WRITE setOnRedirected)
+    Q_PROPERTY(QJSValue onaborted           READ onAborted  WRITE setOnAborted)
+    Q_PROPERTY(QJSValue ontimeout           READ onTimeout  WRITE setOnTimeout)
+    Q_PROPERTY(QJSValue onerror             READ onError    WRITE setOnError)
+    Q_PROPERTY(QJSValue onitem              READ onItem     WRITE setOnItem)
+    Q_PROPERTY(QJSValue onpart              READ onPart     WRITE setOnPart)
 
 public:
     enum class Method : char
@@ -85,6 +124,19 @@ public:
     };
     Q_ENUM(State);
 
+    /*!
+     * \brief Errors reported to \a onerror callback by this library itself,
+     * numbered after \a\b QNetworkReply::NetworkError values
+     */
+    enum class Error : int
+    {
+        CircuitOpenError = 1000,
+        StreamParseError,
+        IntegrityError,
+        BodyReadError,
+    };
+    Q_ENUM(Error);
+
     Request(QNetworkAccessManager* nam, int timeout = 0);
     virtual ~Request();
 
@@ -92,34 +144,114 @@ public:
     Q_INVOKABLE void setRequestHeader(
         const QString& header, const QString& value);
     Q_INVOKABLE void send(const QVariant& body = QVariant());
+    void send(QIODevice* device);
     Q_INVOKABLE void abort();
+    Q_INVOKABLE void poll(int interval, int maxInterval = 0);
+    Q_INVOKABLE void stopPolling();
 
     bool isOpen() const;
+    bool isPending() const;
+    QUrl url() const { return mUrl; }
 
     QByteArray requestHeader(const QByteArray& header) const;
 
     void setNetworkAccessManager(QNetworkAccessManager* nam);
     auto networkAccessManager() const { return mNam; }
 
+    void setClient(Client* client);
+    Client* client() const;
+
+    void setQmlHttpRequest(QmlHttpRequest* qhr);
+    QmlHttpRequest* qmlHttpRequest() const;
+
     void setTimeout(int timeout);
     int timeout() const { return mNRequest.transferTimeout(); }
 
     State readyState() const { return mState; }
 
+    void setAutoRelease(bool autoRelease) { mAutoRelease = autoRelease; }
+    bool autoRelease() const { return mAutoRelease; }
+
+    static int liveCount();
+    static bool binaryBody(const QVariant& body, QByteArray& bytes);
+
+    void setHedgeDelay(int delay);
+    int hedgeDelay() const;
+
+    void setIntegrity(const QString& integrity);
+    QString integrity() const;
+
+    void setUploadChecksum(const QString& algorithm);
+    QString uploadChecksum() const;
+
+    void setGroup(const QString& group);
+    QString group() const { return mGroup; }
+
+    void setLowSpeedLimit(int bytesPerSecond);
+    int lowSpeedLimit() const;
+    void setLowSpeedTime(int time);
+    int lowSpeedTime() const;
+    double transferRate() const;
+
+    void setConnectTimeout(int timeout);
+    int connectTimeout() const;
+    void setFirstByteTimeout(int timeout);
+    int firstByteTimeout() const;
+    void setDeadline(int deadline);
+    int deadline() const;
+
+    bool isPolling() const { return bool(mPoll); }
+    int pollInterval() const;
+
+    // Callbacks other than onreadystatechange are kept in side storage
+    QJSValue onDownloadProgress() const;
+    void setOnDownloadProgress(const QJSValue& cb);
+    QJSValue onUploadProgress() const;
+    void setOnUploadProgress(const QJSValue& cb);
+    QJSValue onRedirected() const;
+    void setOnRedirected(const QJSValue& cb);
+    QJSValue onAborted() const;
+    void setOnAborted(const QJSValue& cb);
+    QJSValue onTimeout() const;
+    void setOnTimeout(const QJSValue& cb);
+    QJSValue onError() const;
+    void setOnError(const QJSValue& cb);
+    QJSValue onItem() const;
+    void setOnItem(const QJSValue& cb);
+    QJSValue onPart() const;
+    void setOnPart(const QJSValue& cb);
+
     // Response's values methods
     QVariant response() const;
     QString responseText() const;
-    auto responseType() const { return mResponse.responseType; };
-    auto responseUrl() const { return mResponse.responseUrl; };
-    auto statusText() const { return mResponse.statusText; };
+    auto responseType() const { return mResponse.responseType(); };
+    auto responseUrl() const { return mResponse.responseUrl(); };
+    auto statusText() const { return mResponse.statusText(); };
     auto status() const { return mResponse.status; };
+    auto responseBody() const { return mResponse.body(); };
+    auto responseHeader(const QByteArray& header) const
+    {
+        return mResponse.header(header);
+    };
+
+signals:
+    void finished();
+    void transferRateChanged();
+    void pollingChanged();
+
+protected:
+    void timerEvent(QTimerEvent* event) override;
 
 private:
+    void sendRequest();
     void sendNoBodyRequest();
     void sendBodyRequest(const QVariant& body);
 
     void sendBodyRequestText(const QVariant& body);
+    void sendBodyRequestBinary(const QByteArray& body);
     void sendBodyRequestMultipart(const QVariant& body);
+    void sendBodyRequestFile(const QUrl& url);
+    void sendBodyRequestDevice(QIODevice* device);
 
     void multipartAddObject(
         QHttpMultiPart* mpBody, QString prefix, const QJsonObject& object);
@@ -128,9 +260,71 @@ private:
     void multipartAddValue(
         QHttpMultiPart* mpBody, QString prefix, const QJsonValue& value);
 
+    QByteArray bodyBytes(const QVariant& body) const;
+
+    QNetworkAccessManager* transportManager() const;
+
+    bool startBodyEncoding();
+    void stopBodyEncoding();
+    void onBodyEncoded(const QByteArray& bytes);
+
+    bool isRedirectAllowed(const QUrl& url);
+    bool isWaiting() const;
+    void cancel();
+    void finish();
+    void failFast(Error error, const QString& errorString);
+    void recordCircuitOutcome();
+    void recordExchange();
+
+    void startHedgeTimer();
+    void sendHedgeRequest();
+    void promoteHedgeReply();
+    void cancelHedge();
+
+    void startItemParser();
+    void stopItemParser();
+    void onItemsParsed(const QVariantList& items);
+    void onItemParserFinished(const QString& error);
+
+    void startPartParser();
+    void feedParts(const QByteArray& chunk);
+
+    bool startUploadChecksum();
+    void onUploadChecksumReady(const QByteArray& digest);
+    bool startIntegrityCheck();
+    void stopIntegrityCheck();
+    void failIntegrityCheck(const QString& errorString);
+    void onIntegrityChecked(const QByteArray& digest);
+
+    void startTransferMonitor();
+    void stopTransferMonitor();
+    void sampleTransfer();
+
+    void startDeadline();
+    void startTimeouts();
+    void stopTimeouts(bool deadline);
+    void onReplyConnected();
+    void onReplyResponseStarted();
+    void onTimeoutExpired(const char* reason);
+    void reportTimeout();
+
+    void sendPoll();
+    void schedulePoll(bool changed);
+    bool isPollChanged(const QByteArray& body, bool streamed);
+    void resumePoll();
+
+    void feedBodyStreams(const QByteArray& chunk);
+    bool hasBodyStreams() const;
+    void finishIfDrained();
+
     void setupReplyConnections();
 
-    void callCallback(QJSValue cb, const QJSValueList &args = QJSValueList());
+    QJSValue callCallback(const char* name, QJSValue cb,
+        const QJSValueList& args = QJSValueList());
+
+    void trace(const char* name, char phase = 'n') const;
+    void trace(const char* name, char phase, const QUrl& url) const;
+    void trace(const char* name, char phase, const QString& detail) const;
 
 private:
     void onReplyReadReady();
@@ -141,24 +335,130 @@ private:
     void onReplyUploadProgress(qint64 bytesSent, qint64 bytesTotal);
 
 private:
+    struct Callbacks
+    {
+        QJSValue downloadProgress;
+        QJSValue uploadProgress;
+        QJSValue redirected;
+        QJSValue aborted;
+        QJSValue timeout;
+        QJSValue error;
+        QJSValue item;
+        QJSValue part;
+    };
+
+    Callbacks& callbacks();
+
+    struct IntegrityCheck
+    {
+        QString expected;
+        QString uploadChecksum;
+        bool pending = false;
+        QList<QByteArray> digests;
+        StreamHasher* hasher = nullptr;
+        StreamHasher* uploadHasher = nullptr;
+        QByteArray body;
+    };
+
+    IntegrityCheck& integrityCheck();
+
+    struct TransferMonitor
+    {
+        static constexpr int Interval = 1000;
+        static constexpr int DefaultLowSpeedTime = 30000;
+
+        int lowSpeedLimit = 0;
+        int lowSpeedTime = DefaultLowSpeedTime;
+        QBasicTimer timer;
+        qint64 bytesReceived = 0;
+        qint64 bytesSent = 0;
+        // Bytes transferred at each of the last ticks, the sliding window
+        std::array<qint64, 6> samples {};
+        int sampleCount = 0;
+        int slowTime = 0;
+        double rate = 0;
+        bool stalled = false;
+    };
+
+    TransferMonitor& transferMonitor();
+
+    struct Timeouts
+    {
+        int connect = 0;
+        int firstByte = 0;
+        int deadline = 0;
+        quint64 connectTimer = 0;
+        quint64 firstByteTimer = 0;
+        quint64 deadlineTimer = 0;
+        const char* expired = nullptr;
+    };
+
+    Timeouts& timeouts();
+
+    struct Hedging
+    {
+        int delay = 0;
+        QBasicTimer timer;
+        QNetworkReply* reply = nullptr;
+        // From sending to the end of the response, also used by recordings
+        QElapsedTimer sent;
+        qint64 wait = 0;
+    };
+
+    Hedging& hedging();
+
+    struct Polling
+    {
+        // Default max interval, as a multiple of the interval
+        static constexpr int MaxBackoff = 8;
+
+        int interval = 0;
+        int maxInterval = 0;
+        int current = 0;
+        QBasicTimer timer;
+        QByteArray etag;
+        QByteArray lastModified;
+        QByteArray bodyHash;
+        // If-None-Match or If-Modified-Since set by the caller, kept as is
+        bool callerValidators = false;
+        // A response was reported, kept while the next polls are in flight
+        bool responded = false;
+        bool due = false;
+        QMetaObject::Connection appState;
+    };
+
     QNetworkAccessManager* mNam;
+    QPointer<QmlHttpRequest> mQhr;
+    QPointer<Client> mClient;
+    QPointer<CircuitBreaker> mCircuitBreaker;
     QNetworkRequest mNRequest;
     QNetworkReply* mNReply;
     QByteArray mMethodName;
     QVariant mBody;
+    QPointer<QIODevice> mBodyDevice;
+    AsyncBodyEncoder* mBodyEncoder;
     QUrl mUrl;
+    QString mGroup;
 
     State mState;
     Method mMethod;
     Response mResponse;
+    int mRedirectPolicy;
+    quint64 mTraceId;
+    bool mAutoRelease;
+
+    JsonStreamParser* mItemParser;
 
-    QJSValue mDownloadProgressCb;
-    QJSValue mUploadProgressCb;
     QJSValue mReadyStateCb;
-    QJSValue mRedirectedCb;
-    QJSValue mAbortedCb;
-    QJSValue mTimeoutCb;
-    QJSValue mErrorCb;
+    std::unique_ptr<Callbacks> mCallbacks;
+    std::unique_ptr<IntegrityCheck> mIntegrity;
+    std::unique_ptr<TransferMonitor> mTransfer;
+    std::unique_ptr<Timeouts> mTimeouts;
+    std::unique_ptr<Hedging> mHedging;
+    std::unique_ptr<Polling> mPoll;
+    std::unique_ptr<MultipartParser> mPartParser;
+
+    friend class Client;
 };
 
 }
@@ -1,23 +1,198 @@
 #include "response.hpp"
 
+#if QT_VERSION_MAJOR == 6
+#include <QStringDecoder>
+#else
+#include <QTextCodec>
+#endif
+
+#include <cstring>
+
 namespace qhr {
 
 /*!
  * \class Response
  * \brief Response class which holds the information of a network request, like
  * status code, status text, response text, etc
+ *
+ * The status, status text, url, headers and body, set for every completed
+ * request, are stored inline, the headers sharing the list of the reply. The
+ * response type and a charset other than UTF-8, both rarely set, live in side
+ * storage allocated the first time one of them is set to a non empty value.
+ *
+ * The body is kept as received and decoded to text only when \ref text() is
+ * first called, the decoded text is cached.
  */
 
-Response::Response() : status(0) { }
+Response::Response() : status(0), mTextDecoded(true) { }
 
 void Response::clear()
 {
-    response = QVariant();
-    responseText = QString();
-    responseType = QString();
-    responseUrl = QUrl();
-    statusText = QString();
+    mBody = QByteArray();
+    mText = QString();
+    mTextDecoded = true;
     status = 0;
+    mResponseUrl = QUrl();
+    mStatusText = QString();
+    mHeaders.clear();
+    mDetails.reset();
+}
+
+/*!
+ * \brief Response::header() Returns the value of the response header \a
+ * name, compared case insensitively.
+ * \param name
+ * \return The value, or an empty array if it was not received
+ */
+QByteArray Response::header(const QByteArray& name) const
+{
+    for (const auto& header : mHeaders) {
+        if (header.first.compare(name, Qt::CaseInsensitive) == 0) {
+            return header.second;
+        }
+    }
+    return QByteArray();
+}
+
+/*!
+ * \brief Response::setBody() Stores the raw \a body, to be decoded by \ref
+ * text() with the charset of \a contentType.
+ * \param body
+ * \param contentType Value of the \a Content-Type header
+ */
+void Response::setBody(const QByteArray& body, const QByteArray& contentType)
+{
+    mBody = body;
+    mText = QString();
+    mTextDecoded = false;
+
+    auto bodyCharset = charset(contentType);
+    if (bodyCharset == "utf-8" || bodyCharset == "utf8") {
+        bodyCharset.clear();
+    }
+    if (mDetails || !bodyCharset.isEmpty()) {
+        details().charset = bodyCharset;
+    }
+}
+
+/*!
+ * \brief Response::text() Returns the body decoded as text, decoding it on
+ * the first call only.
+ * \return
+ */
+QString Response::text() const
+{
+    if (!mTextDecoded) {
+        mText = decode(mBody, mDetails ? mDetails->charset : QByteArray());
+        mTextDecoded = true;
+    }
+    return mText;
+}
+
+/*!
+ * \brief Response::setText() Replaces the body with \a text, used for the
+ * messages of requests that failed without a response.
+ * \param text
+ */
+void Response::setText(const QString& text)
+{
+    mBody = QByteArray();
+    mText = text;
+    mTextDecoded = true;
+}
+
+QString Response::responseType() const
+{
+    return mDetails ? mDetails->responseType : QString();
+}
+
+void Response::setResponseType(const QString& type)
+{
+    if (mDetails || !type.isEmpty()) {
+        details().responseType = type;
+    }
+}
+
+/*!
+ * \brief Response::charset() Returns the lower case \a charset parameter of
+ * \a contentType, or an empty array if there is none.
+ * \param contentType
+ * \return
+ */
+QByteArray Response::charset(const QByteArray& contentType)
+{
+    const auto params = contentType.split(';');
+    for (int i = 1; i < params.size(); ++i) {
+        const auto param = params[i].trimmed();
+        if (param.size() > 8 && param.left(8).toLower() == "charset=") {
+            auto value = param.mid(8).trimmed();
+            if (value.size() >= 2 && value.startsWith('"')
+                && value.endsWith('"')) {
+                value = value.mid(1, value.size() - 2);
+            }
+            return value.toLower();
+        }
+    }
+    return QByteArray();
+}
+
+/*!
+ * \brief Response::decode() Decodes \a bytes encoded with \a charset, UTF-8
+ * if empty. Pure ASCII is decoded as Latin-1, which is faster. An unknown
+ * charset falls back to UTF-8.
+ * \param bytes
+ * \param charset
+ * \return
+ */
+QString Response::decode(const QByteArray& bytes, const QByteArray& charset)
+{
+    if (charset.isEmpty() || charset == "us-ascii" || charset == "utf-8"
+        || charset == "utf8") {
+        const char* data = bytes.constData();
+        qsizetype size = bytes.size();
+        if (size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0) {
+            // UTF-8 byte order mark
+            data += 3;
+            size -= 3;
+        }
+
+        qsizetype i = 0;
+        for (; i + 8 <= size; i += 8) {
+            quint64 word;
+            std::memcpy(&word, data + i, sizeof(word));
+            if (word & Q_UINT64_C(0x8080808080808080)) {
+                return QString::fromUtf8(data, size);
+            }
+        }
+        for (; i < size; ++i) {
+            if (uchar(data[i]) & 0x80) {
+                return QString::fromUtf8(data, size);
+            }
+        }
+        return QString::fromLatin1(data, size);
+    }
+
+#if QT_VERSION_MAJOR == 6
+    QStringDecoder decoder(charset.constData());
+    if (decoder.isValid()) {
+        return decoder.decode(bytes);
+    }
+#else
+    if (auto codec = QTextCodec::codecForName(charset)) {
+        return codec->toUnicode(bytes);
+    }
+#endif
+    qWarning() << "Unsupported response charset" << charset
+               << ", decoding as UTF-8";
+    return QString::fromUtf8(bytes);
+}
+
+Response::Details& Response::details()
+{
+    if (!mDetails) {
+        mDetails = std::make_unique<Details>();
+    }
+    return *mDetails;
 }
 
 }
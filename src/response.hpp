@@ -25,6 +25,8 @@
 
 #include <QtCore>
 
+#include <memory>
+
 namespace qhr {
 
 class Response
@@ -34,13 +36,50 @@ public:
 
     void clear();
 
+    QByteArray body() const { return mBody; }
+    void setBody(const QByteArray& body, const QByteArray& contentType);
+
+    QString text() const;
+    void setText(const QString& text);
+
+    QString responseType() const;
+    void setResponseType(const QString& type);
+
+    QUrl responseUrl() const { return mResponseUrl; }
+    void setResponseUrl(const QUrl& url) { mResponseUrl = url; }
+
+    QString statusText() const { return mStatusText; }
+    void setStatusText(const QString& text) { mStatusText = text; }
+
+    QByteArray header(const QByteArray& name) const;
+    void setHeaders(const QList<QPair<QByteArray, QByteArray>>& headers)
+    {
+        mHeaders = headers;
+    }
+
+    static QByteArray charset(const QByteArray& contentType);
+    static QString decode(const QByteArray& bytes, const QByteArray& charset);
+
 public:
-    QVariant    response;
-    QString     responseText;
-    QString     responseType;
-    QUrl        responseUrl;
-    QString     statusText;
     int         status;
+
+private:
+    struct Details
+    {
+        QString     responseType;
+        QByteArray  charset;
+    };
+
+    Details& details();
+
+    QByteArray      mBody;
+    QUrl            mResponseUrl;
+    QString         mStatusText;
+    QList<QPair<QByteArray, QByteArray>> mHeaders;
+    mutable QString mText;
+    mutable bool    mTextDecoded;
+
+    std::unique_ptr<Details> mDetails;
 };
 
 }
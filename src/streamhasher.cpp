@@ -0,0 +1,176 @@
+#include "streamhasher.hpp"
+
+#include <QFile>
+
+namespace qhr {
+
+/*!
+ * \class StreamHasher
+ * \brief StreamHasher class computing a digest of data given to it piece by
+ * piece, so a body is hashed while it is transferred instead of being read
+ * again afterwards. It is meant to live in \ref workerThread() and be fed
+ * through queued connections.
+ */
+
+StreamHasher::StreamHasher(Algorithm algorithm, QObject* parent)
+    : QObject { parent }, mAlgorithm(algorithm), mHash(algorithm),
+      mFailed(false)
+{
+}
+
+/*!
+ * \brief StreamHasher::parseIntegrity() Parses a subresource integrity value
+ * like \a "sha256-<base64>". When \a integrity holds several hashes the ones
+ * of the strongest algorithm are kept in \a digests, any of which is accepted.
+ * \param integrity
+ * \param algorithm
+ * \param digests
+ * \return False if \a integrity holds no supported hash
+ */
+bool StreamHasher::parseIntegrity(
+    const QString& integrity, Algorithm& algorithm, QList<QByteArray>& digests)
+{
+    static const QList<QPair<QString, Algorithm>> algorithms {
+        { "sha512-", QCryptographicHash::Sha512 },
+        { "sha384-", QCryptographicHash::Sha384 },
+        { "sha256-", QCryptographicHash::Sha256 },
+    };
+
+    const auto hashes = integrity.simplified().split(' ');
+    for (const auto& candidate : algorithms) {
+        digests.clear();
+        for (const auto& hash : hashes) {
+            if (hash.startsWith(candidate.first, Qt::CaseInsensitive)) {
+                // Options after '?' are reserved and ignored
+                const auto value = hash.mid(candidate.first.size())
+                                       .section('?', 0, 0);
+                digests.append(QByteArray::fromBase64(value.toLatin1()));
+            }
+        }
+        if (!digests.isEmpty()) {
+            algorithm = candidate.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * \brief StreamHasher::parseDigestHeaders() Parses the value of a \a Digest
+ * or \a Content-Digest response header, falling back to \a Content-MD5.
+ * \param digest Value of \a Digest or \a Content-Digest header
+ * \param contentMd5 Value of \a Content-MD5 header
+ * \param algorithm
+ * \param digests
+ * \return False if the headers hold no supported hash
+ */
+bool StreamHasher::parseDigestHeaders(const QByteArray& digest,
+    const QByteArray& contentMd5, Algorithm& algorithm,
+    QList<QByteArray>& digests)
+{
+    static const QList<QPair<QByteArray, Algorithm>> algorithms {
+        { "sha-512", QCryptographicHash::Sha512 },
+        { "sha-256", QCryptographicHash::Sha256 },
+        { "md5", QCryptographicHash::Md5 },
+    };
+
+    const auto entries = digest.split(',');
+    for (const auto& candidate : algorithms) {
+        digests.clear();
+        for (const auto& entry : entries) {
+            const int equal = entry.indexOf('=');
+            if (equal > 0
+                && entry.left(equal).trimmed().toLower() == candidate.first) {
+                auto value = entry.mid(equal + 1).trimmed();
+                // Content-Digest wraps values in colons
+                if (value.startsWith(':') && value.endsWith(':')) {
+                    value = value.mid(1, value.size() - 2);
+                }
+                digests.append(QByteArray::fromBase64(value));
+            }
+        }
+        if (!digests.isEmpty()) {
+            algorithm = candidate.second;
+            return true;
+        }
+    }
+
+    if (!contentMd5.isEmpty()) {
+        algorithm = QCryptographicHash::Md5;
+        digests = { QByteArray::fromBase64(contentMd5.trimmed()) };
+        return true;
+    }
+    return false;
+}
+
+/*!
+ * \brief StreamHasher::parseAlgorithm() Parses an upload checksum algorithm
+ * name, \a md5, \a sha256 or \a sha512.
+ * \param name
+ * \param algorithm
+ * \return False if \a name is not supported
+ */
+bool StreamHasher::parseAlgorithm(const QString& name, Algorithm& algorithm)
+{
+    const auto lower = name.toLower().remove('-');
+    if (lower == "md5") {
+        algorithm = QCryptographicHash::Md5;
+    } else if (lower == "sha256") {
+        algorithm = QCryptographicHash::Sha256;
+    } else if (lower == "sha512") {
+        algorithm = QCryptographicHash::Sha512;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief StreamHasher::checksumHeader() Returns the request header carrying \a
+ * digest, \a Content-MD5 for MD5 and \a Digest otherwise.
+ * \param algorithm
+ * \param digest
+ * \return Header name and value
+ */
+QPair<QByteArray, QByteArray> StreamHasher::checksumHeader(
+    Algorithm algorithm, const QByteArray& digest)
+{
+    switch (algorithm) {
+    case QCryptographicHash::Md5:
+        return { "Content-MD5", digest.toBase64() };
+    case QCryptographicHash::Sha512:
+        return { "Digest", "SHA-512=" + digest.toBase64() };
+    default:
+        return { "Digest", "SHA-256=" + digest.toBase64() };
+    }
+}
+
+void StreamHasher::addData(const QByteArray& data)
+{
+    mHash.addData(data);
+}
+
+/*!
+ * \brief StreamHasher::addFile() Reads the file named \a fileName once and
+ * adds its content.
+ * \param fileName
+ */
+void StreamHasher::addFile(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly) || !mHash.addData(&file)) {
+        qWarning() << "Cannot read file to hash: " << fileName;
+        mFailed = true;
+    }
+}
+
+/*!
+ * \brief StreamHasher::finish() Emits \ref finished() with the digest of the
+ * data added, or an empty digest if a file could not be read.
+ */
+void StreamHasher::finish()
+{
+    emit finished(mFailed ? QByteArray() : mHash.result());
+}
+
+}
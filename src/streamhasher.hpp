@@ -0,0 +1,70 @@
+/*!
+ * Copyright (c) 2023 Alireza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef STREAMHASHER_HPP
+#define STREAMHASHER_HPP
+
+#include <QCryptographicHash>
+#include <QObject>
+
+#include "qmlhttprequest_global.hpp"
+
+namespace qhr {
+
+class QHR_EXPORT StreamHasher : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Algorithm = QCryptographicHash::Algorithm;
+
+    StreamHasher(Algorithm algorithm, QObject* parent = nullptr);
+
+    Algorithm algorithm() const { return mAlgorithm; }
+
+    static bool parseIntegrity(const QString& integrity, Algorithm& algorithm,
+        QList<QByteArray>& digests);
+    static bool parseDigestHeaders(const QByteArray& digest,
+        const QByteArray& contentMd5, Algorithm& algorithm,
+        QList<QByteArray>& digests);
+    static bool parseAlgorithm(const QString& name, Algorithm& algorithm);
+    static QPair<QByteArray, QByteArray> checksumHeader(
+        Algorithm algorithm, const QByteArray& digest);
+
+public slots:
+    void addData(const QByteArray& data);
+    void addFile(const QString& fileName);
+    void finish();
+
+signals:
+    void finished(const QByteArray& digest);
+
+private:
+    Algorithm mAlgorithm;
+    QCryptographicHash mHash;
+    bool mFailed;
+};
+
+}
+
+#endif // STREAMHASHER_HPP
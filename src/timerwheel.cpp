@@ -0,0 +1,143 @@
+#include "timerwheel.hpp"
+
+#include <QCoreApplication>
+#include <QTimerEvent>
+
+namespace qhr {
+
+/*!
+ * \class TimerWheel
+ * \brief TimerWheel class running the timeouts of all requests off a single
+ * timer. Timeouts are hashed into \ref Slots slots of \ref resolution
+ * milliseconds by their expiry, and each tick only visits the slot it reaches,
+ * so starting and stopping a timeout is constant time however many requests
+ * are in flight. The timer only runs while timeouts are pending.
+ */
+
+/*!
+ * \brief Initialize a wheel whose slots cover \a resolution milliseconds.
+ * \param resolution
+ * \param parent
+ */
+TimerWheel::TimerWheel(int resolution, QObject* parent)
+    : QObject { parent }, mResolution(qMax(1, resolution)), mNextId(1),
+      mTick(0)
+{
+}
+
+/*!
+ * \brief TimerWheel::shared() Returns the wheel shared by all requests,
+ * created on first use.
+ * \return
+ */
+TimerWheel* TimerWheel::shared()
+{
+    static QPointer<TimerWheel> wheel;
+    if (!wheel) {
+        wheel = new TimerWheel(
+            DefaultResolution, QCoreApplication::instance());
+    }
+    return wheel;
+}
+
+/*!
+ * \brief TimerWheel::start() Calls \a callback once in \a msec milliseconds,
+ * at the first tick at or after that time, so never early and at most a \ref
+ * resolution late when the event loop is idle, unless \a context is destroyed or \ref stop()
+ * is called meanwhile.
+ * \param msec
+ * \param context
+ * \param callback
+ * \return Id of the timeout to pass to \ref stop()
+ */
+quint64 TimerWheel::start(
+    int msec, QObject* context, std::function<void()> callback)
+{
+    if (mEntries.isEmpty()) {
+        mClock.start();
+        mTick = 0;
+        mTimer.start(mResolution, this);
+    }
+
+    const auto id = mNextId++;
+    // From the current time rather than the last tick, which may be late when
+    // the event loop was busy, and rounded up to a tick. The time is rounded
+    // up as well since ticks compare truncated milliseconds
+    const qint64 now = (mClock.nsecsElapsed() + 999999) / 1000000;
+    const qint64 expiry = now + qMax(0, msec);
+    const auto tick
+        = qMax(mTick + 1, (expiry + mResolution - 1) / mResolution);
+    mEntries.insert(id, { tick, context, std::move(callback) });
+    mSlots[tick % Slots].append(id);
+    return id;
+}
+
+/*!
+ * \brief TimerWheel::stop() Cancels the timeout \a id. Its slot drops it the
+ * next time it is visited.
+ * \param id
+ */
+void TimerWheel::stop(quint64 id)
+{
+    if (!mEntries.remove(id) || !mEntries.isEmpty()) {
+        return;
+    }
+
+    mTimer.stop();
+    for (auto& slot : mSlots) {
+        slot.clear();
+    }
+}
+
+void TimerWheel::timerEvent(QTimerEvent* event)
+{
+    if (event->timerId() == mTimer.timerId()) {
+        advance();
+        return;
+    }
+    QObject::timerEvent(event);
+}
+
+/*!
+ * \brief TimerWheel::advance() Visits the slots of the ticks elapsed since the
+ * last call, each slot at most once when the event loop was blocked for more
+ * than a turn of the wheel, and calls the callbacks of expired timeouts.
+ */
+void TimerWheel::advance()
+{
+    const qint64 now = mClock.elapsed() / mResolution;
+    QList<quint64> expired;
+
+    for (qint64 tick = qMax(mTick + 1, now - Slots + 1); tick <= now; ++tick) {
+        auto& slot = mSlots[tick % Slots];
+        for (int i = 0; i < slot.size();) {
+            const auto it = mEntries.constFind(slot[i]);
+            if (it == mEntries.cend() || it->tick <= now) {
+                if (it != mEntries.cend()) {
+                    expired.append(slot[i]);
+                }
+                slot.removeAt(i);
+            } else {
+                ++i;
+            }
+        }
+    }
+    mTick = qMax(mTick, now);
+
+    // Callbacks may start or stop timeouts
+    for (const auto id : std::as_const(expired)) {
+        const auto entry = mEntries.take(id);
+        if (entry.context) {
+            entry.callback();
+        }
+    }
+
+    if (mEntries.isEmpty()) {
+        mTimer.stop();
+        for (auto& slot : mSlots) {
+            slot.clear();
+        }
+    }
+}
+
+}
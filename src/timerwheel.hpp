@@ -0,0 +1,84 @@
+/*!
+ * Copyright (c) 2023 Alireza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TIMERWHEEL_HPP
+#define TIMERWHEEL_HPP
+
+#include <QBasicTimer>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+
+#include <array>
+#include <functional>
+
+#include "qmlhttprequest_global.hpp"
+
+namespace qhr {
+
+class QHR_EXPORT TimerWheel : public QObject
+{
+    Q_OBJECT
+
+public:
+    //! Milliseconds covered by each slot by default, the precision of timeouts
+    static constexpr int DefaultResolution = 50;
+    static constexpr int Slots = 256;
+
+    TimerWheel(int resolution = DefaultResolution, QObject* parent = nullptr);
+
+    static TimerWheel* shared();
+
+    int resolution() const { return mResolution; }
+
+    quint64 start(int msec, QObject* context, std::function<void()> callback);
+    void stop(quint64 id);
+    int count() const { return mEntries.size(); }
+
+protected:
+    void timerEvent(QTimerEvent* event) override;
+
+private:
+    struct Entry
+    {
+        qint64 tick;
+        QPointer<QObject> context;
+        std::function<void()> callback;
+    };
+
+    void advance();
+
+private:
+    int mResolution;
+    std::array<QList<quint64>, Slots> mSlots;
+    QHash<quint64, Entry> mEntries;
+    quint64 mNextId;
+    qint64 mTick;
+    QElapsedTimer mClock;
+    QBasicTimer mTimer;
+};
+
+}
+
+#endif // TIMERWHEEL_HPP
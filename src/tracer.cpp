@@ -0,0 +1,150 @@
+#include "tracer.hpp"
+
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+
+#include <chrono>
+#include <cstring>
+
+namespace qhr {
+
+/*!
+ * \class Tracer
+ * \brief Tracer class recording request lifecycle events into a fixed size
+ * ring buffer that can be exported as Chrome Trace Event JSON and loaded into
+ * Perfetto or chrome://tracing.
+ *
+ * Recording is lock-free: a writer claims a slot with an atomic counter and
+ * publishes it with a per-slot sequence number, so the oldest events are
+ * overwritten when the buffer is full. Timestamps are microseconds of the
+ * monotonic clock, the clock most tracing tools use.
+ */
+
+std::atomic<Tracer*> Tracer::sActive { nullptr };
+
+/*!
+ * \brief Initialize a tracer keeping the last \a capacity events.
+ * \param capacity
+ */
+Tracer::Tracer(int capacity)
+    : mSlots(new Slot[qMax(1, capacity)]), mCapacity(quint64(qMax(1, capacity))),
+      mNext(0)
+{
+}
+
+/*!
+ * \brief Tracer::active() Returns the tracer events are recorded into, or
+ * nullptr when tracing is disabled, which is the only cost paid by callers then.
+ * \return
+ */
+Tracer* Tracer::active()
+{
+    return sActive.load(std::memory_order_acquire);
+}
+
+void Tracer::setActive(Tracer* tracer)
+{
+    sActive.store(tracer, std::memory_order_release);
+}
+
+/*!
+ * \brief Tracer::now() Returns the current monotonic time in microseconds.
+ * \return
+ */
+qint64 Tracer::now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/*!
+ * \brief Tracer::record() Records an event. \a phase is a Chrome trace event
+ * phase, like 'b' and 'e' for the begin and end of a request, 'n' for an
+ * instant event of a request and 'X' for a complete event lasting \a duration
+ * microseconds. \a detail is truncated to fit the event.
+ */
+void Tracer::record(const char* name, char phase, quint64 id, qint64 timestamp,
+    qint64 duration, const QByteArray& detail)
+{
+    const quint64 index = mNext.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = mSlots[index % mCapacity];
+
+    // An odd sequence marks the slot as being written
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.event.name = name;
+    slot.event.phase = phase;
+    slot.event.id = id;
+    slot.event.timestamp = timestamp;
+    slot.event.duration = duration;
+    slot.event.thread = quint64(quintptr(QThread::currentThreadId()));
+
+    const auto size = qMin(size_t(detail.size()), sizeof(slot.event.detail) - 1);
+    std::memcpy(slot.event.detail, detail.constData(), size);
+    slot.event.detail[size] = '\0';
+
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+/*!
+ * \brief Tracer::toChromeTraceJson() Returns the recorded events, oldest first,
+ * as a Chrome Trace Event JSON document. Slots being written concurrently are
+ * skipped.
+ * \return
+ */
+QByteArray Tracer::toChromeTraceJson() const
+{
+    const quint64 end = mNext.load(std::memory_order_acquire);
+    const quint64 begin = end > mCapacity ? end - mCapacity : 0;
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    QJsonArray events;
+    for (quint64 index = begin; index < end; ++index) {
+        const Slot& slot = mSlots[index % mCapacity];
+
+        const quint64 sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != 2 * index + 2) {
+            continue;
+        }
+        const Event event = slot.event;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+            continue;
+        }
+
+        QJsonObject object {
+            { "name", event.name },
+            { "cat", "qmlhttprequest" },
+            { "ph", QString(QChar(event.phase)) },
+            { "ts", double(event.timestamp) },
+            { "pid", double(pid) },
+            { "tid", double(event.thread & 0xFFFFFFFF) },
+        };
+        QJsonObject args { { "request", double(event.id) } };
+        if (event.detail[0] != '\0') {
+            args.insert("detail", QString::fromUtf8(event.detail));
+        }
+
+        if (event.phase == 'X') {
+            object.insert("dur", double(event.duration));
+        } else {
+            object.insert("id", QString::number(event.id, 16).prepend("0x"));
+        }
+        object.insert("args", args);
+
+        events.append(object);
+    }
+
+    return QJsonDocument(QJsonObject {
+                             { "traceEvents", events },
+                             { "displayTimeUnit", "ms" },
+                         })
+        .toJson(QJsonDocument::Compact);
+}
+
+}
@@ -0,0 +1,79 @@
+/*!
+ * Copyright (c) 2023 Alireza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TRACER_HPP
+#define TRACER_HPP
+
+#include <QByteArray>
+#include <QtGlobal>
+
+#include <atomic>
+#include <memory>
+
+#include "qmlhttprequest_global.hpp"
+
+namespace qhr {
+
+class QHR_EXPORT Tracer
+{
+public:
+    struct Event
+    {
+        const char* name;
+        char        phase;
+        quint64     id;
+        qint64      timestamp;
+        qint64      duration;
+        quint64     thread;
+        char        detail[112];
+    };
+
+    explicit Tracer(int capacity);
+
+    static Tracer* active();
+    static void setActive(Tracer* tracer);
+    static qint64 now();
+
+    void record(const char* name, char phase, quint64 id, qint64 timestamp,
+        qint64 duration = 0, const QByteArray& detail = QByteArray());
+
+    int capacity() const { return int(mCapacity); }
+    QByteArray toChromeTraceJson() const;
+
+private:
+    struct Slot
+    {
+        std::atomic<quint64> sequence { 0 };
+        Event event;
+    };
+
+    std::unique_ptr<Slot[]> mSlots;
+    quint64 mCapacity;
+    std::atomic<quint64> mNext;
+
+    static std::atomic<Tracer*> sActive;
+};
+
+}
+
+#endif // TRACER_HPP
@@ -0,0 +1,31 @@
+#include "workerthread.hpp"
+
+#include <QCoreApplication>
+
+namespace qhr {
+
+/*!
+ * \brief workerThread() Returns the thread shared by all requests for work
+ * that must not block the GUI thread, like parsing or hashing large bodies.
+ * It is started on first use and stopped when the application quits.
+ * \return
+ */
+QThread* workerThread()
+{
+    static QThread* thread = []() {
+        auto thread = new QThread;
+        thread->setObjectName("QmlHttpRequest worker");
+        thread->start();
+
+        if (auto app = QCoreApplication::instance()) {
+            QObject::connect(app, &QCoreApplication::aboutToQuit, [thread]() {
+                thread->quit();
+                thread->wait();
+            });
+        }
+        return thread;
+    }();
+    return thread;
+}
+
+}
@@ -0,0 +1,91 @@
+/*!
+ * Copyright (c) 2023 Alireza
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef LOCALSERVER_HPP
+#define LOCALSERVER_HPP
+
+#include <QCoreApplication>
+#include <QLocalServer>
+#include <QLocalSocket>
+
+/*!
+ * \brief The LocalServer class is a stand-in for a local agent, answering each
+ * request received on a connection with the next of \a responses.
+ */
+class LocalServer : public QLocalServer
+{
+public:
+    LocalServer(const QList<QByteArray>& responses) : mResponses(responses)
+    {
+        QLocalServer::removeServer(name());
+        listen(name());
+        connect(this, &QLocalServer::newConnection, this, [this]() {
+            while (auto socket = nextPendingConnection()) {
+                ++connections;
+                connect(socket, &QLocalSocket::readyRead, this,
+                    [this, socket]() { onReadyRead(socket); });
+            }
+        });
+    }
+
+    static QString name()
+    {
+        return QString("qhr-test-%1").arg(QCoreApplication::applicationPid());
+    }
+
+    int connections = 0;
+    QList<QByteArray> requests;
+
+private:
+    void onReadyRead(QLocalSocket* socket)
+    {
+        mInput += socket->readAll();
+        for (;;) {
+            const auto end = mInput.indexOf("\r\n\r\n");
+            if (end < 0) {
+                return;
+            }
+
+            qint64 length = 0;
+            for (const auto& line : mInput.left(end).split('\n')) {
+                if (line.toLower().startsWith("content-length:")) {
+                    length = line.mid(15).trimmed().toLongLong();
+                }
+            }
+            if (mInput.size() < end + 4 + length) {
+                return;
+            }
+
+            requests.append(mInput.left(end + 4 + length));
+            mInput.remove(0, end + 4 + length);
+            if (!mResponses.isEmpty()) {
+                socket->write(mResponses.takeFirst());
+            }
+        }
+    }
+
+    QList<QByteArray> mResponses;
+    QByteArray mInput;
+};
+
+#endif // LOCALSERVER_HPP
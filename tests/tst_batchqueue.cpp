@@ -0,0 +1,160 @@
+#include <QCoreApplication>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "batchqueue.hpp"
+#include "localserver.hpp"
+#include "localsocketnetworkaccessmanager.hpp"
+
+static const QByteArray Ok = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+
+static QByteArray body(const QByteArray& request)
+{
+    return request.mid(request.indexOf("\r\n\r\n") + 4);
+}
+
+class TestBatchQueue : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        queue.configure({
+            { "url", QUrl("http+unix://" + LocalServer::name() + "/batch") },
+            { "flushInterval", 60000 },
+        });
+    }
+
+    LocalServer server { { Ok, Ok, Ok } };
+    qhr::LocalSocketNetworkAccessManager nam;
+    qhr::BatchQueue queue { &nam };
+};
+
+TEST_F(TestBatchQueue, TestCountThreshold)
+{
+    queue.setMaxBatchSize(3);
+    queue.enqueue(QVariantMap { { "id", 1 } });
+    queue.enqueue(QVariantMap { { "id", 2 } });
+    QTest::qWait(50);
+    ASSERT_TRUE(server.requests.isEmpty());
+    ASSERT_EQ(queue.pending(), 2);
+
+    queue.enqueue(QVariantMap { { "id", 3 } });
+    ASSERT_TRUE(QTest::qWaitFor([this]() { return queue.delivered() == 3; }));
+    ASSERT_EQ(server.requests.size(), 1);
+    ASSERT_TRUE(server.requests[0].contains(
+        "Content-Type: application/json\r\n"));
+    ASSERT_EQ(body(server.requests[0]),
+        QByteArray("[{\"id\":1},{\"id\":2},{\"id\":3}]"));
+    ASSERT_EQ(queue.batchesSent(), 1);
+    ASSERT_EQ(queue.pending(), 0);
+}
+
+TEST_F(TestBatchQueue, TestByteThreshold)
+{
+    // Each payload takes 10 bytes and a separator
+    queue.setMaxBatchBytes(20);
+    queue.enqueue("aaaaaaaa");
+    QTest::qWait(50);
+    ASSERT_TRUE(server.requests.isEmpty());
+
+    // Sends what fits in the byte limit, the rest waits for the next batch
+    queue.enqueue("bbbbbbbb");
+    ASSERT_TRUE(QTest::qWaitFor([this]() { return queue.delivered() == 1; }));
+    ASSERT_EQ(body(server.requests[0]), QByteArray("[\"aaaaaaaa\"]"));
+    ASSERT_EQ(queue.pending(), 1);
+
+    queue.flush();
+    ASSERT_TRUE(QTest::qWaitFor([this]() { return queue.delivered() == 2; }));
+    ASSERT_EQ(body(server.requests[1]), QByteArray("[\"bbbbbbbb\"]"));
+
+    // Sent payloads no longer count towards the limit
+    queue.enqueue("cccccccc");
+    QTest::qWait(50);
+    ASSERT_EQ(server.requests.size(), 2);
+    ASSERT_EQ(queue.pending(), 1);
+}
+
+TEST_F(TestBatchQueue, TestNdJson)
+{
+    queue.configure({ { "format", "ndjson" } });
+    queue.enqueue(QVariantMap { { "a", 1 } });
+    queue.enqueue(2);
+    queue.flush();
+
+    ASSERT_TRUE(QTest::qWaitFor([this]() { return queue.delivered() == 2; }));
+    ASSERT_TRUE(server.requests[0].contains(
+        "Content-Type: application/x-ndjson\r\n"));
+    ASSERT_EQ(body(server.requests[0]), QByteArray("{\"a\":1}\n2\n"));
+}
+
+TEST_F(TestBatchQueue, TestCompressed)
+{
+    queue.setCompress(true);
+    queue.enqueue(QVariantList { 1, 2, 3 });
+    queue.flush();
+
+    ASSERT_TRUE(QTest::qWaitFor([this]() { return queue.delivered() == 1; }));
+    ASSERT_TRUE(server.requests[0].contains("Content-Encoding: deflate\r\n"));
+
+    // A zlib stream, qUncompress() expects it prefixed by its size
+    const auto compressed = body(server.requests[0]);
+    ASSERT_EQ(qUncompress(QByteArray("\0\0\0\x09", 4) + compressed),
+        QByteArray("[[1,2,3]]"));
+}
+
+TEST_F(TestBatchQueue, TestOverflowDrop)
+{
+    qhr::BatchQueue offline(nullptr);
+    offline.configure({ { "maxQueueSize", 2 }, { "flushInterval", 60000 } });
+
+    ASSERT_TRUE(offline.enqueue(1));
+    ASSERT_TRUE(offline.enqueue(2));
+    ASSERT_FALSE(offline.enqueue(3));
+    ASSERT_EQ(offline.pending(), 2);
+    ASSERT_EQ(offline.dropped(), 1);
+}
+
+TEST_F(TestBatchQueue, TestOverflowSpill)
+{
+    QTemporaryDir directory;
+    const auto spillFile
+        = QUrl::fromLocalFile(directory.filePath("queue.ndjson"));
+
+    {
+        qhr::BatchQueue offline(nullptr);
+        offline.configure({
+            { "maxQueueSize", 2 },
+            { "flushInterval", 60000 },
+            { "spillFile", spillFile },
+        });
+        ASSERT_TRUE(offline.enqueue(1));
+        ASSERT_TRUE(offline.enqueue(2));
+        ASSERT_TRUE(offline.enqueue(3));
+        ASSERT_EQ(offline.spilled(), 1);
+        ASSERT_EQ(offline.dropped(), 0);
+        // Queued payloads are spilled too when the queue is destroyed
+    }
+
+    QFile file(spillFile.toLocalFile());
+    ASSERT_TRUE(file.open(QFile::ReadOnly));
+    ASSERT_EQ(file.readAll(), QByteArray("3\n1\n2\n"));
+    file.close();
+
+    // Sent with the next batch of another queue using the same file
+    queue.setSpillFile(spillFile);
+    queue.flush();
+    ASSERT_TRUE(QTest::qWaitFor([this]() { return queue.delivered() == 3; }));
+    ASSERT_EQ(body(server.requests[0]), QByteArray("[3,1,2]"));
+    ASSERT_FALSE(file.exists());
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    ::testing::InitGoogleMock(&argc, argv);
+    return RUN_ALL_TESTS();
+}
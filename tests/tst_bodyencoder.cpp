@@ -0,0 +1,109 @@
+#include <QCborValue>
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QTest>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "bodyencoder.hpp"
+#include "workerthread.hpp"
+
+TEST(TestBodyEncoder, TestFormUrlEncoded)
+{
+    const QVariantMap body {
+        { "name", "Jane Doe" },
+        { "age", 42.0 },
+        { "note", "a&b=c/ü" },
+        { "user",
+            QVariantMap {
+                { "tags", QVariantList { "x", "y" } },
+            } },
+    };
+
+    ASSERT_EQ(qhr::BodyEncoder::formUrlEncoded(body),
+        QByteArray("age=42&name=Jane+Doe&note=a%26b%3Dc%2F%C3%BC"
+                   "&user%5Btags%5D%5B0%5D=x&user%5Btags%5D%5B1%5D=y"));
+}
+
+TEST(TestBodyEncoder, TestCbor)
+{
+    const QVariantMap body {
+        { "id", 7.0 },
+        { "ratio", 0.5 },
+        { "data", QByteArray("\x01\x02", 2) },
+        { "items", QVariantList { true, QVariant() } },
+    };
+
+    const auto value = QCborValue::fromCbor(qhr::BodyEncoder::cbor(body));
+    ASSERT_TRUE(value.isMap());
+    ASSERT_TRUE(value["id"].isInteger());
+    ASSERT_EQ(value["id"].toInteger(), 7);
+    ASSERT_EQ(value["ratio"].toDouble(), 0.5);
+    ASSERT_EQ(value["data"].toByteArray(), QByteArray("\x01\x02", 2));
+    ASSERT_TRUE(value["items"][1].isNull());
+}
+
+TEST(TestBodyEncoder, TestMsgpack)
+{
+    ASSERT_EQ(qhr::BodyEncoder::msgpack(QVariantMap { { "a", 1.0 } }),
+        QByteArray("\x81\xa1" "a" "\x01"));
+    ASSERT_EQ(qhr::BodyEncoder::msgpack(QVariantList { -1.0, 300.0, 1.5 }),
+        QByteArray("\x93\xff\xcd\x01\x2c\xcb\x3f\xf8\x00\x00\x00\x00\x00\x00",
+            14));
+    ASSERT_EQ(qhr::BodyEncoder::msgpack(QVariant()), QByteArray("\xc0"));
+
+    QByteArray bytes;
+    ASSERT_TRUE(qhr::BodyEncoder::encode(
+        "application/x-msgpack; charset=binary", QVariantList(), bytes));
+    ASSERT_EQ(bytes, QByteArray("\x90"));
+    ASSERT_FALSE(qhr::BodyEncoder::encode("text/plain", QVariantList(), bytes));
+}
+
+TEST(TestBodyEncoder, TestJson)
+{
+    const QVariantMap body { { "name", "Jane" },
+        { "tags", QVariantList { "admin", 2.0 } } };
+    ASSERT_EQ(qhr::BodyEncoder::json(body),
+        QByteArray(R"({"name":"Jane","tags":["admin",2]})"));
+
+    QByteArray bytes;
+    ASSERT_TRUE(qhr::BodyEncoder::encode("", body, bytes));
+    ASSERT_EQ(bytes, qhr::BodyEncoder::json(body));
+    ASSERT_TRUE(qhr::BodyEncoder::encode(
+        "application/problem+json; charset=utf-8", QVariantList { 1.0 }, bytes));
+    ASSERT_EQ(bytes, QByteArray("[1]"));
+
+    // Strings and scalars are sent as text
+    ASSERT_FALSE(qhr::BodyEncoder::hasEncoder("application/json", "{}"));
+    ASSERT_FALSE(qhr::BodyEncoder::hasEncoder("application/json", 1.0));
+}
+
+TEST(TestBodyEncoder, TestAsyncEncoder)
+{
+    QVariantList rows;
+    for (int i = 0; i < 20000; ++i) {
+        rows.append(QVariantMap { { "id", double(i) }, { "name", "row" } });
+    }
+    ASSERT_GT(qhr::BodyEncoder::estimateSize(rows),
+        qhr::BodyEncoder::AsyncThreshold);
+
+    QByteArray bytes;
+    auto encoder = new qhr::AsyncBodyEncoder("application/json", rows);
+    encoder->moveToThread(qhr::workerThread());
+    QObject::connect(encoder, &qhr::AsyncBodyEncoder::encoded, qApp,
+        [&bytes](const QByteArray& encoded) { bytes = encoded; });
+    QMetaObject::invokeMethod(encoder, &qhr::AsyncBodyEncoder::encode);
+
+    ASSERT_TRUE(QTest::qWaitFor([&bytes]() { return !bytes.isEmpty(); }));
+    encoder->deleteLater();
+    ASSERT_EQ(QJsonDocument::fromJson(bytes).toVariant().toList().size(),
+        rows.size());
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    ::testing::InitGoogleMock(&argc, argv);
+    return RUN_ALL_TESTS();
+}
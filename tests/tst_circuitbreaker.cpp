@@ -0,0 +1,57 @@
+#include <QTest>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "circuitbreaker.hpp"
+
+class TestCircuitBreaker : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        breaker.configure({
+            { "failureThreshold", 50 },
+            { "minimumRequests", 4 },
+            { "windowSize", 10 },
+        });
+    }
+
+    qhr::CircuitBreaker breaker { "fake.com" };
+};
+
+TEST_F(TestCircuitBreaker, TestOpensAboveFailureThreshold)
+{
+    breaker.recordSuccess();
+    breaker.recordFailure();
+    breaker.recordSuccess();
+    ASSERT_EQ(breaker.state(), qhr::CircuitBreaker::Closed);
+
+    breaker.recordFailure();
+    ASSERT_EQ(breaker.state(), qhr::CircuitBreaker::Open);
+    ASSERT_FALSE(breaker.allowRequest());
+}
+
+TEST_F(TestCircuitBreaker, TestHalfOpenTrialRequest)
+{
+    breaker.setOpenDuration(0);
+    for (int i = 0; i < 4; ++i) {
+        breaker.recordFailure();
+    }
+    ASSERT_TRUE(QTest::qWaitFor(
+        [this]() { return breaker.state() == qhr::CircuitBreaker::HalfOpen; }));
+
+    ASSERT_TRUE(breaker.allowRequest());
+    ASSERT_FALSE(breaker.allowRequest());
+
+    breaker.recordSuccess();
+    ASSERT_EQ(breaker.state(), qhr::CircuitBreaker::Closed);
+    ASSERT_EQ(breaker.failureRate(), 0.0);
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    ::testing::InitGoogleMock(&argc, argv);
+    return RUN_ALL_TESTS();
+}
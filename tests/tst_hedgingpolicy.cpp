@@ -0,0 +1,45 @@
+#include <QTest>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "hedgingpolicy.hpp"
+
+class TestHedgingPolicy : public ::testing::Test
+{
+public:
+    qhr::HedgingPolicy policy;
+};
+
+TEST_F(TestHedgingPolicy, TestNoPercentileWithoutEnoughSamples)
+{
+    policy.recordLatency("fake.com", 100);
+    ASSERT_EQ(policy.latencyPercentile("fake.com", 0.95), -1);
+    ASSERT_EQ(policy.latencyPercentile("other.com", 0.95), -1);
+}
+
+TEST_F(TestHedgingPolicy, TestLatencyPercentile)
+{
+    for (int i = 1; i <= 20; ++i) {
+        policy.recordLatency("fake.com", i * 10);
+    }
+    ASSERT_EQ(policy.latencyPercentile("fake.com", 0.95), 190);
+    ASSERT_EQ(policy.latencyPercentile("fake.com", 0.5), 100);
+}
+
+TEST_F(TestHedgingPolicy, TestHedgeBudget)
+{
+    policy.setMaxHedgeRatio(50);
+    ASSERT_FALSE(policy.tryHedge());
+
+    policy.requestSent();
+    policy.requestSent();
+    ASSERT_TRUE(policy.tryHedge());
+    ASSERT_FALSE(policy.tryHedge());
+}
+
+int main(int argc, char* argv[])
+{
+    ::testing::InitGoogleMock(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,185 @@
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "imageprovider.hpp"
+
+static QByteArray png(const QSize& size)
+{
+    QImage image(size, QImage::Format_RGB32);
+    image.fill(Qt::red);
+
+    QByteArray bytes;
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG");
+    return bytes;
+}
+
+TEST(TestImageProvider, TestScaledSize)
+{
+    using qhr::ImageLoader;
+    ASSERT_EQ(ImageLoader::scaledSize(QSize(400, 200), QSize()),
+        QSize(400, 200));
+    ASSERT_EQ(ImageLoader::scaledSize(QSize(400, 200), QSize(100, 0)),
+        QSize(100, 50));
+    ASSERT_EQ(ImageLoader::scaledSize(QSize(400, 200), QSize(-1, 20)),
+        QSize(40, 20));
+    ASSERT_EQ(ImageLoader::scaledSize(QSize(400, 200), QSize(100, 100)),
+        QSize(100, 50));
+    // Never scaled up
+    ASSERT_EQ(ImageLoader::scaledSize(QSize(40, 20), QSize(100, 100)),
+        QSize(40, 20));
+}
+
+TEST(TestImageProvider, TestDecode)
+{
+    const auto bytes = png(QSize(400, 200));
+
+    ASSERT_EQ(qhr::ImageLoader::decode(bytes, QSize()).size(), QSize(400, 200));
+    ASSERT_EQ(qhr::ImageLoader::decode(bytes, QSize(100, 0)).size(),
+        QSize(100, 50));
+
+    QString error;
+    ASSERT_TRUE(qhr::ImageLoader::decode("not an image", QSize(), &error)
+                    .isNull());
+    ASSERT_FALSE(error.isEmpty());
+}
+
+TEST(TestImageProvider, TestSharedLoad)
+{
+    QTemporaryDir directory;
+    qhr::ImageLoader loader(nullptr);
+    loader.setDiskCacheDirectory(directory.path());
+
+    const QUrl url("https://example.org/photo.png");
+    QFile file(loader.diskPath(url));
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write(qhr::ImageLoader::diskEntry(png(QSize(400, 200)),
+        QDateTime::currentDateTimeUtc().addSecs(60)));
+    file.close();
+
+    QList<QSize> sizes;
+    auto load = [&](const QSize& size) {
+        auto ticket = new qhr::ImageTicket(url, size);
+        QObject::connect(ticket, &qhr::ImageTicket::done, ticket,
+            [&sizes, ticket](const QImage& image, const QString& error) {
+                EXPECT_TRUE(error.isEmpty());
+                sizes.append(image.size());
+                ticket->deleteLater();
+            });
+        loader.load(ticket);
+    };
+
+    // Both loads share the bytes read from disk, each gets its own size
+    load(QSize(100, 0));
+    load(QSize(200, 0));
+    ASSERT_EQ(loader.pendingCount(), 1);
+    ASSERT_TRUE(QTest::qWaitFor([&sizes]() { return sizes.size() == 2; }));
+    ASSERT_TRUE(sizes.contains(QSize(100, 50)));
+    ASSERT_TRUE(sizes.contains(QSize(200, 100)));
+    ASSERT_EQ(loader.pendingCount(), 0);
+
+    // Served from memory right away
+    load(QSize(100, 0));
+    ASSERT_EQ(sizes.size(), 3);
+    ASSERT_EQ(sizes.last(), QSize(100, 50));
+}
+
+TEST(TestImageProvider, TestDiskExpiry)
+{
+    using qhr::ImageLoader;
+    const auto now = QDateTime::fromString(
+        "Wed, 21 Oct 2015 07:28:00 +0000", Qt::RFC2822Date);
+
+    ASSERT_FALSE(ImageLoader::diskExpiry("no-store", "", now).isValid());
+    ASSERT_FALSE(
+        ImageLoader::diskExpiry("private, max-age=60", "", now).isValid());
+    ASSERT_FALSE(ImageLoader::diskExpiry("max-age=0", "", now).isValid());
+    ASSERT_EQ(ImageLoader::diskExpiry("public, Max-Age=60", "", now),
+        now.addSecs(60));
+
+    // max-age takes precedence over Expires
+    const QByteArray expires = "Wed, 21 Oct 2015 08:28:00 GMT";
+    ASSERT_EQ(ImageLoader::diskExpiry("max-age=60", expires, now),
+        now.addSecs(60));
+    ASSERT_EQ(ImageLoader::diskExpiry("", expires, now), now.addSecs(3600));
+    ASSERT_FALSE(ImageLoader::diskExpiry("", "0", now).isValid());
+
+    ASSERT_EQ(ImageLoader::diskExpiry("", "", now),
+        now.addSecs(ImageLoader::DefaultDiskLifetime));
+}
+
+TEST(TestImageProvider, TestExpiredEntry)
+{
+    using qhr::ImageLoader;
+    const auto now = QDateTime::currentDateTimeUtc();
+    const auto bytes = png(QSize(40, 20));
+    const auto fresh = ImageLoader::diskEntry(bytes, now.addSecs(60));
+    ASSERT_EQ(ImageLoader::diskBytes(fresh, now), bytes);
+    ASSERT_TRUE(ImageLoader::diskBytes(fresh, now.addSecs(61)).isEmpty());
+    ASSERT_TRUE(ImageLoader::diskBytes(bytes, now).isEmpty());
+
+    QTemporaryDir directory;
+    ImageLoader loader(nullptr);
+    loader.setDiskCacheDirectory(directory.path());
+
+    const QUrl url("https://example.org/stale.png");
+    QFile file(loader.diskPath(url));
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write(ImageLoader::diskEntry(bytes, now.addSecs(-1)));
+    file.close();
+
+    // An expired entry is a miss, which fails without a QmlHttpRequest
+    QString error;
+    auto ticket = new qhr::ImageTicket(url, QSize());
+    QObject::connect(ticket, &qhr::ImageTicket::done,
+        [&error](const QImage&, const QString& reason) { error = reason; });
+    loader.load(ticket);
+    ASSERT_TRUE(QTest::qWaitFor([&error]() { return !error.isEmpty(); }));
+    ASSERT_FALSE(file.exists());
+    delete ticket;
+}
+
+TEST(TestImageProvider, TestCancel)
+{
+    QTemporaryDir directory;
+    qhr::ImageLoader loader(nullptr);
+    loader.setDiskCacheDirectory(directory.path());
+
+    const QUrl url("https://example.org/missing.png");
+    auto ticket = new qhr::ImageTicket(url, QSize());
+    bool done = false;
+    QObject::connect(ticket, &qhr::ImageTicket::done,
+        [&done](const QImage&, const QString&) { done = true; });
+
+    loader.load(ticket);
+    ASSERT_EQ(loader.pendingCount(), 1);
+    delete ticket;
+    ASSERT_EQ(loader.pendingCount(), 0);
+
+    QTest::qWait(100);
+    ASSERT_FALSE(done);
+
+    // Without a QmlHttpRequest a disk cache miss fails
+    QString error;
+    ticket = new qhr::ImageTicket(url, QSize());
+    QObject::connect(ticket, &qhr::ImageTicket::done,
+        [&error](const QImage&, const QString& reason) { error = reason; });
+    loader.load(ticket);
+    ASSERT_TRUE(QTest::qWaitFor([&error]() { return !error.isEmpty(); }));
+    delete ticket;
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    ::testing::InitGoogleMock(&argc, argv);
+    return RUN_ALL_TESTS();
+}
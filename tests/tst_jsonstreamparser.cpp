@@ -0,0 +1,107 @@
+#include <QTest>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "jsonstreamparser.hpp"
+
+class TestJsonStreamParser : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        QObject::connect(&parser, &qhr::JsonStreamParser::itemsParsed,
+            [this](const QVariantList& batch) {
+                items.append(batch);
+                ++batches;
+            });
+        QObject::connect(&parser, &qhr::JsonStreamParser::finished,
+            [this](const QString& e) {
+                error = e;
+                finished = true;
+            });
+    }
+
+    qhr::JsonStreamParser parser;
+    QVariantList items;
+    int batches = 0;
+    QString error;
+    bool finished = false;
+};
+
+TEST_F(TestJsonStreamParser, TestArrayAcrossChunks)
+{
+    parser.feed("  [{\"name\": \"a, [b]\"}, 4");
+    parser.feed("2, \"x\\\"]\", [1, {\"c\"");
+    parser.feed(": null}] ]");
+    parser.finish();
+
+    ASSERT_TRUE(finished);
+    ASSERT_TRUE(error.isEmpty());
+    ASSERT_EQ(parser.format(), qhr::JsonStreamParser::Array);
+    ASSERT_EQ(items.size(), 4);
+    ASSERT_EQ(items[0].toMap().value("name").toString(), QString("a, [b]"));
+    ASSERT_EQ(items[1].toInt(), 42);
+    ASSERT_EQ(items[2].toString(), QString("x\"]"));
+    ASSERT_EQ(items[3].toList().size(), 2);
+}
+
+TEST_F(TestJsonStreamParser, TestNdJsonBatches)
+{
+    parser.setBatchSize(2);
+    parser.feed("{\"id\": 1}\n{\"id\"");
+    parser.feed(": 2}\r\n\n{\"id\": 3}\n{\"id\": 4}");
+    parser.finish();
+
+    ASSERT_TRUE(error.isEmpty());
+    ASSERT_EQ(parser.format(), qhr::JsonStreamParser::Lines);
+    ASSERT_EQ(items.size(), 4);
+    ASSERT_EQ(items[3].toMap().value("id").toInt(), 4);
+    ASSERT_EQ(batches, 3);
+}
+
+TEST_F(TestJsonStreamParser, TestErrors)
+{
+    parser.feed("[1, 2");
+    parser.finish();
+    ASSERT_FALSE(error.isEmpty());
+
+    qhr::JsonStreamParser lines;
+    lines.feed("{\"id\": 1}\nnot json\n");
+    lines.finish();
+    ASSERT_FALSE(lines.errorString().isEmpty());
+
+    qhr::JsonStreamParser braces;
+    braces.feed("[1}");
+    braces.finish();
+    ASSERT_FALSE(braces.errorString().isEmpty());
+}
+
+TEST_F(TestJsonStreamParser, TestArrayElements)
+{
+    for (const char* body : { "[1,,2]", "[1,2,]", "[,]", "[ , 1]" }) {
+        qhr::JsonStreamParser empty;
+        empty.feed(body);
+        empty.finish();
+        ASSERT_FALSE(empty.errorString().isEmpty()) << body;
+    }
+
+    // Only white space may follow the array, in any chunk
+    qhr::JsonStreamParser trailing;
+    trailing.feed("[1] \n");
+    trailing.feed(" x");
+    trailing.finish();
+    ASSERT_FALSE(trailing.errorString().isEmpty());
+
+    parser.feed(" [ ");
+    parser.feed("] \r\n");
+    parser.finish();
+    ASSERT_TRUE(error.isEmpty());
+    ASSERT_TRUE(items.isEmpty());
+}
+
+int main(int argc, char* argv[])
+{
+    ::testing::InitGoogleMock(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,111 @@
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QNetworkReply>
+#include <QTest>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "localserver.hpp"
+#include "localsocketnetworkaccessmanager.hpp"
+
+TEST(TestLocalSocket, TestSplitUrl)
+{
+    QString serverName;
+    QByteArray target;
+
+    ASSERT_TRUE(qhr::LocalSocketNetworkAccessManager::splitUrl(
+        QUrl("unix:/run/agent.sock:/v1/status?full=1"), serverName, target));
+    ASSERT_EQ(serverName, QString("/run/agent.sock"));
+    ASSERT_EQ(target, QByteArray("/v1/status?full=1"));
+
+    ASSERT_TRUE(qhr::LocalSocketNetworkAccessManager::splitUrl(
+        QUrl("http+unix://agent/v1/items"), serverName, target));
+    ASSERT_EQ(serverName, QString("agent"));
+    ASSERT_EQ(target, QByteArray("/v1/items"));
+
+    ASSERT_FALSE(qhr::LocalSocketNetworkAccessManager::splitUrl(
+        QUrl("http://agent/v1/items"), serverName, target));
+
+    ASSERT_EQ(qhr::LocalSocketNetworkAccessManager::resolvedUrl(
+                  QUrl("unix:/run/agent.sock:/v1/status"), "other?x=1"),
+        QUrl("unix:/run/agent.sock:/v1/other?x=1"));
+}
+
+TEST(TestLocalSocket, TestKeepAlive)
+{
+    LocalServer server({ "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"
+                         "Content-Length: 5\r\n\r\nfirst",
+        "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n" });
+    qhr::LocalSocketNetworkAccessManager nam;
+
+    const auto url = QUrl("http+unix://" + LocalServer::name() + "/v1/status");
+    auto reply = nam.get(QNetworkRequest(url));
+    ASSERT_TRUE(QTest::qWaitFor([reply]() { return reply->isFinished(); }));
+    ASSERT_EQ(reply->error(), QNetworkReply::NoError);
+    ASSERT_EQ(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(),
+        200);
+    ASSERT_EQ(reply->rawHeader("Content-Type"), QByteArray("text/plain"));
+    ASSERT_EQ(reply->readAll(), QByteArray("first"));
+    ASSERT_TRUE(server.requests[0].startsWith("GET /v1/status HTTP/1.1\r\n"));
+    reply->deleteLater();
+
+    reply = nam.get(QNetworkRequest(url));
+    ASSERT_TRUE(QTest::qWaitFor([reply]() { return reply->isFinished(); }));
+    ASSERT_EQ(reply->error(), QNetworkReply::ContentNotFoundError);
+    reply->deleteLater();
+
+    // Both requests are sent on the same connection
+    ASSERT_EQ(server.connections, 1);
+    ASSERT_EQ(nam.openConnections(LocalServer::name()), 1);
+}
+
+TEST(TestLocalSocket, TestChunkedResponse)
+{
+    LocalServer server({ "HTTP/1.1 201 Created\r\n"
+                         "Transfer-Encoding: chunked\r\n\r\n"
+                         "4\r\n[1,2\r\n3\r\n,3]\r\n0\r\n\r\n" });
+    qhr::LocalSocketNetworkAccessManager nam;
+
+    QNetworkRequest request(
+        QUrl("unix:" + server.fullServerName() + ":/v1/items"));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    auto reply = nam.post(request, QByteArray("{\"id\":1}"));
+
+    QByteArray body;
+    QObject::connect(reply, &QNetworkReply::readyRead,
+        [reply, &body]() { body += reply->readAll(); });
+    ASSERT_TRUE(QTest::qWaitFor([reply]() { return reply->isFinished(); }));
+
+    ASSERT_EQ(reply->error(), QNetworkReply::NoError);
+    ASSERT_EQ(body, QByteArray("[1,2,3]"));
+    ASSERT_TRUE(server.requests[0].contains("Content-Length: 8\r\n"));
+    ASSERT_TRUE(server.requests[0].endsWith("\r\n\r\n{\"id\":1}"));
+    reply->deleteLater();
+}
+
+TEST(TestLocalSocket, TestTimeout)
+{
+    LocalServer server({});
+    qhr::LocalSocketNetworkAccessManager nam;
+
+    QNetworkRequest request(
+        QUrl("http+unix://" + LocalServer::name() + "/slow"));
+    request.setTransferTimeout(100);
+    auto reply = nam.get(request);
+    ASSERT_TRUE(QTest::qWaitFor([reply]() { return reply->isFinished(); }));
+    ASSERT_EQ(reply->error(), QNetworkReply::TimeoutError);
+    reply->deleteLater();
+
+    reply = nam.get(QNetworkRequest(QUrl("http+unix://qhr-missing/")));
+    ASSERT_TRUE(QTest::qWaitFor([reply]() { return reply->isFinished(); }));
+    ASSERT_EQ(reply->error(), QNetworkReply::HostNotFoundError);
+    reply->deleteLater();
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    ::testing::InitGoogleMock(&argc, argv);
+    return RUN_ALL_TESTS();
+}
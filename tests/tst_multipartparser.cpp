@@ -0,0 +1,103 @@
+#include <QTest>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "multipartparser.hpp"
+
+static const QByteArray Body = "preamble\r\n"
+                               "--sep\r\n"
+                               "Content-Type: application/json\r\n"
+                               "\r\n"
+                               "{\"id\":1}\r\n"
+                               "--sep  \r\n"
+                               "\r\n"
+                               "--sepX is not a delimiter\r\n"
+                               "--sep--\r\n"
+                               "epilogue";
+
+TEST(TestMultipartParser, TestBoundary)
+{
+    using qhr::MultipartParser;
+    ASSERT_EQ(MultipartParser::boundary("multipart/mixed; boundary=sep"),
+        QByteArray("sep"));
+    ASSERT_EQ(MultipartParser::boundary(
+                  "Multipart/ByteRanges; charset=utf-8; Boundary=\"a b:c\""),
+        QByteArray("a b:c"));
+    ASSERT_TRUE(MultipartParser::boundary("text/plain; boundary=sep").isEmpty());
+    ASSERT_TRUE(MultipartParser::boundary("multipart/mixed").isEmpty());
+}
+
+TEST(TestMultipartParser, TestFind)
+{
+    using qhr::MultipartParser;
+    ASSERT_EQ(MultipartParser::find("xx\r\n--sep", "\r\n--sep", 0), 2);
+    ASSERT_EQ(MultipartParser::find("p\r\n--se", "\r\n--sep", 0), -1);
+    ASSERT_EQ(MultipartParser::find("ppp\r\n\r\n", "\r\n\r\n", 2), 3);
+    ASSERT_EQ(MultipartParser::find("ppp\r\n\r\n", "\r\n\r\n", 4), -1);
+}
+
+TEST(TestMultipartParser, TestParts)
+{
+    qhr::MultipartParser parser("sep");
+    parser.feed(Body);
+    ASSERT_TRUE(parser.isComplete());
+
+    const auto parts = parser.takeParts();
+    ASSERT_EQ(parts.size(), 2);
+    ASSERT_EQ(parts[0].index, 0);
+    ASSERT_EQ(parts[0].header("content-type"), QByteArray("application/json"));
+    ASSERT_EQ(parts[0].body(), QByteArray("{\"id\":1}"));
+    ASSERT_TRUE(parts[1].headers().isEmpty());
+    ASSERT_EQ(parts[1].body(), QByteArray("--sepX is not a delimiter"));
+
+    // Slices of the same buffer
+    ASSERT_EQ(parts[0].buffer.constData(), parts[1].buffer.constData());
+}
+
+TEST(TestMultipartParser, TestByteByByte)
+{
+    qhr::MultipartParser parser("sep");
+    QList<qhr::MultipartParser::Part> parts;
+    for (const char byte : Body) {
+        parser.feed(QByteArray(1, byte));
+        parts.append(parser.takeParts());
+    }
+
+    ASSERT_TRUE(parser.isComplete());
+    ASSERT_EQ(parts.size(), 2);
+    ASSERT_EQ(parts[0].body(), QByteArray("{\"id\":1}"));
+    ASSERT_EQ(parts[1].body(), QByteArray("--sepX is not a delimiter"));
+}
+
+TEST(TestMultipartParser, TestByteRanges)
+{
+    qhr::MultipartParser parser("3d6b6a416f9b5");
+    parser.feed("--3d6b6a416f9b5\r\n"
+                "Content-Type: text/plain\r\n"
+                "Content-Range: bytes 0-3/100\r\n"
+                "\r\n"
+                "abcd\r\n"
+                "--3d6b6a416f9b5\r\n"
+                "Content-Range: bytes 96-99/100\r\n"
+                "\r\n"
+                "wx");
+    auto parts = parser.takeParts();
+    ASSERT_EQ(parts.size(), 1);
+    ASSERT_EQ(parts[0].header("Content-Range"), QByteArray("bytes 0-3/100"));
+    ASSERT_EQ(parts[0].body(), QByteArray("abcd"));
+    ASSERT_FALSE(parser.isComplete());
+
+    parser.feed("yz\r\n--3d6b6a416f9b5--");
+    parts = parser.takeParts();
+    ASSERT_EQ(parts.size(), 1);
+    ASSERT_EQ(parts[0].index, 1);
+    ASSERT_EQ(parts[0].body(), QByteArray("wxyz"));
+    ASSERT_TRUE(parser.isComplete());
+}
+
+int main(int argc, char* argv[])
+{
+    ::testing::InitGoogleMock(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,18 +1,26 @@
+#include <QCoreApplication>
+#include <QJSEngine>
+#include <QNetworkAccessManager>
 #include <QTest>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "localserver.hpp"
 #include "qmlhttprequest.hpp"
 #include "request.hpp"
 
 class QmlHttpRequestTestable : public qhr::QmlHttpRequest
-{ };
+{
+public:
+    QmlHttpRequestTestable(QNetworkAccessManager* nam) : QmlHttpRequest(nam) { }
+};
 
 class TestQmlHttpRequest : public ::testing::Test
 {
 public:
-    QmlHttpRequestTestable qhr;
+    QNetworkAccessManager nam;
+    QmlHttpRequestTestable qhr { &nam };
 };
 
 TEST_F(TestQmlHttpRequest, TestNewRequest)
@@ -27,8 +35,136 @@ TEST_F(TestQmlHttpRequest, TestDefaultTimeout)
     ASSERT_EQ(request->timeout(), 3000);
 }
 
+TEST_F(TestQmlHttpRequest, TestClientProfile)
+{
+    qhr.client("api",
+        {
+            { "baseUrl", "https://fake.com/api/" },
+            { "headers", QVariantMap { { "Accept", "application/json" } } },
+            { "timeout", 5000 },
+        });
+
+    auto request = qhr.newRequest("api");
+    request->open("GET", QUrl("users"));
+    ASSERT_TRUE(request->isOpen());
+    ASSERT_STREQ(request->requestHeader("Accept").constData(),
+        "application/json");
+    ASSERT_EQ(request->timeout(), 5000);
+}
+
+TEST_F(TestQmlHttpRequest, TestGroups)
+{
+    auto first = qhr.newRequest();
+    auto second = qhr.newRequest();
+    first->setGroup("page");
+    second->setGroup("page");
+    ASSERT_EQ(qhr.groupSize("page"), 2);
+
+    second->setGroup("other");
+    ASSERT_EQ(qhr.groupSize("page"), 1);
+
+    delete first;
+    ASSERT_EQ(qhr.groupSize("page"), 0);
+    // Never sent, so there is nothing to abort
+    ASSERT_EQ(qhr.abortGroup("other"), 0);
+    delete second;
+}
+
+TEST_F(TestQmlHttpRequest, TestAbortQueuedGroup)
+{
+    LocalServer server({});
+    QJSEngine engine;
+    qhr.client("agent",
+        {
+            { "baseUrl", "http+unix://" + LocalServer::name() + "/" },
+            { "maxConcurrentRequests", 1 },
+        });
+
+    auto first = qhr.newRequest("agent");
+    auto queued = qhr.newRequest("agent");
+    auto unsent = qhr.newRequest("agent");
+    queued->setGroup("page");
+    unsent->setGroup("page");
+    queued->setOnAborted(engine.evaluate("(function() { aborted = true })"));
+
+    first->open("GET", QUrl("slow"));
+    first->send();
+    queued->open("GET", QUrl("queued"));
+    queued->send();
+    unsent->open("GET", QUrl("unsent"));
+    ASSERT_EQ(queued->readyState(), qhr::Request::State::Opened);
+
+    // The queued request is done right away, the unsent one is left alone
+    ASSERT_EQ(qhr.abortGroup("page"), 1);
+    ASSERT_EQ(queued->readyState(), qhr::Request::State::Done);
+    ASSERT_TRUE(engine.globalObject().property("aborted").toBool());
+    ASSERT_EQ(unsent->readyState(), qhr::Request::State::Opened);
+    ASSERT_EQ(qhr.abortGroup("page"), 0);
+
+    first->abort();
+    ASSERT_TRUE(QTest::qWaitFor([first]() {
+        return first->readyState() == qhr::Request::State::Done;
+    }));
+    delete first;
+    delete queued;
+    delete unsent;
+}
+
+TEST_F(TestQmlHttpRequest, TestHedgeWithinClientLimit)
+{
+    LocalServer server({});
+    qhr.setMaxHedgeRatio(100);
+    qhr.client("agent",
+        {
+            { "baseUrl", "http+unix://" + LocalServer::name() + "/" },
+            { "maxConcurrentRequests", 1 },
+        });
+
+    auto request = qhr.newRequest("agent");
+    request->setHedgeDelay(10);
+    request->open("GET", QUrl("slow"));
+    request->send();
+    ASSERT_TRUE(QTest::qWaitFor([&server]() {
+        return server.requests.size() == 1;
+    }));
+
+    // The only slot of the profile is taken by the request, so it is not
+    // hedged although the budget allows it
+    QTest::qWait(100);
+    ASSERT_EQ(server.requests.size(), 1);
+
+    request->abort();
+    ASSERT_TRUE(QTest::qWaitFor([request]() {
+        return request->readyState() == qhr::Request::State::Done;
+    }));
+    delete request;
+}
+
+TEST_F(TestQmlHttpRequest, TestTracingRestartedByCallback)
+{
+    QJSEngine engine;
+    QJSEngine::setObjectOwnership(&qhr, QJSEngine::CppOwnership);
+    engine.globalObject().setProperty("qhr", engine.newQObject(&qhr));
+
+    qhr.startTracing(16);
+    auto request = qhr.newRequest();
+    request->setOnError(
+        engine.evaluate("(function() { qhr.startTracing(16) })"));
+    request->open("PUT", QUrl("https://fake.com/blob"));
+    request->send(QUrl::fromLocalFile("/qhr-missing/blob.bin"));
+
+    // The callback is recorded into the tracer it started
+    ASSERT_TRUE(qhr.isTracing());
+    ASSERT_TRUE(qhr.traceJson().contains("\"onerror\""));
+    ASSERT_FALSE(qhr.traceJson().contains("\"open\""));
+
+    qhr.stopTracing();
+    delete request;
+}
+
 int main(int argc, char* argv[])
 {
+    QCoreApplication app(argc, argv);
     ::testing::InitGoogleMock(&argc, argv);
     return RUN_ALL_TESTS();
 }
@@ -0,0 +1,128 @@
+#include <QNetworkReply>
+#include <QTest>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "recorder.hpp"
+#include "replaynetworkaccessmanager.hpp"
+
+class TestRecorder : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        entry.startedDateTime
+            = QDateTime::fromString("2023-05-01T10:00:00.000Z", Qt::ISODateWithMs);
+        entry.method = "GET";
+        entry.url = QUrl("https://fake.com/items?page=2");
+        entry.requestHeaders = { { "Accept", "application/json" } };
+        entry.status = 200;
+        entry.statusText = "OK";
+        entry.responseHeaders = { { "Content-Type", "application/json" },
+            { "ETag", "\"abc\"" } };
+        entry.responseBody = "[1,2,3]";
+        entry.wait = 40;
+        entry.receive = 10;
+    }
+
+    qhr::Recorder::Entry entry;
+};
+
+TEST_F(TestRecorder, TestHarRoundTrip)
+{
+    auto binary = entry;
+    binary.method = "POST";
+    binary.requestHeaders = { { "Content-Type", "application/octet-stream" } };
+    binary.requestBody = QByteArray("\x00\xff\x10", 3);
+    binary.responseHeaders = { { "Content-Type", "image/png" } };
+    binary.responseBody = QByteArray("\x89PNG\x00", 5);
+
+    qhr::Recorder recorder;
+    recorder.record(entry);
+    recorder.record(binary);
+    ASSERT_EQ(recorder.count(), 2);
+
+    bool ok = false;
+    const auto entries = qhr::Recorder::fromHar(recorder.toHar(), &ok);
+    ASSERT_TRUE(ok);
+    ASSERT_EQ(entries.size(), 2);
+
+    ASSERT_EQ(entries[0].startedDateTime, entry.startedDateTime);
+    ASSERT_EQ(entries[0].url, entry.url);
+    ASSERT_EQ(entries[0].responseBody, entry.responseBody);
+    ASSERT_EQ(entries[0].responseHeaders, entry.responseHeaders);
+    ASSERT_EQ(entries[0].wait, 40);
+    ASSERT_EQ(entries[0].receive, 10);
+
+    ASSERT_EQ(entries[1].method, QByteArray("POST"));
+    ASSERT_EQ(entries[1].requestBody, binary.requestBody);
+    ASSERT_EQ(entries[1].responseBody, binary.responseBody);
+}
+
+TEST_F(TestRecorder, TestReplayServesRecordedResponse)
+{
+    qhr::ReplayNetworkAccessManager nam;
+    nam.setEntries({ entry });
+    nam.setLatencyScale(0);
+
+    auto reply = nam.get(QNetworkRequest(entry.url));
+    ASSERT_TRUE(QTest::qWaitFor([reply]() { return reply->isFinished(); }));
+
+    ASSERT_EQ(reply->error(), QNetworkReply::NoError);
+    ASSERT_EQ(
+        reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), 200);
+    ASSERT_EQ(reply->rawHeader("ETag"), QByteArray("\"abc\""));
+    ASSERT_EQ(reply->readAll(), entry.responseBody);
+    reply->deleteLater();
+}
+
+TEST_F(TestRecorder, TestReplayHoldsBodyBack)
+{
+    qhr::ReplayNetworkAccessManager nam;
+    nam.setEntries({ entry });
+
+    auto reply = nam.get(QNetworkRequest(entry.url));
+    qint64 available = -1;
+    QObject::connect(reply, &QNetworkReply::metaDataChanged,
+        [reply, &available]() { available = reply->bytesAvailable(); });
+
+    // Headers arrive after the recorded wait, the body after its receive time
+    ASSERT_TRUE(QTest::qWaitFor([&available]() { return available >= 0; }));
+    ASSERT_EQ(available, 0);
+    ASSERT_FALSE(reply->isFinished());
+
+    ASSERT_TRUE(QTest::qWaitFor([reply]() { return reply->isFinished(); }));
+    ASSERT_EQ(reply->bytesAvailable(), entry.responseBody.size());
+    ASSERT_EQ(reply->readAll(), entry.responseBody);
+    ASSERT_EQ(reply->bytesAvailable(), 0);
+    reply->deleteLater();
+}
+
+TEST_F(TestRecorder, TestReplayWithoutRecordedResponse)
+{
+    qhr::ReplayNetworkAccessManager nam;
+    nam.setEntries({ entry });
+    nam.setLatencyScale(0);
+
+    auto reply = nam.get(QNetworkRequest(QUrl("https://fake.com/other")));
+    ASSERT_TRUE(QTest::qWaitFor([reply]() { return reply->isFinished(); }));
+
+    ASSERT_EQ(reply->error(), QNetworkReply::ContentNotFoundError);
+    reply->deleteLater();
+}
+
+TEST_F(TestRecorder, TestFileName)
+{
+    ASSERT_EQ(qhr::Recorder::fileName(QUrl("qrc:/har/session.har")),
+        QString(":/har/session.har"));
+    ASSERT_EQ(qhr::Recorder::fileName(QUrl::fromLocalFile("/tmp/session.har")),
+        QString("/tmp/session.har"));
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    ::testing::InitGoogleMock(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,10 +1,22 @@
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QJSEngine>
+#include <QNetworkAccessManager>
+#include <QPointer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryFile>
 #include <QTest>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "localserver.hpp"
 #include "request.hpp"
 
+static const QByteArray Ok = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+
 class TestRequest : public ::testing::Test
 {
 public:
@@ -18,7 +30,8 @@ public:
 
     }
 
-    qhr::Request request;
+    QNetworkAccessManager nam;
+    qhr::Request request { &nam };
 };
 
 TEST_F(TestRequest, TestDefaultConstructedRequest)
@@ -39,8 +52,466 @@ TEST_F(TestRequest, TestSetRequestHeader)
     ASSERT_STREQ(request.requestHeader("Content-type").constData(), "application-json");
 }
 
+TEST_F(TestRequest, TestLiveCount)
+{
+    const int liveCount = qhr::Request::liveCount();
+    auto other = new qhr::Request(nullptr);
+    ASSERT_EQ(qhr::Request::liveCount(), liveCount + 1);
+    delete other;
+    ASSERT_EQ(qhr::Request::liveCount(), liveCount);
+}
+
+TEST_F(TestRequest, TestCallbacksSideStorage)
+{
+    ASSERT_TRUE(request.onError().isUndefined());
+    request.setOnError(QJSValue(true));
+    ASSERT_TRUE(request.onError().toBool());
+}
+
+TEST_F(TestRequest, TestLowSpeedLimit)
+{
+    ASSERT_EQ(request.lowSpeedLimit(), 0);
+    ASSERT_EQ(request.lowSpeedTime(), 30000);
+    ASSERT_EQ(request.transferRate(), 0.0);
+
+    request.setLowSpeedLimit(1024);
+    request.setLowSpeedTime(10000);
+    ASSERT_EQ(request.lowSpeedLimit(), 1024);
+    ASSERT_EQ(request.lowSpeedTime(), 10000);
+
+    request.setLowSpeedLimit(-1);
+    ASSERT_EQ(request.lowSpeedLimit(), 0);
+
+    // A limit alone is enforced over the default time
+    qhr::Request other(nullptr);
+    other.setLowSpeedLimit(1024);
+    ASSERT_EQ(other.lowSpeedTime(), 30000);
+}
+
+TEST_F(TestRequest, TestTimeouts)
+{
+    ASSERT_EQ(request.connectTimeout(), 0);
+    ASSERT_EQ(request.firstByteTimeout(), 0);
+    ASSERT_EQ(request.deadline(), 0);
+
+    request.setConnectTimeout(2000);
+    request.setFirstByteTimeout(5000);
+    request.setDeadline(600000);
+    ASSERT_EQ(request.connectTimeout(), 2000);
+    ASSERT_EQ(request.firstByteTimeout(), 5000);
+    ASSERT_EQ(request.deadline(), 600000);
+
+    request.setConnectTimeout(-1);
+    ASSERT_EQ(request.connectTimeout(), 0);
+}
+
+TEST(TestRequestTimeouts, TestReasons)
+{
+    LocalServer server({});
+    QNetworkAccessManager nam;
+    QJSEngine engine;
+    qhr::Request request(&nam);
+    request.setOnTimeout(
+        engine.evaluate("(function(reason) { timeoutReason = reason })"));
+
+    auto expire = [&](const QUrl& url) {
+        engine.globalObject().setProperty("timeoutReason", QString());
+        request.open("GET", url);
+        request.send();
+        EXPECT_TRUE(QTest::qWaitFor([&request]() {
+            return request.readyState() == qhr::Request::State::Done;
+        }));
+        return engine.globalObject().property("timeoutReason").toString();
+    };
+
+    // The server reads the request but never answers
+    const auto url = QUrl("http+unix://" + LocalServer::name() + "/");
+    request.setFirstByteTimeout(100);
+    ASSERT_EQ(expire(url), QString("firstByte"));
+
+    request.setFirstByteTimeout(0);
+    request.setDeadline(100);
+    ASSERT_EQ(expire(url), QString("deadline"));
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+    // Once the backlog of a server not accepting is full, connecting hangs
+    QTcpServer stalled;
+    stalled.setListenBacklogSize(0);
+    ASSERT_TRUE(stalled.listen(QHostAddress::LocalHost));
+    stalled.pauseAccepting();
+    QTcpSocket queued;
+    queued.connectToHost(QHostAddress::LocalHost, stalled.serverPort());
+    ASSERT_TRUE(queued.waitForConnected(1000));
+
+    request.setDeadline(0);
+    request.setConnectTimeout(100);
+    ASSERT_EQ(expire(QUrl(QString("http://127.0.0.1:%1/")
+                          .arg(stalled.serverPort()))),
+        QString("connect"));
+#endif
+}
+
+TEST(TestRequestPolling, TestPolling)
+{
+    LocalServer server({ "HTTP/1.1 200 OK\r\nETag: \"v1\"\r\n"
+                         "Content-Length: 5\r\n\r\nfirst",
+        "HTTP/1.1 304 Not Modified\r\nETag: \"v1\"\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nfirst",
+        "HTTP/1.1 200 OK\r\nContent-Length: 6\r\n\r\nsecond" });
+    QNetworkAccessManager nam;
+    qhr::Request request(&nam);
+
+    int finished = 0;
+    QObject::connect(&request, &qhr::Request::finished,
+        [&finished]() { ++finished; });
+
+    request.open("GET", QUrl("http+unix://" + LocalServer::name() + "/v1"));
+    request.poll(100, 1000);
+    ASSERT_TRUE(request.isPolling());
+    ASSERT_TRUE(QTest::qWaitFor([&finished]() { return finished == 1; }));
+    ASSERT_EQ(request.responseText(), QString("first"));
+    ASSERT_EQ(request.pollInterval(), 100);
+
+    // Not modified, then an identical body, both back off silently
+    ASSERT_TRUE(QTest::qWaitFor([&request]() {
+        return request.pollInterval() == 400;
+    }));
+    ASSERT_TRUE(server.requests[1].contains("If-None-Match: \"v1\"\r\n"));
+    ASSERT_TRUE(server.requests[2].contains("If-None-Match: \"v1\"\r\n"));
+    ASSERT_EQ(finished, 1);
+    ASSERT_EQ(request.status(), 200);
+    ASSERT_EQ(request.responseText(), QString("first"));
+
+    ASSERT_TRUE(QTest::qWaitFor([&finished]() { return finished == 2; }));
+    ASSERT_FALSE(server.requests[3].contains("If-None-Match"));
+    ASSERT_EQ(request.responseText(), QString("second"));
+    ASSERT_EQ(request.pollInterval(), 100);
+
+    request.stopPolling();
+    ASSERT_FALSE(request.isPolling());
+}
+
+TEST(TestRequestPolling, TestCallerValidators)
+{
+    LocalServer server({ "HTTP/1.1 304 Not Modified\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nETag: \"v2\"\r\nContent-Length: 6\r\n\r\nsecond" });
+    QNetworkAccessManager nam;
+    qhr::Request request(&nam);
+
+    int finished = 0;
+    QObject::connect(&request, &qhr::Request::finished,
+        [&finished]() { ++finished; });
+
+    request.open("GET", QUrl("http+unix://" + LocalServer::name() + "/v1"));
+    request.setRequestHeader("If-None-Match", "\"mine\"");
+    request.poll(100, 1000);
+
+    // A 304 answering the validator of the caller is reported
+    ASSERT_TRUE(QTest::qWaitFor([&finished]() { return finished == 1; }));
+    ASSERT_EQ(request.status(), 304);
+
+    // And the validator is sent as is, even after a response with an ETag
+    ASSERT_TRUE(QTest::qWaitFor([&finished]() { return finished == 2; }));
+    ASSERT_TRUE(server.requests[1].contains("If-None-Match: \"mine\"\r\n"));
+    ASSERT_EQ(request.responseText(), QString("second"));
+
+    request.stopPolling();
+    ASSERT_EQ(request.requestHeader("If-None-Match"), QByteArray("\"mine\""));
+}
+
+TEST(TestRequestPolling, TestStopReleases)
+{
+    LocalServer server({ Ok });
+    QNetworkAccessManager nam;
+    QPointer<qhr::Request> request = new qhr::Request(&nam);
+    request->setAutoRelease(true);
+
+    int finished = 0;
+    QObject::connect(request, &qhr::Request::finished,
+        [&finished]() { ++finished; });
+
+    request->open("GET", QUrl("http+unix://" + LocalServer::name() + "/v1"));
+    request->poll(1000);
+    ASSERT_TRUE(QTest::qWaitFor([&finished]() { return finished == 1; }));
+    ASSERT_FALSE(request.isNull());
+
+    // Kept between polls, deleted once no poll is left
+    request->stopPolling();
+    ASSERT_TRUE(QTest::qWaitFor([&request]() { return request.isNull(); }));
+}
+
+TEST(TestRequestPolling, TestPollInFlight)
+{
+    LocalServer server({ Ok });
+    QNetworkAccessManager nam;
+    qhr::Request request(&nam);
+
+    request.open("GET", QUrl("http+unix://" + LocalServer::name() + "/v1"));
+    request.poll(100);
+    ASSERT_TRUE(QTest::qWaitFor([&request]() {
+        return request.readyState() == qhr::Request::State::Done;
+    }));
+
+    // The next poll is not answered, it is in flight with the last response
+    ASSERT_TRUE(QTest::qWaitFor([&server]() {
+        return server.requests.size() == 2;
+    }));
+    ASSERT_EQ(request.readyState(), qhr::Request::State::Opened);
+    ASSERT_TRUE(request.isPending());
+    ASSERT_EQ(request.status(), 200);
+
+    request.stopPolling();
+    request.abort();
+    ASSERT_TRUE(QTest::qWaitFor([&request]() {
+        return request.readyState() == qhr::Request::State::Done;
+    }));
+}
+
+TEST(TestRequestBody, TestFileBody)
+{
+    LocalServer server({ Ok });
+    QNetworkAccessManager nam;
+    qhr::Request request(&nam);
+
+    QTemporaryFile file;
+    ASSERT_TRUE(file.open());
+    file.write("streamed from disk");
+    file.close();
+
+    request.open("PUT", QUrl("http+unix://" + LocalServer::name() + "/blob"));
+    request.send(QUrl::fromLocalFile(file.fileName()));
+    ASSERT_TRUE(QTest::qWaitFor([&request]() {
+        return request.readyState() == qhr::Request::State::Done;
+    }));
+
+    ASSERT_EQ(request.status(), 200);
+    ASSERT_TRUE(server.requests[0].startsWith("PUT /blob HTTP/1.1\r\n"));
+    ASSERT_TRUE(server.requests[0].contains("Content-Length: 18\r\n"));
+    ASSERT_TRUE(server.requests[0].endsWith("\r\n\r\nstreamed from disk"));
+}
+
+TEST(TestRequestBody, TestDeviceBody)
+{
+    LocalServer server({ Ok });
+    QNetworkAccessManager nam;
+    qhr::Request request(&nam);
+
+    QByteArray bytes("streamed from a device");
+    QBuffer buffer(&bytes);
+
+    request.open("POST", QUrl("http+unix://" + LocalServer::name() + "/raw"));
+    request.send(&buffer);
+    ASSERT_TRUE(QTest::qWaitFor([&request]() {
+        return request.readyState() == qhr::Request::State::Done;
+    }));
+
+    ASSERT_EQ(request.status(), 200);
+    ASSERT_TRUE(server.requests[0].contains(
+        "Content-Type: application/octet-stream\r\n"));
+    ASSERT_TRUE(server.requests[0].contains("Content-Length: 22\r\n"));
+    ASSERT_TRUE(
+        server.requests[0].endsWith("\r\n\r\nstreamed from a device"));
+}
+
+TEST(TestRequestBody, TestUnreadableBody)
+{
+    LocalServer server({});
+    QNetworkAccessManager nam;
+    QJSEngine engine;
+    qhr::Request request(&nam);
+
+    int finished = 0;
+    QObject::connect(&request, &qhr::Request::finished,
+        [&finished]() { ++finished; });
+    request.setOnError(
+        engine.evaluate("(function(code) { errorCode = code })"));
+
+    const auto url = QUrl("http+unix://" + LocalServer::name() + "/blob");
+    request.open("PUT", url);
+    request.send(QUrl::fromLocalFile("/qhr-missing/blob.bin"));
+
+    // Completed right away with an error, nothing is sent
+    ASSERT_EQ(finished, 1);
+    ASSERT_EQ(request.readyState(), qhr::Request::State::Done);
+    ASSERT_EQ(engine.globalObject().property("errorCode").toInt(),
+        int(qhr::Request::Error::BodyReadError));
+
+    QFile missing("/qhr-missing/blob.bin");
+    request.open("PUT", url);
+    request.send(&missing);
+    ASSERT_EQ(finished, 2);
+    ASSERT_EQ(request.readyState(), qhr::Request::State::Done);
+
+    QTest::qWait(100);
+    ASSERT_TRUE(server.requests.isEmpty());
+}
+
+TEST(TestRequestBody, TestBinaryBody)
+{
+    QJSEngine engine;
+    QByteArray bytes;
+
+    // The engine converts an ArrayBuffer to a QByteArray
+    const auto buffer = engine.evaluate("new Uint8Array([1, 2, 3, 4]).buffer");
+    ASSERT_TRUE(qhr::Request::binaryBody(buffer.toVariant(), bytes));
+    ASSERT_EQ(bytes, QByteArray("\x01\x02\x03\x04"));
+
+    // Views only send the bytes they cover
+    const auto typed
+        = engine.evaluate("new Uint8Array([1, 2, 3, 4]).subarray(1, 3)");
+    ASSERT_TRUE(qhr::Request::binaryBody(QVariant::fromValue(typed), bytes));
+    ASSERT_EQ(bytes, QByteArray("\x02\x03"));
+
+    const auto wide = engine.evaluate("new Uint16Array([1, 2])");
+    ASSERT_TRUE(qhr::Request::binaryBody(QVariant::fromValue(wide), bytes));
+    ASSERT_EQ(bytes.size(), 4);
+
+    const auto view = engine.evaluate(
+        "new DataView(new Uint8Array([1, 2, 3, 4]).buffer, 2)");
+    ASSERT_TRUE(qhr::Request::binaryBody(QVariant::fromValue(view), bytes));
+    ASSERT_EQ(bytes, QByteArray("\x03\x04"));
+
+    ASSERT_FALSE(qhr::Request::binaryBody(QVariant("text"), bytes));
+    ASSERT_FALSE(qhr::Request::binaryBody(
+        QVariant::fromValue(engine.evaluate("[1, 2]")), bytes));
+    ASSERT_FALSE(qhr::Request::binaryBody(
+        QVariant::fromValue(engine.evaluate("({ byteLength: 2 })")), bytes));
+}
+
+TEST(TestRequestBody, TestDefaultContentType)
+{
+    LocalServer server({ Ok, Ok, Ok, Ok, Ok });
+    QNetworkAccessManager nam;
+    QJSEngine engine;
+    const auto url = QUrl("http+unix://" + LocalServer::name() + "/items");
+
+    auto post = [&nam, &url](const QVariant& body, const QString& type) {
+        qhr::Request request(&nam);
+        request.open("POST", url);
+        if (!type.isEmpty()) {
+            request.setRequestHeader("Content-Type", type);
+        }
+        request.send(body);
+        return QTest::qWaitFor([&request]() {
+            return request.readyState() == qhr::Request::State::Done;
+        });
+    };
+
+    const auto typed
+        = engine.evaluate("new Uint8Array([1, 2, 3, 4]).subarray(2)");
+    ASSERT_TRUE(post(QVariant::fromValue(typed), QString()));
+    ASSERT_TRUE(post(QVariant::fromValue(typed), "image/png"));
+    ASSERT_TRUE(post(QVariant("text"), QString()));
+    ASSERT_TRUE(post(QVariantMap { { "id", 1 } }, QString()));
+    ASSERT_TRUE(post(QVariant::fromValue(engine.evaluate("({ id: 2 })")),
+        "application/cbor"));
+
+    ASSERT_EQ(server.requests.size(), 5);
+    ASSERT_TRUE(server.requests[0].contains(
+        "Content-Type: application/octet-stream\r\n"));
+    ASSERT_TRUE(server.requests[0].endsWith("\r\n\r\n\x03\x04"));
+    ASSERT_TRUE(server.requests[1].contains("Content-Type: image/png\r\n"));
+    ASSERT_TRUE(server.requests[1].endsWith("\r\n\r\n\x03\x04"));
+    ASSERT_TRUE(server.requests[2].contains(
+        "Content-Type: text/plain;charset=UTF-8\r\n"));
+    ASSERT_TRUE(server.requests[3].contains(
+        "Content-Type: application/json\r\n"));
+    ASSERT_TRUE(server.requests[3].endsWith("{\"id\":1}"));
+    // A map of one "id" text key and the integer 2
+    ASSERT_TRUE(server.requests[4].endsWith("\r\n\r\n\xa1\x62id\x02"));
+}
+
+TEST(TestRequestIntegrity, TestMissingDigestFails)
+{
+    LocalServer server({ "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nfirst",
+        "HTTP/1.1 200 OK\r\nDigest: crc32c=Fb2Hkw==\r\n"
+        "Content-Length: 5\r\n\r\nfirst" });
+    QNetworkAccessManager nam;
+    QJSEngine engine;
+    qhr::Request request(&nam);
+    request.setIntegrity("header");
+    request.setOnError(
+        engine.evaluate("(function(code) { errorCode = code })"));
+
+    // Neither a response without a digest nor one with an unsupported digest
+    // is trusted
+    for (int i = 0; i < 2; ++i) {
+        engine.globalObject().setProperty("errorCode", 0);
+        request.open("GET", QUrl("http+unix://" + LocalServer::name() + "/"));
+        request.send();
+        ASSERT_TRUE(QTest::qWaitFor([&request]() {
+            return request.readyState() == qhr::Request::State::Done;
+        }));
+        ASSERT_EQ(engine.globalObject().property("errorCode").toInt(),
+            int(qhr::Request::Error::IntegrityError));
+    }
+}
+
+TEST(TestRequestIntegrity, TestDeviceChecksum)
+{
+    LocalServer server({ Ok });
+    QNetworkAccessManager nam;
+    qhr::Request request(&nam);
+    request.setUploadChecksum("md5");
+
+    QByteArray bytes("checksummed");
+    QBuffer buffer(&bytes);
+    ASSERT_TRUE(buffer.open(QIODevice::ReadOnly));
+    buffer.seek(3);
+
+    request.open("PUT", QUrl("http+unix://" + LocalServer::name() + "/blob"));
+    request.send(&buffer);
+    ASSERT_TRUE(QTest::qWaitFor([&request]() {
+        return request.readyState() == qhr::Request::State::Done;
+    }));
+
+    // The whole device is sent and hashed
+    const auto md5 = QCryptographicHash::hash(bytes, QCryptographicHash::Md5);
+    ASSERT_TRUE(server.requests[0].contains(
+        "Content-MD5: " + md5.toBase64() + "\r\n"));
+    ASSERT_TRUE(server.requests[0].endsWith("\r\n\r\nchecksummed"));
+}
+
+TEST(TestResponse, TestCharsetDecoding)
+{
+    ASSERT_EQ(qhr::Response::charset("text/html; Charset=\"ISO-8859-1\""),
+        QByteArray("iso-8859-1"));
+    ASSERT_TRUE(qhr::Response::charset("application/json").isEmpty());
+
+    qhr::Response response;
+    response.setBody("caf\xe9", "text/plain; charset=iso-8859-1");
+    ASSERT_EQ(response.text(), QString::fromUtf8("caf\xc3\xa9"));
+
+    response.setBody("\xef\xbb\xbfna\xc3\xafve", "text/plain");
+    ASSERT_EQ(response.text(), QString::fromUtf8("na\xc3\xafve"));
+
+    response.setBody("plain ascii text", QByteArray());
+    ASSERT_EQ(response.text(), QString("plain ascii text"));
+}
+
+TEST(TestResponse, TestClear)
+{
+    qhr::Response response;
+    response.status = 200;
+    response.setStatusText("OK");
+    response.setResponseUrl(QUrl("https://fake.com/items"));
+    response.setResponseType("json");
+    response.setBody("[]", "application/json; charset=iso-8859-1");
+    ASSERT_EQ(response.statusText(), QString("OK"));
+    ASSERT_EQ(response.responseUrl(), QUrl("https://fake.com/items"));
+    ASSERT_EQ(response.responseType(), QString("json"));
+
+    response.clear();
+    ASSERT_EQ(response.status, 0);
+    ASSERT_TRUE(response.statusText().isEmpty());
+    ASSERT_TRUE(response.responseUrl().isEmpty());
+    ASSERT_TRUE(response.responseType().isEmpty());
+    ASSERT_TRUE(response.text().isEmpty());
+}
+
 int main(int argc, char* argv[])
 {
+    QCoreApplication app(argc, argv);
     ::testing::InitGoogleMock(&argc, argv);
     return RUN_ALL_TESTS();
 }
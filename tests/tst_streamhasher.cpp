@@ -0,0 +1,84 @@
+#include <QTemporaryFile>
+#include <QTest>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "streamhasher.hpp"
+
+TEST(TestStreamHasher, TestParseIntegrity)
+{
+    const auto sha256 = QCryptographicHash::hash("a", QCryptographicHash::Sha256);
+    const auto sha384 = QCryptographicHash::hash("a", QCryptographicHash::Sha384);
+
+    qhr::StreamHasher::Algorithm algorithm;
+    QList<QByteArray> digests;
+    ASSERT_TRUE(qhr::StreamHasher::parseIntegrity(
+        "sha256-" + sha256.toBase64() + "  sha384-" + sha384.toBase64()
+            + "?opt md5-abc",
+        algorithm, digests));
+    ASSERT_EQ(algorithm, QCryptographicHash::Sha384);
+    ASSERT_EQ(digests, QList<QByteArray> { sha384 });
+
+    ASSERT_FALSE(
+        qhr::StreamHasher::parseIntegrity("md5-abc", algorithm, digests));
+}
+
+TEST(TestStreamHasher, TestParseDigestHeaders)
+{
+    const auto sha256 = QCryptographicHash::hash("a", QCryptographicHash::Sha256);
+    const auto md5 = QCryptographicHash::hash("a", QCryptographicHash::Md5);
+
+    qhr::StreamHasher::Algorithm algorithm;
+    QList<QByteArray> digests;
+    ASSERT_TRUE(qhr::StreamHasher::parseDigestHeaders(
+        "md5=" + md5.toBase64() + ", sha-256=:" + sha256.toBase64() + ":",
+        QByteArray(), algorithm, digests));
+    ASSERT_EQ(algorithm, QCryptographicHash::Sha256);
+    ASSERT_EQ(digests, QList<QByteArray> { sha256 });
+
+    ASSERT_TRUE(qhr::StreamHasher::parseDigestHeaders(
+        QByteArray(), md5.toBase64(), algorithm, digests));
+    ASSERT_EQ(algorithm, QCryptographicHash::Md5);
+
+    ASSERT_FALSE(qhr::StreamHasher::parseDigestHeaders(
+        QByteArray(), QByteArray(), algorithm, digests));
+}
+
+TEST(TestStreamHasher, TestIncrementalHash)
+{
+    QByteArray result;
+    qhr::StreamHasher hasher(QCryptographicHash::Sha256);
+    QObject::connect(&hasher, &qhr::StreamHasher::finished,
+        [&result](const QByteArray& digest) { result = digest; });
+
+    hasher.addData("hello ");
+    hasher.addData("world");
+    hasher.finish();
+    ASSERT_EQ(result,
+        QCryptographicHash::hash("hello world", QCryptographicHash::Sha256));
+
+    QTemporaryFile file;
+    ASSERT_TRUE(file.open());
+    file.write("file content");
+    file.flush();
+
+    qhr::StreamHasher fileHasher(QCryptographicHash::Md5);
+    QObject::connect(&fileHasher, &qhr::StreamHasher::finished,
+        [&result](const QByteArray& digest) { result = digest; });
+    fileHasher.addFile(file.fileName());
+    fileHasher.finish();
+    ASSERT_EQ(
+        result, QCryptographicHash::hash("file content", QCryptographicHash::Md5));
+
+    const auto header = qhr::StreamHasher::checksumHeader(
+        QCryptographicHash::Sha256, QByteArray("\x01\x02", 2));
+    ASSERT_EQ(header.first, QByteArray("Digest"));
+    ASSERT_EQ(header.second, QByteArray("SHA-256=AQI="));
+}
+
+int main(int argc, char* argv[])
+{
+    ::testing::InitGoogleMock(&argc, argv);
+    return RUN_ALL_TESTS();
+}
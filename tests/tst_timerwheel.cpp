@@ -0,0 +1,93 @@
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTest>
+#include <QThread>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "timerwheel.hpp"
+
+TEST(TestTimerWheel, TestExpiryOrder)
+{
+    qhr::TimerWheel wheel;
+    QObject context;
+    QList<int> fired;
+
+    wheel.start(120, &context, [&fired]() { fired.append(120); });
+    wheel.start(40, &context, [&fired]() { fired.append(40); });
+    const auto stopped
+        = wheel.start(80, &context, [&fired]() { fired.append(80); });
+    wheel.stop(stopped);
+    ASSERT_EQ(wheel.count(), 2);
+
+    ASSERT_TRUE(QTest::qWaitFor([&fired]() { return fired.size() == 2; }));
+    ASSERT_EQ(fired, QList<int>({ 40, 120 }));
+    ASSERT_EQ(wheel.count(), 0);
+}
+
+TEST(TestTimerWheel, TestLongTimeoutAndContext)
+{
+    qhr::TimerWheel wheel(5);
+    bool fired = false;
+    bool skipped = true;
+
+    // Longer than a turn of the wheel
+    const int timeout = wheel.resolution() * (qhr::TimerWheel::Slots + 2);
+    QObject context;
+    wheel.start(timeout, &context, [&fired]() { fired = true; });
+    {
+        QObject destroyed;
+        wheel.start(10, &destroyed, [&skipped]() { skipped = false; });
+    }
+
+    QTest::qWait(wheel.resolution() * 4);
+    ASSERT_TRUE(skipped);
+    ASSERT_FALSE(fired);
+    ASSERT_TRUE(QTest::qWaitFor([&fired]() { return fired; }, timeout * 2));
+}
+
+TEST(TestTimerWheel, TestBusyEventLoop)
+{
+    qhr::TimerWheel wheel(10);
+    QObject context;
+    wheel.start(5000, &context, []() {});
+
+    // No tick runs while the event loop is blocked, a timeout started then
+    // still waits for its whole duration
+    QThread::msleep(200);
+    QElapsedTimer elapsed;
+    elapsed.start();
+    bool fired = false;
+    wheel.start(100, &context, [&fired]() { fired = true; });
+
+    ASSERT_TRUE(QTest::qWaitFor([&fired]() { return fired; }));
+    ASSERT_GE(elapsed.elapsed(), 100);
+}
+
+TEST(TestTimerWheel, TestNeverEarly)
+{
+    qhr::TimerWheel wheel(50);
+    QObject context;
+    wheel.start(5000, &context, []() {});
+
+    // Started between two ticks, the timeout still waits for its whole
+    // duration rather than expiring at the tick it is rounded to
+    for (const int offset : { 10, 30, 45 }) {
+        QTest::qWait(offset);
+        QElapsedTimer elapsed;
+        elapsed.start();
+        bool fired = false;
+        wheel.start(50, &context, [&fired]() { fired = true; });
+
+        ASSERT_TRUE(QTest::qWaitFor([&fired]() { return fired; }));
+        ASSERT_GE(elapsed.elapsed(), 50);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    ::testing::InitGoogleMock(&argc, argv);
+    return RUN_ALL_TESTS();
+}
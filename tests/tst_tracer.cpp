@@ -0,0 +1,93 @@
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTest>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "tracer.hpp"
+
+static QJsonArray events(const qhr::Tracer& tracer)
+{
+    const auto document = QJsonDocument::fromJson(tracer.toChromeTraceJson());
+    return document.object().value("traceEvents").toArray();
+}
+
+TEST(TestTracer, TestCapacity)
+{
+    ASSERT_EQ(qhr::Tracer(8).capacity(), 8);
+    ASSERT_EQ(qhr::Tracer(0).capacity(), 1);
+    ASSERT_TRUE(events(qhr::Tracer(8)).isEmpty());
+}
+
+TEST(TestTracer, TestWraparound)
+{
+    qhr::Tracer tracer(4);
+    for (int i = 0; i < 10; ++i) {
+        tracer.record("open", 'n', quint64(i), i);
+    }
+
+    // Only the last events are kept, oldest first
+    const auto recorded = events(tracer);
+    ASSERT_EQ(recorded.size(), 4);
+    for (int i = 0; i < 4; ++i) {
+        const auto args = recorded[i].toObject().value("args").toObject();
+        ASSERT_EQ(args.value("request").toInt(), 6 + i);
+        ASSERT_EQ(recorded[i].toObject().value("ts").toInt(), 6 + i);
+    }
+}
+
+TEST(TestTracer, TestChromeTraceJson)
+{
+    qhr::Tracer tracer(16);
+    tracer.record("request", 'b', 0x2a, 100, 0, "https://fake.com");
+    tracer.record("onload", 'X', 0x2a, 150, 25);
+    tracer.record("request", 'e', 0x2a, 200, 0, QByteArray(300, 'x'));
+
+    const auto document = QJsonDocument::fromJson(tracer.toChromeTraceJson());
+    ASSERT_TRUE(document.isObject());
+    ASSERT_EQ(document.object().value("displayTimeUnit").toString(),
+        QString("ms"));
+
+    const auto recorded = document.object().value("traceEvents").toArray();
+    ASSERT_EQ(recorded.size(), 3);
+
+    const auto begin = recorded[0].toObject();
+    ASSERT_EQ(begin.value("name").toString(), QString("request"));
+    ASSERT_EQ(begin.value("cat").toString(), QString("qmlhttprequest"));
+    ASSERT_EQ(begin.value("ph").toString(), QString("b"));
+    ASSERT_EQ(begin.value("id").toString(), QString("0x2a"));
+    ASSERT_TRUE(begin.contains("pid"));
+    ASSERT_TRUE(begin.contains("tid"));
+    ASSERT_EQ(begin.value("args").toObject().value("detail").toString(),
+        QString("https://fake.com"));
+
+    // Complete events have a duration instead of an async id
+    const auto callback = recorded[1].toObject();
+    ASSERT_EQ(callback.value("ph").toString(), QString("X"));
+    ASSERT_EQ(callback.value("dur").toInt(), 25);
+    ASSERT_FALSE(callback.contains("id"));
+    ASSERT_FALSE(callback.value("args").toObject().contains("detail"));
+
+    // Details are truncated to fit the event
+    const auto end = recorded[2].toObject();
+    ASSERT_EQ(end.value("args").toObject().value("detail").toString().size(),
+        int(sizeof(qhr::Tracer::Event::detail)) - 1);
+}
+
+TEST(TestTracer, TestActive)
+{
+    qhr::Tracer tracer(4);
+    ASSERT_EQ(qhr::Tracer::active(), nullptr);
+    qhr::Tracer::setActive(&tracer);
+    ASSERT_EQ(qhr::Tracer::active(), &tracer);
+    qhr::Tracer::setActive(nullptr);
+    ASSERT_EQ(qhr::Tracer::active(), nullptr);
+}
+
+int main(int argc, char* argv[])
+{
+    ::testing::InitGoogleMock(&argc, argv);
+    return RUN_ALL_TESTS();
+}